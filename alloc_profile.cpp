@@ -0,0 +1,360 @@
+/*
+ * alloc_profile.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+#include <iomanip>
+#include <new>
+#include <string>
+#include <vector>
+#include <execinfo.h>
+#include <cxxabi.h>
+
+#include "alloc_profile.h"
+
+// Defines the bytes in front of an allocation
+class AllocHeader {
+
+public:
+	size_t size;
+
+	// Phase the allocation is charged to, outside_phase if it was made
+	// outside any, NULL if it is not counted
+	Phase * phase;
+
+};
+
+static_assert(sizeof(AllocHeader) <= ALLOC_HEADER_SIZE, "an allocation header does not fit");
+
+// Allocations counted since the profiler was enabled
+static std::atomic<long> n_allocations(0);
+static std::atomic<long> n_allocated_bytes(0);
+static std::atomic<long> n_live_bytes(0);
+
+static std::atomic<bool> profiling(false);
+static bool profiling_sites = false;
+
+// Phase of the allocations made outside any phase
+static Phase outside_phase("");
+
+// Phase counters and call sites, open addressing, guarded by a spin lock
+// since a mutex could allocate
+static AllocSite sites[ALLOC_SITES];
+static std::atomic_flag sites_lock = ATOMIC_FLAG_INIT;
+static std::atomic<long> n_dropped(0);
+
+// Whether the thread is already inside the profiler, which allocations of
+// backtrace and report would reenter
+static thread_local bool inside = false;
+
+// Header of the allocation at [pt]
+static inline AllocHeader * header(void * pt) {
+	return reinterpret_cast<AllocHeader *>(static_cast<char *>(pt) - ALLOC_HEADER_SIZE);
+}
+
+void * operator new(size_t size) {
+	char * block;
+
+	if(! (block = static_cast<char *>(malloc(size + ALLOC_HEADER_SIZE))))
+		throw std::bad_alloc();
+
+	reinterpret_cast<AllocHeader *>(block)->size = size;
+	reinterpret_cast<AllocHeader *>(block)->phase = NULL;
+
+	AllocProfile::allocated(block + ALLOC_HEADER_SIZE, size);
+	return block + ALLOC_HEADER_SIZE;
+}
+
+void operator delete(void * pt) noexcept {
+	if(! pt)
+		return;
+
+	AllocProfile::freed(pt);
+	free(header(pt));
+}
+
+void operator delete(void * pt, size_t) noexcept {
+	operator delete(pt);
+}
+
+// The other forms go through the two above, memory from any of them may
+// be freed by any other, whatever a sanitizer replaces
+void * operator new[](size_t size) {
+	return operator new(size);
+}
+
+void * operator new(size_t size, const std::nothrow_t &) noexcept {
+	try {
+		return operator new(size);
+	} catch(std::bad_alloc &) {
+		return NULL;
+	}
+}
+
+void * operator new[](size_t size, const std::nothrow_t &) noexcept {
+	return operator new(size, std::nothrow);
+}
+
+void operator delete[](void * pt) noexcept {
+	operator delete(pt);
+}
+
+void operator delete[](void * pt, size_t) noexcept {
+	operator delete(pt);
+}
+
+void operator delete(void * pt, const std::nothrow_t &) noexcept {
+	operator delete(pt);
+}
+
+void operator delete[](void * pt, const std::nothrow_t &) noexcept {
+	operator delete(pt);
+}
+
+// Bytes in front of an allocation aligned to [alignment], its header at
+// the end of them, so that the block stays aligned
+static inline size_t aligned_offset(std::align_val_t alignment) {
+	return std::max(static_cast<size_t>(alignment), static_cast<size_t>(ALLOC_HEADER_SIZE));
+}
+
+// Aligned new of a type with alignas over 16, a block of its own freed
+// by aligned delete only, as the standard requires
+void * operator new(size_t size, std::align_val_t alignment) {
+	size_t offset = aligned_offset(alignment);
+	char * block;
+
+	if(! (block = static_cast<char *>(aligned_alloc(offset, (size + 2 * offset - 1) / offset * offset))))
+		throw std::bad_alloc();
+
+	header(block + offset)->size = size;
+	header(block + offset)->phase = NULL;
+
+	AllocProfile::allocated(block + offset, size);
+	return block + offset;
+}
+
+void operator delete(void * pt, std::align_val_t alignment) noexcept {
+	if(! pt)
+		return;
+
+	AllocProfile::freed(pt);
+	free(static_cast<char *>(pt) - aligned_offset(alignment));
+}
+
+void operator delete(void * pt, size_t, std::align_val_t alignment) noexcept {
+	operator delete(pt, alignment);
+}
+
+void * operator new[](size_t size, std::align_val_t alignment) {
+	return operator new(size, alignment);
+}
+
+void * operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+	try {
+		return operator new(size, alignment);
+	} catch(std::bad_alloc &) {
+		return NULL;
+	}
+}
+
+void * operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+	return operator new(size, alignment, std::nothrow);
+}
+
+void operator delete[](void * pt, std::align_val_t alignment) noexcept {
+	operator delete(pt, alignment);
+}
+
+void operator delete[](void * pt, size_t, std::align_val_t alignment) noexcept {
+	operator delete(pt, alignment);
+}
+
+void operator delete(void * pt, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+	operator delete(pt, alignment);
+}
+
+void operator delete[](void * pt, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+	operator delete(pt, alignment);
+}
+
+// Stats shows the heap traffic of the phases from now on
+void AllocProfile::enable(int sites) {
+	profiling_sites = sites;
+	Stats::heap_counted = true;
+	profiling.store(true, std::memory_order_release);
+}
+
+bool AllocProfile::enabled() {
+	return profiling.load(std::memory_order_relaxed);
+}
+
+long AllocProfile::allocations() {
+	return n_allocations.load(std::memory_order_relaxed);
+}
+
+long AllocProfile::allocated_bytes() {
+	return n_allocated_bytes.load(std::memory_order_relaxed);
+}
+
+long AllocProfile::live_bytes() {
+	return n_live_bytes.load(std::memory_order_relaxed);
+}
+
+// The counts of the process come after the counters of the compilation
+void AllocProfile::count(Stats * stats) {
+	stats->count("allocations", allocations());
+	stats->count("allocated_bytes", allocated_bytes());
+	stats->count("live_bytes", live_bytes());
+}
+
+// Charge an allocation to the phase of the thread, and to its call site.
+// Not inlined, so that the frames to skip are always the same.
+__attribute__((noinline)) void AllocProfile::allocated(void * pt, size_t size) {
+	if(! profiling.load(std::memory_order_relaxed) || inside)
+		return;
+
+	void * frames[ALLOC_FRAMES + 2];
+	Phase * phase = Stats::thread_phase();
+	uint64_t hash = 14695981039346656037ULL;
+	int n = 0;
+
+	inside = true;
+
+	n_allocations.fetch_add(1, std::memory_order_relaxed);
+	n_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	n_live_bytes.fetch_add(size, std::memory_order_relaxed);
+
+	header(pt)->phase = phase ? phase : &outside_phase;
+
+	// Skip this function and operator new, then hash with FNV-1a
+	if(profiling_sites) {
+		n = backtrace(frames, ALLOC_FRAMES + 2) - 2;
+
+		for(int i = 0; i < n; i++)
+			hash = (hash ^ (uint64_t) frames[i + 2]) * 1099511628211ULL;
+
+		hash = (hash ^ (uint64_t) phase) * 1099511628211ULL;
+		hash |= 1;
+	}
+
+	while(sites_lock.test_and_set(std::memory_order_acquire));
+
+	if(phase) {
+		phase->allocations++;
+		phase->allocated_bytes += size;
+		phase->live_bytes += size;
+	}
+
+	// Probe from the slot of the hash, up to a full table
+	for(size_t i = 0, slot = hash & (ALLOC_SITES - 1); profiling_sites; i++, slot = (slot + 1) & (ALLOC_SITES - 1)) {
+		AllocSite & site = sites[slot];
+
+		if(i == ALLOC_SITES) {
+			n_dropped.fetch_add(1, std::memory_order_relaxed);
+			break;
+		}
+
+		if(! site.hash) {
+			site.hash = hash;
+			site.phase = phase ? phase->name.c_str() : NULL;
+			site.n_frames = std::max(n, 0);
+			memcpy(site.frames, frames + 2, site.n_frames * sizeof(void *));
+		}
+
+		if(site.hash == hash) {
+			site.count++;
+			site.bytes += size;
+			break;
+		}
+	}
+
+	sites_lock.clear(std::memory_order_release);
+	inside = false;
+}
+
+// Give the bytes back to the phase that allocated them, whichever thread frees them
+void AllocProfile::freed(void * pt) {
+	AllocHeader * freeing = header(pt);
+
+	if(! freeing->phase)
+		return;
+
+	n_live_bytes.fetch_sub(freeing->size, std::memory_order_relaxed);
+
+	if(freeing->phase == &outside_phase)
+		return;
+
+	while(sites_lock.test_and_set(std::memory_order_acquire));
+	freeing->phase->live_bytes -= freeing->size;
+	sites_lock.clear(std::memory_order_release);
+}
+
+// Name of the function of a line of backtrace_symbols, "binary(symbol+offset) [address]"
+static std::string frame_name(const char * symbol) {
+	const char * open = strchr(symbol, '(');
+	const char * plus = open ? strchr(open, '+') : NULL;
+	std::string name;
+	char * demangled;
+	int status;
+
+	if(! open || ! plus || plus == open + 1)
+		return symbol;
+
+	name = std::string(open + 1, plus - open - 1);
+
+	if((demangled = abi::__cxa_demangle(name.c_str(), NULL, NULL, &status))) {
+		name = demangled;
+		free(demangled);
+	}
+
+	return name;
+}
+
+// Output the call sites that allocated the most bytes
+void AllocProfile::report(std::ostream & out, int n) {
+	std::vector<AllocSite> top;
+
+	inside = true;
+
+	while(sites_lock.test_and_set(std::memory_order_acquire));
+
+	for(auto & site : sites)
+		if(site.hash)
+			top.push_back(site);
+
+	sites_lock.clear(std::memory_order_release);
+
+	std::sort(top.begin(), top.end(), [](const AllocSite & a, const AllocSite & b) {
+		return a.bytes > b.bytes;
+	});
+
+	if(top.size() > (size_t) n)
+		top.resize(n);
+
+	out << std::left << std::setw(18) << "site" << std::setw(16) << "phase" << std::right
+			<< std::setw(12) << "allocs" << std::setw(14) << "bytes" << std::endl;
+
+	for(auto & site : top) {
+		char ** symbols = backtrace_symbols(site.frames, site.n_frames);
+
+		out << std::left << std::hex << std::setw(18) << site.hash << std::dec << std::setw(16) << (site.phase ? site.phase : "-")
+				<< std::right << std::setw(12) << site.count << std::setw(14) << site.bytes << std::endl;
+
+		for(int i = 0; symbols && i < site.n_frames; i++)
+			out << "    " << frame_name(symbols[i]) << std::endl;
+
+		free(symbols);
+	}
+
+	if(n_dropped.load(std::memory_order_relaxed))
+		out << n_dropped.load(std::memory_order_relaxed) << " allocations from sites past the first " << ALLOC_SITES << " not shown" << std::endl;
+
+	out.unsetf(std::ios::adjustfield);
+	inside = false;
+}
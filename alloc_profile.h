@@ -0,0 +1,81 @@
+/*
+ * alloc_profile.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#ifndef ALLOC_PROFILE_H_
+#define ALLOC_PROFILE_H_
+
+#include <ostream>
+#include <cstdint>
+
+#include "stats.h"
+
+// Frames of the call stack kept for each call site
+#define ALLOC_FRAMES 8
+
+// Call sites listed by --alloc-profile
+#define ALLOC_REPORT_SITES 20
+
+// Call sites the profiler can tell apart, a power of 2
+#define ALLOC_SITES 4096
+
+// Bytes in front of each allocation, which keep its size and the phase it
+// was charged to, a multiple of 16 so that the allocation stays aligned
+#define ALLOC_HEADER_SIZE 16
+
+// Defines the allocations made from a call site in a phase
+class AllocSite {
+
+public:
+	// Hash of the frames and the phase, 0 for a free slot
+	uint64_t hash;
+
+	// Phase the allocations were made in, NULL outside any phase
+	const char * phase;
+
+	void * frames[ALLOC_FRAMES];
+	int n_frames;
+
+	long count;
+	long bytes;
+
+};
+
+// Counts the heap traffic of the process through the replaced operator
+// new and delete, which are only linked into the dpl binary when it is
+// built with DPL_ALLOC_PROFILE. Nothing is counted until the profiler is
+// enabled. From then on each allocation is charged to the innermost phase
+// of Stats running on the thread that makes it, and to that phase again
+// when it is freed, on any thread. Allocations made before are never
+// counted, so live bytes do not go below 0.
+class AllocProfile {
+
+public:
+	// Start counting allocations and live bytes, and charging each
+	// allocation to its call site, found through a backtrace, if [sites]
+	static void enable(int sites);
+	static bool enabled();
+
+	// Number and size of the allocations counted
+	static long allocations();
+	static long allocated_bytes();
+
+	// Bytes of the allocations counted that are not freed yet
+	static long live_bytes();
+
+	// Add the counts of the process to the counters of [stats]
+	static void count(Stats * stats);
+
+	// Output the [n] call sites that allocated the most bytes. Functions
+	// are only named if the binary was linked with -rdynamic.
+	static void report(std::ostream & out, int n);
+
+	// Called by operator new and delete
+	static void allocated(void * pt, size_t size);
+	static void freed(void * pt);
+};
+
+#endif /* ALLOC_PROFILE_H_ */
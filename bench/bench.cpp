@@ -0,0 +1,340 @@
+/*
+ * bench.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "../lexer.h"
+#include "../parser.h"
+#include "../translator.h"
+#include "../stats.h"
+#include "generator.h"
+
+// Regressions larger than this percentage fail a comparison
+#define BENCH_THRESHOLD 10.0
+
+// Timed rounds of each benchmark, the fastest is reported
+#define BENCH_REPETITIONS 3
+
+// Defines the measurement of a benchmark, times per iteration in nanoseconds
+class Result {
+
+public:
+	std::string name;
+	long iterations;
+	double real_time;
+	double cpu_time;
+	double bytes_per_second;
+	double items_per_second;
+
+};
+
+// Stream buffer that discards everything written to it
+class NullBuffer : public std::streambuf {
+
+protected:
+	int overflow(int c) { return c; }
+	std::streamsize xsputn(const char *, std::streamsize n) { return n; }
+
+};
+
+static NullBuffer null_buffer;
+static std::ostream null_stream(&null_buffer);
+
+// Run [iterations] of [body], return the wall time and set [cpu]
+template<typename F>
+static double run_round(long iterations, double & cpu, F & body) {
+	double wall = Stats::wall_time();
+
+	cpu = Stats::cpu_time();
+
+	for(long i = 0; i < iterations; i++)
+		body();
+
+	cpu = Stats::cpu_time() - cpu;
+	return Stats::wall_time() - wall;
+}
+
+// Double the iterations until a round takes [min_time] milliseconds, then
+// keep the fastest of the repeated rounds, which is the least disturbed
+template<typename F>
+static Result measure(std::string name, double min_time, long bytes, long items, F body) {
+	Result result;
+	long iterations = 1;
+	double wall, cpu;
+
+	body();
+
+	while((wall = run_round(iterations, cpu, body)) < min_time && iterations < (1L << 30))
+		iterations *= 2;
+
+	for(int i = 1; i < BENCH_REPETITIONS; i++) {
+		double repeat_cpu, repeat = run_round(iterations, repeat_cpu, body);
+
+		if(repeat < wall) {
+			wall = repeat;
+			cpu = repeat_cpu;
+		}
+	}
+
+	result.name = name;
+	result.iterations = iterations;
+	result.real_time = wall * 1e6 / iterations;
+	result.cpu_time = cpu * 1e6 / iterations;
+	result.bytes_per_second = bytes * 1e9 / result.real_time;
+	result.items_per_second = items * 1e9 / result.real_time;
+
+	return result;
+}
+
+// Count the tokens of [code]
+static long count_tokens(char * code) {
+	Lexer lexer;
+	long n = 0;
+
+	lexer.set_input_code(code);
+
+	while(lexer.next_token()->type != TOK_NULL)
+		n++;
+
+	return n;
+}
+
+// Measure lexing, parsing and translation of a program of [shape]
+static void run_shape(Shape & shape, double min_time, std::string & filter, std::vector<Result> & results) {
+	Generator generator;
+	std::string source = generator.generate(shape);
+	std::vector<char> code(source.begin(), source.end());
+	long tokens, bytes;
+
+	code.push_back('\0');
+	tokens = count_tokens(code.data());
+
+	// Lexing, tokens per second
+	if(("lex/" + shape.name()).find(filter) != std::string::npos) {
+		Lexer lexer;
+
+		results.push_back(measure("lex/" + shape.name(), min_time, source.size(), tokens, [&]() {
+			lexer.set_input_code(code.data());
+
+			while(lexer.next_token()->type != TOK_NULL);
+		}));
+	}
+
+	// Parsing, which includes lexing and freeing the program as a compilation
+	// does, tokens per second
+	if(("parse/" + shape.name()).find(filter) != std::string::npos) {
+		results.push_back(measure("parse/" + shape.name(), min_time, source.size(), tokens, [&]() {
+			Parser parser;
+			GlobalProgram * program;
+
+			parser.set_input_code(code.data());
+			program = static_cast<GlobalProgram *>(parser.parse());
+
+			program->release_on(NULL);
+			delete program;
+		}));
+	}
+
+	// Translation of a parsed program, functions per second
+	if(("translate/" + shape.name()).find(filter) != std::string::npos) {
+		Parser parser;
+		Translator translator;
+		CountingBuffer counted(&null_buffer);
+		std::ostream output(&counted);
+		GlobalProgram * program;
+
+		parser.set_input_code(code.data());
+		program = static_cast<GlobalProgram *>(parser.parse());
+
+		translator.set_output(&output);
+		translator.translate(program);
+		output.flush();
+		bytes = counted.bytes;
+
+		translator.set_output(&null_stream);
+
+		results.push_back(measure("translate/" + shape.name(), min_time, bytes, shape.functions, [&]() {
+			translator.translate(program);
+		}));
+
+		program->release_on(NULL);
+		delete program;
+	}
+}
+
+// Output results as a table
+static void print_table(std::vector<Result> & results) {
+	std::cout << std::left << std::setw(36) << "Benchmark" << std::right << std::setw(14) << "Time"
+			<< std::setw(14) << "CPU" << std::setw(12) << "Iterations" << std::setw(14) << "Bytes/s" << std::setw(14) << "Items/s" << std::endl;
+	std::cout << std::string(104, '-') << std::endl;
+
+	for(auto & result : results) {
+		std::cout << std::left << std::setw(36) << result.name << std::right << std::fixed << std::setprecision(0)
+				<< std::setw(11) << result.real_time << " ns" << std::setw(11) << result.cpu_time << " ns"
+				<< std::setw(12) << result.iterations << std::setprecision(2)
+				<< std::setw(12) << result.bytes_per_second / (1 << 20) << "M/s"
+				<< std::setw(12) << result.items_per_second / 1000 << "k/s" << std::endl;
+	}
+}
+
+// Output results as JSON in the layout of Google Benchmark, one benchmark per line
+static void write_json(std::ostream & out, std::vector<Result> & results) {
+	out << "{" << std::endl;
+	out << "  \"context\": {\"library\": \"dpl bench\", \"time_unit\": \"ns\"}," << std::endl;
+	out << "  \"benchmarks\": [" << std::endl;
+
+	for(size_t i = 0; i < results.size(); i++) {
+		Result & result = results[i];
+
+		out << std::fixed << std::setprecision(1) << "    {\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+				<< ", \"real_time\": " << result.real_time << ", \"cpu_time\": " << result.cpu_time << ", \"time_unit\": \"ns\""
+				<< ", \"bytes_per_second\": " << result.bytes_per_second << ", \"items_per_second\": " << result.items_per_second
+				<< "}" << (i + 1 < results.size() ? "," : "") << std::endl;
+	}
+
+	out << "  ]" << std::endl << "}" << std::endl;
+}
+
+// Compare results with a file written by write_json, return the number of regressions
+static int compare(std::vector<Result> & results, const char * file_name, double threshold) {
+	std::ifstream file(file_name);
+	std::unordered_map<std::string, double> baseline;
+	std::string line;
+	int regressions = 0;
+
+	if(! file) {
+		std::cerr << "failed to read from file " << file_name << std::endl;
+		exit(1);
+	}
+
+	// Each benchmark is on a line of its own
+	while(std::getline(file, line)) {
+		size_t name = line.find("\"name\": \"");
+		size_t time = line.find("\"real_time\": ");
+
+		if(name == std::string::npos || time == std::string::npos)
+			continue;
+
+		name += 9;
+		baseline[line.substr(name, line.find('"', name) - name)] = strtod(line.c_str() + time + 13, NULL);
+	}
+
+	std::cout << std::endl << std::left << std::setw(36) << "Benchmark" << std::right << std::setw(14) << "Baseline"
+			<< std::setw(14) << "Time" << std::setw(10) << "Change" << std::endl;
+
+	for(auto & result : results) {
+		auto it = baseline.find(result.name);
+
+		if(it == baseline.end())
+			continue;
+
+		double change = (result.real_time - it->second) / it->second * 100;
+
+		std::cout << std::left << std::setw(36) << result.name << std::right << std::fixed << std::setprecision(0)
+				<< std::setw(11) << it->second << " ns" << std::setw(11) << result.real_time << " ns"
+				<< std::setprecision(1) << std::setw(9) << std::showpos << change << "%" << std::noshowpos;
+
+		if(change > threshold) {
+			std::cout << "  regression";
+			regressions++;
+		}
+
+		std::cout << std::endl;
+	}
+
+	return regressions;
+}
+
+/*
+ * Usage: bench [--filter text] [--min-time ms] [--json file] [--compare file] [--threshold percent]
+ *        bench --generate functions depth identifiers inline nesting [seed]
+ *
+ * Measures lexing, parsing and translation of generated programs. Each
+ * parameter of the shape is scaled on its own from a base shape. With
+ * --compare the run fails if a benchmark got slower than the threshold.
+ *
+ * Built as the bench target of CMakeLists.txt, or from the root of the repository with
+ *   g++ -std=c++17 -O2 -o bench/bench $(ls bench/[a-z]*.cpp [a-z]*.cpp mem/[a-z]*.cpp | grep -v 'main.cpp\|alloc_profile.cpp') -lpthread
+ */
+int main(int argc, char ** argv) {
+	std::vector<Result> results;
+	std::string filter;
+	double min_time = 200;
+	double threshold = BENCH_THRESHOLD;
+	const char * json_file = NULL;
+	const char * baseline_file = NULL;
+
+	for(int i = 1; i < argc; i++) {
+		if(! strcmp(argv[i], "--generate") && i + 5 < argc) {
+			Shape shape(atoi(argv[i + 1]), atoi(argv[i + 2]), atoi(argv[i + 3]), atoi(argv[i + 4]), atoi(argv[i + 5]));
+			Generator generator(i + 6 < argc ? strtoull(argv[i + 6], NULL, 10) : 1);
+
+			std::cout << generator.generate(shape);
+			return 0;
+		}
+
+		else if(! strcmp(argv[i], "--filter") && i + 1 < argc)
+			filter = argv[++i];
+		else if(! strcmp(argv[i], "--min-time") && i + 1 < argc)
+			min_time = strtod(argv[++i], NULL);
+		else if(! strcmp(argv[i], "--json") && i + 1 < argc)
+			json_file = argv[++i];
+		else if(! strcmp(argv[i], "--compare") && i + 1 < argc)
+			baseline_file = argv[++i];
+		else if(! strcmp(argv[i], "--threshold") && i + 1 < argc)
+			threshold = strtod(argv[++i], NULL);
+		else {
+			std::cerr << "usage: " << argv[0] << " [--filter text] [--min-time ms] [--json file] [--compare file] [--threshold percent]" << std::endl;
+			std::cerr << "       " << argv[0] << " --generate functions depth identifiers inline nesting [seed]" << std::endl;
+			return 1;
+		}
+	}
+
+	// Functions, expression depth, identifiers, inline block size and nesting
+	std::vector<Shape> shapes = {
+		Shape(64, 3, 32, 4, 2),
+		Shape(512, 3, 32, 4, 2),
+		Shape(64, 6, 32, 4, 2),
+		Shape(64, 3, 512, 4, 2),
+		Shape(64, 3, 32, 64, 2),
+		Shape(64, 3, 32, 4, 8),
+	};
+
+	// The parser writes diagnostics to stderr
+	std::streambuf * stderr_buffer = std::cerr.rdbuf(&null_buffer);
+
+	for(auto & shape : shapes)
+		run_shape(shape, min_time, filter, results);
+
+	std::cerr.rdbuf(stderr_buffer);
+
+	print_table(results);
+
+	if(json_file) {
+		std::ofstream file(json_file);
+
+		if(! file) {
+			std::cerr << "failed to write to file " << json_file << std::endl;
+			return 1;
+		}
+
+		write_json(file, results);
+	}
+
+	if(baseline_file && compare(results, baseline_file, threshold))
+		return 1;
+
+	return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * generator.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include "generator.h"
+
+Shape::Shape(int functions, int depth, int identifiers, int inline_size, int nesting) {
+
+	this->functions = functions;
+	this->depth = depth;
+	this->identifiers = identifiers;
+	this->inline_size = inline_size;
+	this->nesting = nesting;
+
+}
+
+std::string Shape::name() {
+	return "f" + std::to_string(functions) + "_d" + std::to_string(depth) + "_i" + std::to_string(identifiers)
+			+ "_b" + std::to_string(inline_size) + "_n" + std::to_string(nesting);
+}
+
+Generator::Generator(uint64_t seed) {
+
+	this->seed = seed;
+	this->state = seed;
+
+}
+
+// Generate a program, the functions first and the global scope last
+std::string Generator::generate(Shape & shape) {
+	state = seed;
+	out.str("");
+
+	out << "// Generated program, shape " << shape.name() << ", seed " << seed << std::endl << std::endl;
+
+	for(int i = 0; i < shape.functions; i++)
+		function(shape, i);
+
+	main(shape);
+
+	return out.str();
+}
+
+// Linear congruential generator, the high bits are the best
+int Generator::next(int n) {
+	state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+	return (int) ((state >> 33) % (uint64_t) n);
+}
+
+// Output a full binary expression tree of [depth]
+void Generator::expression(int depth, const char * prefix, int n) {
+	static const char * operators[] = { " + ", " - ", " * " };
+
+	if(depth == 0) {
+		if(next(3))
+			out << prefix << next(n);
+		else
+			out << next(100) + 1;
+
+		return;
+	}
+
+	out << "(";
+	expression(depth - 1, prefix, n);
+	out << operators[next(3)];
+	expression(depth - 1, prefix, n);
+	out << ")";
+}
+
+// Output a function of two arguments, which are copied to the locals
+// l0 and l1 so that their types are known
+void Generator::function(Shape & shape, int index) {
+	out << "f" << index << " : (a, b) --> {" << std::endl;
+	out << "\tl0 = a + 0." << std::endl;
+	out << "\tl1 = b + 0." << std::endl;
+
+	// Locals l2 and up are expressions of the earlier ones
+	for(int i = 2; i < 4; i++) {
+		out << "\tl" << i << " = ";
+		expression(shape.depth, "l", i);
+		out << "." << std::endl;
+	}
+
+	if(shape.nesting)
+		block(shape, 1, 1);
+
+	// Inline code every fourth function
+	if(shape.inline_size && index % 4 == 3) {
+		out << "\t@ {" << std::endl;
+
+		for(int i = 0; i < shape.inline_size; i++) {
+			int local = next(4);
+			out << "\t\tl" << local << " = l" << local << " + " << next(10) << ";" << std::endl;
+		}
+
+		out << "\t}" << std::endl;
+	}
+
+	out << "\tret l3." << std::endl;
+	out << "}" << std::endl << std::endl;
+}
+
+// Output an if statement containing the next level, returns are only
+// allowed directly inside the function or its outermost blocks
+void Generator::block(Shape & shape, int level, int indent) {
+	std::string tabs(indent, '\t');
+
+	out << tabs << "? l" << next(4) << " > " << next(50) << " --> {" << std::endl;
+	out << tabs << "\tl" << next(4) << " = ";
+	expression(shape.depth, "l", 4);
+	out << "." << std::endl;
+
+	if(level < shape.nesting)
+		block(shape, level + 1, indent + 1);
+
+	if(level == 1)
+		out << tabs << "\tret l" << next(4) << "." << std::endl;
+
+	out << tabs << "}" << std::endl;
+}
+
+// Output assignments of the globals and calls of each function
+void Generator::main(Shape & shape) {
+	out << "g0 = " << next(100) << "." << std::endl;
+
+	for(int i = 1; i < shape.identifiers; i++) {
+		out << "g" << i << " = ";
+		expression(shape.depth, "g", i);
+		out << "." << std::endl;
+	}
+
+	for(int i = 0; i < shape.functions; i++)
+		out << "g" << next(shape.identifiers) << " = f" << i << "(g" << next(shape.identifiers) << ", g" << next(shape.identifiers) << ")." << std::endl;
+}
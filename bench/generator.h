@@ -0,0 +1,75 @@
+/*
+ * generator.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#ifndef BENCH_GENERATOR_H_
+#define BENCH_GENERATOR_H_
+
+#include <cstdint>
+#include <string>
+#include <sstream>
+
+// Defines the shape of a generated program
+class Shape {
+
+public:
+	Shape(int functions, int depth, int identifiers, int inline_size, int nesting);
+
+	// Number of functions
+	int functions;
+
+	// Depth of the expression trees
+	int depth;
+
+	// Number of global variables
+	int identifiers;
+
+	// Lines of each inline C++ block, no blocks if 0
+	int inline_size;
+
+	// Depth of nested if statements in each function
+	int nesting;
+
+	// Name of the shape, for instance f64_d3_i32_b4_n2
+	std::string name();
+
+};
+
+// Generates synthetic DPL programs, the same shape and seed always give
+// the same program. Programs only use what the parser accepts: functions
+// call functions defined before them, calls start an expression and
+// arguments are copied to locals before they are compared.
+class Generator {
+
+public:
+	Generator(uint64_t seed = 1);
+
+	// Generate a program of [shape]
+	std::string generate(Shape & shape);
+
+private:
+	uint64_t seed;
+	uint64_t state;
+
+	std::ostringstream out;
+
+	// Next pseudo random number below [n]
+	int next(int n);
+
+	// Output an expression of [depth] over the names [prefix]0 to [prefix][n - 1]
+	void expression(int depth, const char * prefix, int n);
+
+	// Output a function
+	void function(Shape & shape, int index);
+
+	// Output nested if statements
+	void block(Shape & shape, int level, int indent);
+
+	// Output the global scope
+	void main(Shape & shape);
+};
+
+#endif /* BENCH_GENERATOR_H_ */
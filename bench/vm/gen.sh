@@ -0,0 +1,91 @@
+#!/bin/sh
+#
+# gen.sh
+#
+#  Created on: 19 oct. 2026
+#      Author: eatit
+#
+# Generate a DPL program for the VM benchmarks, the same kind and size
+# always produce the same program.
+#
+# Usage: gen.sh arith|branch|calls|blocks [statements]
+#
+
+kind=$1
+n=${2:-2000}
+
+awk -v kind="$kind" -v n="$n" '
+BEGIN {
+	print "print : (str) --> {"
+	print "\t@ {"
+	print "\t\tstd::cout << str << std::endl;"
+	print "\t}"
+	print "}"
+
+	# Chains of arithmetic on the previous values
+	if(kind == "arith") {
+		print "v0 = 7."
+		print "v1 = 3."
+		for(i = 2; i < n; i++)
+			printf "v%d = (v%d * %d + v%d - %d) / %d + %d.\n", i, i - 1, i % 7 + 2, i - 2, i % 13, i % 7 + 4, i % 11
+	}
+
+	# Clamping functions, each call takes a branch depending on its argument
+	else if(kind == "branch") {
+		for(f = 0; f < 4; f++) {
+			printf "clamp%d : (n) --> {\n", f
+			print "\tm = n + 0."
+			printf "\t? m > %d --> {\n", 40 + f * 10
+			printf "\t\tret m - %d.\n", 30 + f * 5
+			print "\t}"
+			printf "\t? m < %d && m > %d --> {\n", 10 + f, f
+			printf "\t\tret m * 2 + %d.\n", f
+			print "\t}"
+			printf "\tret m + %d.\n", 7 + f
+			print "}"
+		}
+		print "v0 = 1."
+		for(i = 1; i < n; i++)
+			printf "v%d = clamp%d(v%d).\n", i, i % 4, i - 1
+	}
+
+	# Functions calling the previous function
+	else if(kind == "calls") {
+		print "f0 : (n) --> {"
+		print "\tret n + 1."
+		print "}"
+		for(f = 1; f < 8; f++) {
+			printf "f%d : (n) --> {\n", f
+			printf "\tret f%d(n + %d).\n", f - 1, f
+			print "}"
+		}
+		print "v0 = 0."
+		for(i = 1; i < n / 10; i++)
+			printf "v%d = f7(v%d) - 60.\n", i, i - 1
+		n = int(n / 10)
+	}
+
+	# Functions whose blocks assign the variables of the function
+	else if(kind == "blocks") {
+		for(f = 0; f < 4; f++) {
+			printf "scale%d : (n) --> {\n", f
+			print "\tm = n + 0."
+			printf "\tl = (%d - m %% 7).\n", 42 + f
+			printf "\t? m %% 5 > %d --> {\n", f
+			printf "\t\tl = (l * 3 - %d).\n", 20 + f
+			print "\t}"
+			print "\tret l."
+			print "}"
+		}
+		print "v0 = 1."
+		for(i = 1; i < n; i++)
+			printf "v%d = scale%d(v%d + %d).\n", i, i % 4, i - 1, i % 9
+	}
+
+	else {
+		print "usage: gen.sh arith|branch|calls|blocks [statements]" > "/dev/stderr"
+		exit 1
+	}
+
+	printf "print(v%d).\n", n - 1
+}'
@@ -0,0 +1,69 @@
+#!/bin/sh
+#
+# run.sh
+#
+#  Created on: 19 oct. 2026
+#      Author: eatit
+#
+# Compare the bytecode VM with the tree-walking interpreter and with the
+# compiled C++ path on arithmetic, branching and call heavy programs, and on
+# blocks assigning the variables of their function.
+#
+# Usage: run.sh [dpl binary] [statements]
+#
+# The VM and the interpreter report the processor time of their execution
+# phase, the VM also the time it took to compile the bytecode. For C++ the
+# translation, g++ -O2 and the run of the binary are timed separately, in
+# wall clock milliseconds.
+#
+
+dpl=${1:-./dpl}
+n=${2:-5000}
+dir=$(dirname "$0")
+tmp=$(mktemp -d)
+
+trap 'rm -rf "$tmp"' EXIT
+
+now() {
+	date +%s%N
+}
+
+ms() {
+	echo $(( ($2 - $1) / 1000000 ))
+}
+
+# Processor time of phase [3] reported by dpl
+phase() {
+	"$dpl" --stats "$1" "$2" 2>&1 >/dev/null | awk -v phase="$3" '$1 == phase { print $3 }'
+}
+
+printf "%-8s %12s %10s %10s %12s %10s %10s\n" program "bytecode ms" "vm ms" "tree ms" "translate ms" "g++ ms" "binary ms"
+
+for kind in arith branch calls blocks; do
+	sh "$dir/gen.sh" $kind $n > "$tmp/$kind.dpl"
+
+	bytecode=$(phase --vm "$tmp/$kind.dpl" bytecode)
+	vm=$(phase --vm "$tmp/$kind.dpl" execution)
+	tree=$(phase --run "$tmp/$kind.dpl" execution)
+
+	t0=$(now)
+	"$dpl" "$tmp/$kind.dpl" > "$tmp/$kind.cpp" 2>/dev/null
+	t1=$(now)
+	g++ -std=c++17 -O2 -I "$dir/../../runtime" "$tmp/$kind.cpp" -o "$tmp/$kind" || exit 1
+	t2=$(now)
+	"$tmp/$kind" > /dev/null
+	t3=$(now)
+
+	# All three must agree
+	if [ "$("$dpl" --vm "$tmp/$kind.dpl" 2>/dev/null)" != "$("$tmp/$kind")" ]; then
+		echo "$kind: the VM and C++ outputs differ" >&2
+		exit 1
+	fi
+
+	if [ "$("$dpl" --run "$tmp/$kind.dpl" 2>/dev/null)" != "$("$tmp/$kind")" ]; then
+		echo "$kind: the interpreter and C++ outputs differ" >&2
+		exit 1
+	fi
+
+	printf "%-8s %12s %10s %10s %12s %10s %10s\n" $kind "$bytecode" "$vm" "$tree" $(ms $t0 $t1) $(ms $t1 $t2) $(ms $t2 $t3)
+done
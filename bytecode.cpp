@@ -0,0 +1,524 @@
+/*
+ * bytecode.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include <cstdlib>
+#include <cstring>
+
+#include "bytecode.h"
+#include "expression.h"
+#include "translator.h"
+#include "error.h"
+
+// Builtins
+#define BUILTIN_PRINT 1
+
+Chunk::Chunk(const char * name) {
+
+	this->name = name;
+	this->return_type = TOK_NULL;
+
+	memset(registers, 0, sizeof(registers));
+}
+
+// Delete the chunks, the names are those of the functions
+Bytecode::~Bytecode() {
+	for(auto chunk : chunks)
+		delete chunk;
+}
+
+BytecodeCompiler::BytecodeCompiler() {
+
+	this->program = NULL;
+	this->bytecode = NULL;
+	this->chunk = NULL;
+
+	memset(top, 0, sizeof(top));
+
+	// Define builtin functions
+	builtins["print"] = BUILTIN_PRINT;
+}
+
+// Compile a program, main is compiled into chunk 0
+Bytecode * BytecodeCompiler::compile(Program * program) {
+
+	this->program = static_cast<GlobalProgram *>(program);
+	this->bytecode = new Bytecode();
+
+	chunks.clear();
+	slots.clear();
+	memset(top, 0, sizeof(top));
+
+	// String constants share the indices of the literal table
+	bytecode->literals.reserve(this->program->strings->size());
+
+	for(auto & literal : *this->program->strings) {
+		bytecode->literals.push_back(Translator::unescape_string(literal.c_str()));
+
+		std::string & value = bytecode->literals.back();
+		bytecode->strings.push_back(dpl::string::interned(value.c_str(), value.size(), dpl::string(value.c_str(), value.size()).hash()));
+	}
+
+	chunk = new Chunk("main");
+	bytecode->chunks.push_back(chunk);
+
+	// A program that can not be run leaves nothing behind
+	try {
+		compile_program(program);
+	} catch(...) {
+		delete bytecode;
+		bytecode = NULL;
+		throw;
+	}
+
+	emit(OP_HALT);
+
+	return bytecode;
+}
+
+// Compile the instructions of a program
+void BytecodeCompiler::compile_program(Program * scope) {
+	for(auto ins : scope->get_instructions())
+		compile_instruction(scope, ins);
+}
+
+// Compile a single instruction, temporary registers are released afterwards
+void BytecodeCompiler::compile_instruction(Program * scope, Instruction * instruction) {
+	int saved[4];
+
+	memcpy(saved, top, sizeof(top));
+
+	switch(instruction->type) {
+
+	// Assign the variable the name refers to, a block assigns the variables
+	// of its function like the translation does
+	case TYPE_ASSIGNMENT: {
+		Assignment * assignment = static_cast<Assignment *>(instruction);
+		Variable * var = scope->resolve_variable(assignment->variable->name);
+		std::pair<int, int> value = compile_expression(scope, assignment->variable->value);
+		int type, reg;
+
+		if(value.first == TOK_NULL)
+			ERROR(T_CRIT, "assignment of a value of no type to %s.\n", var->name);
+
+		// Variables of unknown type get the type of their first value
+		type = (var->type == TOK_INT || var->type == TOK_FLOAT || var->type == TOK_STRING) ? var->type : value.first;
+
+		if(slots.count(var))
+			type = slots[var].first;
+
+		reg = convert(value, type);
+
+		// Temporaries are no longer needed, a new variable may reuse them
+		memcpy(top, saved, sizeof(top));
+
+		if(is_global(var))
+			emit(OP_SETI + type - TOK_INT, slots.at(var).second, reg);
+		else
+			emit(OP_MOVI + type - TOK_INT, slot(var, type).second, reg);
+
+		memcpy(saved, top, sizeof(top));
+		break;
+	}
+
+	case TYPE_RETURN: {
+		std::pair<int, int> value = compile_expression(scope, static_cast<ReturnOperation *>(instruction)->value);
+
+		// The first return operation decides an unknown return type
+		if(chunk->return_type == TOK_NULL)
+			chunk->return_type = value.first;
+
+		if(chunk->return_type == TOK_NULL)
+			emit(OP_RET);
+		else
+			emit(OP_RETI + chunk->return_type - TOK_INT, convert(value, chunk->return_type));
+
+		break;
+	}
+
+	case TYPE_IF_STATEMENT: {
+		IfStatement * statement = static_cast<IfStatement *>(instruction);
+		int jump = emit(OP_JZ, truth(compile_expression(scope, statement->expression)));
+
+		compile_program(statement->program);
+		chunk->code[jump].b = chunk->code.size();
+		break;
+	}
+
+	case TYPE_FUNCTIONCALL: {
+		FunctionCall * call = static_cast<FunctionCall *>(instruction);
+		std::vector<std::pair<int, int>> args;
+
+		for(auto arg : call->get_arguments())
+			args.push_back(compile_expression(scope, arg));
+
+		compile_call(call->function, args);
+		break;
+	}
+
+	case TYPE_INLINE_INJECTION:
+		ERROR(T_CRIT, "%s", "inline code in the global scope can not be run.\n");
+		break;
+	}
+
+	memcpy(top, saved, sizeof(top));
+}
+
+// Compile a function, arguments get the types of the values of the first call
+int BytecodeCompiler::compile_function(Function * function, std::vector<int> & types) {
+	Chunk * caller = chunk;
+	int saved[4];
+	int index;
+
+	auto it = chunks.find(function);
+
+	if(it != chunks.end())
+		return it->second;
+
+	memcpy(saved, top, sizeof(top));
+	memset(top, 0, sizeof(top));
+
+	chunk = new Chunk(function->name);
+	index = chunks[function] = bytecode->chunks.size();
+	bytecode->chunks.push_back(chunk);
+
+	int type = function->get_return_type();
+
+	if(type == TOK_INT || type == TOK_FLOAT || type == TOK_STRING)
+		chunk->return_type = type;
+
+	// Parameters are the first registers of each bank
+	for(size_t i = 0; i < types.size(); i++) {
+		Argument * arg = function->get_argument(i);
+
+		type = (arg->type == TOK_INT || arg->type == TOK_FLOAT || arg->type == TOK_STRING) ? arg->type : types[i];
+		chunk->parameters.push_back(std::make_pair(type, slot(arg, type).second));
+	}
+
+	compile_program(function);
+	emit(OP_RET);
+
+	chunk = caller;
+	memcpy(top, saved, sizeof(top));
+
+	return index;
+}
+
+// Compile an infix expression through its postfix form
+std::pair<int, int> BytecodeCompiler::compile_expression(Program * scope, std::vector<Token *> * infix) {
+	std::vector<Token *> * postfix;
+	std::vector<std::pair<int, int>> stack;
+	std::vector<size_t> rights;
+
+	// Jump over the right operand of each && and ||, by the index of the operator
+	std::unordered_map<size_t, int> jumps;
+
+	postfix = expr::infix_to_post(infix);
+	rights = expr::right_operands(postfix, program);
+
+	// An error leaves nothing behind
+	try {
+		for(size_t i = 0; i < postfix->size(); i++) {
+			Token * tok = (*postfix)[i];
+
+			// The left operand of && or || is done, the right one is skipped when it decides
+			if(rights[i]) {
+				int op = (*postfix)[rights[i]]->type;
+
+				stack.back() = compile_left(op, stack.back());
+				jumps[rights[i]] = emit(op == TOK_AND ? OP_JZ : OP_JNZ, stack.back().second);
+			}
+
+			switch(tok->type) {
+
+			case TOK_INT: {
+				int reg = allocate(TOK_INT);
+
+				emit(OP_LOADI, reg, (int) strtol(tok->value(), NULL, 10));
+				stack.push_back(std::make_pair(TOK_INT, reg));
+				break;
+			}
+
+			case TOK_FLOAT: {
+				int reg = allocate(TOK_FLOAT);
+
+				emit(OP_LOADF, reg, bytecode->floats.size());
+				bytecode->floats.push_back(strtof(tok->value(), NULL));
+				stack.push_back(std::make_pair(TOK_FLOAT, reg));
+				break;
+			}
+
+			case TOK_STRING: {
+				int reg = allocate(TOK_STRING);
+
+				emit(OP_LOADS, reg, program->get_string(tok->value()));
+				stack.push_back(std::make_pair(TOK_STRING, reg));
+				break;
+			}
+
+			case TOK_NAME: {
+				Variable * var = scope->resolve_variable(tok->value());
+
+				if(! var)
+					ERROR(T_CRIT, "undefined variable %s.\n", tok->value());
+
+				if(! slots.count(var))
+					ERROR(T_CRIT, "variable %s is used before it is assigned.\n", tok->value());
+
+				std::pair<int, int> value = slots[var];
+
+				// Globals are copied into the frame of the function
+				if(is_global(var)) {
+					int reg = allocate(value.first);
+
+					emit(OP_GETI + value.first - TOK_INT, reg, value.second);
+					value.second = reg;
+				}
+
+				stack.push_back(value);
+				break;
+			}
+
+			case TOK_CALL: {
+				Function * function = program->get_function(tok->value());
+				size_t n = function->get_arguments_size();
+				std::vector<std::pair<int, int>> args(stack.end() - n, stack.end());
+
+				stack.resize(stack.size() - n);
+				stack.push_back(compile_call(function, args));
+				break;
+			}
+
+			default: {
+				if(! expr::precedence(tok->type) || stack.size() < 2)
+					ERROR(T_CRIT, "unexpected '%s' in expression.\n", tok->value());
+
+				std::pair<int, int> b = stack.back();
+				stack.pop_back();
+
+				stack.back() = compile_operator(tok->type, stack.back(), b);
+
+				if(tok->type == TOK_AND || tok->type == TOK_OR)
+					chunk->code[jumps.at(i)].b = chunk->code.size();
+
+				break;
+			}
+
+			}
+		}
+	} catch(...) {
+		expr::release_post(postfix);
+		throw;
+	}
+
+	expr::release_post(postfix);
+
+	if(stack.size() != 1)
+		ERROR(T_CRIT, "%s", "faulty expression.\n");
+
+	return stack.back();
+}
+
+// Compile a call, the arguments are moved into the parameters of the callee
+std::pair<int, int> BytecodeCompiler::compile_call(Function * function, std::vector<std::pair<int, int>> & args) {
+	std::vector<int> types;
+	Chunk * callee;
+	int result;
+
+	// Functions with inline code only run if the VM implements them
+	if(function->has_inline_code()) {
+		auto it = builtins.find(function->name);
+
+		if(it == builtins.end())
+			ERROR(T_CRIT, "function %s contains inline code and can not be run.\n", function->name);
+
+		if(args.size() != 1 || args[0].first == TOK_NULL)
+			ERROR(T_CRIT, "invalid arguments to builtin %s.\n", function->name);
+
+		emit(OP_PRINTI + args[0].first - TOK_INT, args[0].second);
+		return std::make_pair(TOK_NULL, 0);
+	}
+
+	for(auto & arg : args)
+		types.push_back(arg.first);
+
+	callee = bytecode->chunks[compile_function(function, types)];
+
+	for(size_t i = 0; i < args.size(); i++) {
+		int type = callee->parameters[i].first;
+		emit(OP_PARAMI + type - TOK_INT, callee->parameters[i].second, convert(args[i], type));
+	}
+
+	result = callee->return_type == TOK_NULL ? 0 : allocate(callee->return_type);
+	emit(OP_CALL, compile_function(function, types), result);
+
+	return std::make_pair(callee->return_type, result);
+}
+
+// Compile a binary operator, ints are promoted to floats like in C++
+std::pair<int, int> BytecodeCompiler::compile_operator(int op, std::pair<int, int> a, std::pair<int, int> b) {
+	int type, code, reg;
+
+	if(a.first == TOK_NULL || b.first == TOK_NULL)
+		ERROR(T_CRIT, "%s", "operation on a value of no type.\n");
+
+	// Logical and or or, the left operand is already in the register of
+	// the result, see compile_left
+	if(op == TOK_AND || op == TOK_OR) {
+		emit(op == TOK_AND ? OP_AND : OP_OR, a.second, a.second, truth(b));
+		return a;
+	}
+
+	// Strings are concatenated and compared
+	if(a.first == TOK_STRING || b.first == TOK_STRING) {
+		if(a.first != b.first)
+			ERROR(T_CRIT, "%s", "operation on a string and a number.\n");
+
+		switch(op) {
+		case TOK_PLUS: code = OP_CATS; break;
+		case TOK_LESSER: code = OP_LTS; break;
+		case TOK_LESSER_EQUAL: code = OP_LES; break;
+		case TOK_GREATER: code = OP_GTS; break;
+		case TOK_GREATER_EQUAL: code = OP_GES; break;
+		case TOK_EQUAL_EQUAL: code = OP_EQS; break;
+		default:
+			ERROR(T_CRIT, "%s", "invalid operation on strings.\n");
+			return a;
+		}
+
+		reg = allocate(code == OP_CATS ? TOK_STRING : TOK_INT);
+		emit(code, reg, a.second, b.second);
+
+		return std::make_pair(code == OP_CATS ? TOK_STRING : TOK_INT, reg);
+	}
+
+	type = (a.first == TOK_FLOAT || b.first == TOK_FLOAT) ? TOK_FLOAT : TOK_INT;
+	a.second = convert(a, type);
+	b.second = convert(b, type);
+
+	// Float opcodes follow the int opcodes of each group
+	switch(op) {
+	case TOK_PLUS: code = OP_ADDI; break;
+	case TOK_MINUS: code = OP_SUBI; break;
+	case TOK_MULT: code = OP_MULI; break;
+	case TOK_DIV: code = OP_DIVI; break;
+	case TOK_MOD: code = OP_MODI; break;
+	case TOK_LESSER: code = OP_LTI; break;
+	case TOK_LESSER_EQUAL: code = OP_LEI; break;
+	case TOK_GREATER: code = OP_GTI; break;
+	case TOK_GREATER_EQUAL: code = OP_GEI; break;
+	case TOK_EQUAL_EQUAL: code = OP_EQI; break;
+	default:
+		ERROR(T_CRIT, "%s", "invalid operator.\n");
+		return a;
+	}
+
+	if(type == TOK_FLOAT)
+		code += IS_COMPARISON(op) ? OP_LTF - OP_LTI : OP_ADDF - OP_ADDI;
+
+	type = IS_COMPARISON(op) ? TOK_INT : type;
+	reg = allocate(type);
+	emit(code, reg, a.second, b.second);
+
+	return std::make_pair(type, reg);
+}
+
+// Compile the left operand of && or || into the register of the result,
+// which holds its truth as 0 or 1 when the right operand is skipped
+std::pair<int, int> BytecodeCompiler::compile_left(int op, std::pair<int, int> a) {
+	int reg, cond;
+
+	if(a.first == TOK_NULL)
+		ERROR(T_CRIT, "%s", "operation on a value of no type.\n");
+
+	reg = allocate(TOK_INT);
+	cond = truth(a);
+	emit(op == TOK_AND ? OP_AND : OP_OR, reg, cond, cond);
+
+	return std::make_pair(TOK_INT, reg);
+}
+
+// Convert a value between number types
+int BytecodeCompiler::convert(std::pair<int, int> value, int type) {
+	int reg;
+
+	if(value.first == type)
+		return value.second;
+
+	if(value.first == TOK_STRING || type == TOK_STRING || value.first == TOK_NULL)
+		ERROR(T_CRIT, "%s", "conversion between strings and numbers.\n");
+
+	reg = allocate(type);
+	emit(type == TOK_FLOAT ? OP_ITOF : OP_FTOI, reg, value.second);
+
+	return reg;
+}
+
+// Return an int register that is nonzero if [value] is true
+int BytecodeCompiler::truth(std::pair<int, int> value) {
+	int reg;
+
+	if(value.first == TOK_INT)
+		return value.second;
+
+	if(value.first != TOK_FLOAT)
+		ERROR(T_CRIT, "%s", "condition is not a number.\n");
+
+	reg = allocate(TOK_INT);
+	emit(OP_TRUTHF, reg, value.second);
+
+	return reg;
+}
+
+// Return the slot of a variable, a new variable gets a register of [type]
+std::pair<int, int> & BytecodeCompiler::slot(Variable * variable, int type) {
+	auto it = slots.find(variable);
+
+	if(it != slots.end())
+		return it->second;
+
+	return slots[variable] = std::make_pair(type, allocate(type));
+}
+
+// Whether [variable] is a global accessed from a function
+int BytecodeCompiler::is_global(Variable * variable) {
+	if(chunk == bytecode->chunks[0])
+		return 0;
+
+	auto it = program->variables->find(variable->name);
+
+	if(it == program->variables->end() || it->second != variable)
+		return 0;
+
+	if(! slots.count(variable))
+		ERROR(T_CRIT, "global %s is used before it is assigned.\n", variable->name);
+
+	return 1;
+}
+
+// Allocate a register of [type] in the current chunk
+int BytecodeCompiler::allocate(int type) {
+	int reg = top[type]++;
+
+	if(top[type] > chunk->registers[type])
+		chunk->registers[type] = top[type];
+
+	return reg;
+}
+
+// Append an instruction to the current chunk
+int BytecodeCompiler::emit(int code, int a, int b, int c) {
+	Op op;
+
+	op.code = code;
+	op.a = a;
+	op.b = b;
+	op.c = c;
+
+	chunk->code.push_back(op);
+
+	return chunk->code.size() - 1;
+}
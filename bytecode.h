@@ -0,0 +1,205 @@
+/*
+ * bytecode.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ *
+ * Register bytecode run by the VM. Every function, and main, is compiled
+ * into a chunk with three banks of typed registers: ints, floats and
+ * strings. The bank an operand refers to is given by the opcode, so no
+ * value carries a type tag at run time.
+ */
+
+#ifndef BYTECODE_H_
+#define BYTECODE_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "mem/program.h"
+#include "mem/function.h"
+#include "runtime/dpl_string.h"
+
+// Opcodes, a is the destination unless stated otherwise
+#define OP_HALT 0
+#define OP_LOADI 1		// a = immediate b
+#define OP_LOADF 2		// a = float constant b
+#define OP_LOADS 3		// a = string constant b
+#define OP_MOVI 4		// a = b
+#define OP_MOVF 5
+#define OP_MOVS 6
+#define OP_GETI 7		// a = global b
+#define OP_GETF 8
+#define OP_GETS 9
+#define OP_SETI 10		// global a = b
+#define OP_SETF 11
+#define OP_SETS 12
+#define OP_ADDI 13		// a = b + c
+#define OP_SUBI 14
+#define OP_MULI 15
+#define OP_DIVI 16
+#define OP_MODI 17
+#define OP_ADDF 18
+#define OP_SUBF 19
+#define OP_MULF 20
+#define OP_DIVF 21
+#define OP_MODF 22
+#define OP_CATS 23
+#define OP_LTI 24		// int a = b < c
+#define OP_LEI 25
+#define OP_GTI 26
+#define OP_GEI 27
+#define OP_EQI 28
+#define OP_LTF 29
+#define OP_LEF 30
+#define OP_GTF 31
+#define OP_GEF 32
+#define OP_EQF 33
+#define OP_LTS 34
+#define OP_LES 35
+#define OP_GTS 36
+#define OP_GES 37
+#define OP_EQS 38
+#define OP_AND 39		// int a = b && c
+#define OP_OR 40
+#define OP_TRUTHF 41	// int a = float b != 0
+#define OP_ITOF 42		// float a = int b
+#define OP_FTOI 43		// int a = float b
+#define OP_JMP 44		// jump to a
+#define OP_JZ 45		// jump to b if int a is zero
+#define OP_JNZ 46		// jump to b if int a is not zero
+#define OP_PARAMI 47	// parameter a of the next call = b
+#define OP_PARAMF 48
+#define OP_PARAMS 49
+#define OP_CALL 50		// call chunk a, the result is stored in b
+#define OP_RETI 51		// return a
+#define OP_RETF 52
+#define OP_RETS 53
+#define OP_RET 54		// return without a value
+#define OP_PRINTI 55	// print a
+#define OP_PRINTF 56
+#define OP_PRINTS 57
+
+#define OP_COUNT 58
+
+// Defines a single bytecode instruction
+class Op {
+
+public:
+	int code;
+	int a;
+	int b;
+	int c;
+
+};
+
+// Defines the bytecode of a function, or of main
+class Chunk {
+
+public:
+	Chunk(const char * name);
+
+	// The name of the function
+	const char * name;
+
+	// The instructions
+	std::vector<Op> code;
+
+	// Number of registers in each bank, indexed by TOK_INT, TOK_FLOAT and TOK_STRING
+	int registers[4];
+
+	// Type and register of each parameter
+	std::vector<std::pair<int, int>> parameters;
+
+	// Type of the return value, TOK_NULL if none
+	int return_type;
+
+};
+
+// Defines a compiled program, chunk 0 is main and its registers are the globals
+class Bytecode {
+
+public:
+	~Bytecode();
+
+	std::vector<Chunk *> chunks;
+
+	// Constants
+	std::vector<float> floats;
+	std::vector<dpl::string> strings;
+
+	// Characters of the string constants
+	std::vector<std::string> literals;
+
+};
+
+// Compiles a parsed program into bytecode
+class BytecodeCompiler {
+
+public:
+	BytecodeCompiler();
+
+	// Compile a program, each function is compiled at its first call
+	Bytecode * compile(Program * program);
+
+private:
+	GlobalProgram * program;
+	Bytecode * bytecode;
+
+	// Chunk being compiled
+	Chunk * chunk;
+
+	// First free register of each bank in the current chunk
+	int top[4];
+
+	// Index of the chunk of each compiled function
+	std::unordered_map<Function *, int> chunks;
+
+	// Register and type of each variable
+	std::unordered_map<Variable *, std::pair<int, int>> slots;
+
+	// Functions implemented by the VM
+	std::unordered_map<std::string, int> builtins;
+
+	// Compile the instructions of a program
+	void compile_program(Program * scope);
+
+	// Compile a single instruction in [scope]
+	void compile_instruction(Program * scope, Instruction * instruction);
+
+	// Compile a function for arguments of [types], return the chunk index
+	int compile_function(Function * function, std::vector<int> & types);
+
+	// Compile an infix expression, return the type and register of its value
+	std::pair<int, int> compile_expression(Program * scope, std::vector<Token *> * infix);
+
+	// Compile a call with the values in [args], return the type and register of the result
+	std::pair<int, int> compile_call(Function * function, std::vector<std::pair<int, int>> & args);
+
+	// Compile a binary operator
+	std::pair<int, int> compile_operator(int op, std::pair<int, int> a, std::pair<int, int> b);
+
+	// Compile [a], the left operand of && or || [op], into the register of the result
+	std::pair<int, int> compile_left(int op, std::pair<int, int> a);
+
+	// Return a register holding [value] converted to [type]
+	int convert(std::pair<int, int> value, int type);
+
+	// Return a register holding the truth of [value]
+	int truth(std::pair<int, int> value);
+
+	// Return the slot of a variable, allocated with [type] if new
+	std::pair<int, int> & slot(Variable * variable, int type);
+
+	// Whether a variable is a global read from a function
+	int is_global(Variable * variable);
+
+	// Allocate a register of [type]
+	int allocate(int type);
+
+	// Append an instruction, return its index
+	int emit(int code, int a = 0, int b = 0, int c = 0);
+};
+
+#endif /* BYTECODE_H_ */
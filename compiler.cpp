@@ -7,75 +7,452 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "compiler.h"
 #include "error.h"
 
-#define READ_FILE_ERROR 1
-
 Compiler::Compiler() {
 
 	this->parser = new Parser();
+	this->purity = new Purity();
+	this->subexpressions = new CSE();
+	this->modules = new ModuleGraph();
 	this->translator = new Translator();
+	this->llvm_translator = new LLVMTranslator();
+	this->interpreter = new Interpreter();
+	this->bytecode_compiler = new BytecodeCompiler();
+	this->vm = NULL;
 	this->buffer = NULL;
 	this->program = NULL;
+	this->base = NULL;
+	this->bytecode = NULL;
+	this->diagnostics = new Diagnostics();
+	this->open_phases = 0;
+	this->buffer_size = 0;
+	this->prelude_buffer = NULL;
+	this->prelude_size = 0;
+	this->prelude = NULL;
 
 }
 
+// The last program is released after its compilation, the prelude is freed here
 Compiler::~Compiler() {
-	// TODO Auto-generated destructor stub
+	release_program();
+	delete modules;
+
+	if(prelude) {
+		prelude->release_on(NULL);
+		delete prelude;
+	}
+
+	delete parser;
+	delete purity;
+	delete subexpressions;
+	delete translator;
+	delete llvm_translator;
+	delete interpreter;
+	delete bytecode_compiler;
+	delete vm;
+	delete diagnostics;
+
+	if(buffer)
+		munmap(buffer, buffer_size + 1);
+
+	if(prelude_buffer)
+		munmap(prelude_buffer, prelude_size + 1);
 }
 
-// Compile a file specified by the argument
+// Compile a file specified by the argument to standard output
 int Compiler::compile(char * file_name) {
+
+	// The last file stays mapped until the next one, for its diagnostics
+	if(buffer)
+		munmap(buffer, buffer_size + 1);
+
+	buffer = NULL;
+	diagnostics->clear();
+	diagnostics->file_name = file_name;
+
+	begin_phase("read");
+
+	// Fetch code file
+	this->buffer = this->read_file(file_name, buffer_size);
+
+	end_phase();
+
+	if(! buffer) {
+		Diagnostic diagnostic(T_CRIT, "failed to read from file %s.", file_name);
+
+		diagnostics->add(diagnostic, 0, 0, 0);
+		return 0;
+	}
+
+	return compile(file_name, buffer, std::cout);
+}
+
+// Parse the prelude with the settings of the compiler, it is kept for good
+int Compiler::load_prelude(char * file_name) {
+	GlobalProgram * parsed;
+
+	diagnostics->clear();
+	diagnostics->file_name = file_name;
+
+	if(! (prelude_buffer = read_file(file_name, prelude_size))) {
+		Diagnostic diagnostic(T_CRIT, "failed to read from file %s.", file_name);
+
+		diagnostics->add(diagnostic, 0, 0, 0);
+		return 0;
+	}
+
+	diagnostics->source = prelude_buffer;
+	diagnostics->line_start = 0;
+
+	parser->set_diagnostics(diagnostics);
+	parser->set_prelude(NULL);
+	parser->set_line_start(0);
+	parser->set_input_code(prelude_buffer);
+
+	try {
+		parsed = static_cast<GlobalProgram *>(parser->parse());
+	} catch(std::exception & e) {
+		Diagnostic diagnostic(T_CRIT, "internal compiler error: %s.", e.what());
+
+		diagnostics->add(diagnostic, 0, 0, 0);
+		return 0;
+	}
+
+	// A prelude with errors is not kept
+	if(diagnostics->errors()) {
+		parsed->release_on(NULL);
+		delete parsed;
+		return 0;
+	}
+
+	parser->set_prelude(parsed);
+	prelude = parsed;
+	return 1;
+}
+
+// Compile source code to a stream, return 0 if there were errors
+int Compiler::compile(const char * name, const char * source, std::ostream & output) {
+	diagnostics->clear();
+	diagnostics->file_name = name;
+
+	// Lines are only looked up in the source for diagnostics that are output
+	diagnostics->source = source;
+	diagnostics->line_start = line_start;
+
 	try {
-		// Fetch code file
-		this->buffer = this->read_file(file_name);
-	} catch(int e) {
-		ERROR(T_CRIT, "failed to read from file %s.", file_name);
+		compile_source(name, source, output);
+	} catch(Diagnostic & diagnostic) {
+		diagnostics->add(diagnostic, 0, 0, 0);
+	}
+
+	// Anything else is a fault of the compiler, which fails this source only
+	catch(std::exception & e) {
+		Diagnostic diagnostic(T_CRIT, "internal compiler error: %s.", e.what());
+
+		diagnostics->add(diagnostic, 0, 0, 0);
+	}
+
+	// Phases an error was thrown in end with it
+	while(open_phases)
+		end_phase();
+
+	release_program();
+
+	return ! diagnostics->errors();
+}
+
+// Nothing of the program is kept after its compilation, the prelude stays
+void Compiler::release_program() {
+	delete bytecode;
+	bytecode = NULL;
+
+	if(program) {
+		static_cast<GlobalProgram *>(program)->release_on(base);
+		delete program;
 	}
 
-	std::cerr << "INFO:\n" << std::endl;
+	program = NULL;
+	base = NULL;
+
+	parser->release_tokens();
+}
+
+// Run the phases of a compilation, errors are thrown or collected in diagnostics
+void Compiler::compile_source(const char * name, const char * source, std::ostream & output) {
+	CountingBuffer counted(output.rdbuf());
+	std::ostream counting(&counted);
+
+	// Count the bytes of the translation on its way to the output
+	std::ostream * out = stats ? &counting : &output;
+
+	if(stats)
+		stats->count("source_bytes", strlen(source));
+
+	fallback_output.clear();
+	fallback_path.clear();
+
+	// Pass buffer to parser and parse the file, lexing is timed inside parsing
+	parser->set_stats(stats);
+	parser->set_trace(trace);
+	parser->set_diagnostics(diagnostics);
+	parser->set_jobs(jobs);
+	translator->set_trace(trace);
+	translator->set_output(out);
+	translator->set_keep_functions(keep_functions);
+	llvm_translator->set_trace(trace);
+	llvm_translator->set_output(out);
+
+	begin_phase("parse");
 
-	// Pass buffer to parser and parse the file
 	this->parser->set_line_start(this->line_start);
-	this->parser->set_input_code(this->buffer);
-	program = this->parser->parse();
+	this->parser->set_input_code(source);
 
-	translator->translate(program);
+	// Modules are parsed first, and the source on top of them
+	if(! modules->build(name, source, line_start, diagnostics))
+		return;
 
-	return 1;
+	// Functions are translated while the rest of the source is parsed
+	if(stream && backend == BACKEND_CPP && ! prelude && modules->modules.empty()) {
+		stream_source(out);
+		end_phase();
+
+		if(stats)
+			stats->count("bytes_emitted", counted.bytes);
+
+		return;
+	}
+
+	if(modules->modules.size()) {
+		parser->restore_prelude();
+
+		if(! (base = modules->parse(prelude, diagnostics)))
+			return;
+
+		if(stats)
+			stats->count("modules", modules->modules.size());
+
+		parser->set_module_order(modules->source_order());
+		program = parser->parse_on(base);
+	}
+
+	else {
+		parser->set_module_order(0);
+		program = parser->parse();
+		base = prelude;
+	}
+
+	end_phase();
+
+	// The parser recovered from its errors to find the others, but the program is not complete
+	if(diagnostics->errors())
+		return;
+
+	// What the functions read and change, which the passes and the
+	// translations after it depend on
+	begin_phase("purity");
+	purity->analyse(static_cast<GlobalProgram *>(program));
+	end_phase();
+
+	if(stats)
+		for(auto & function : *static_cast<GlobalProgram *>(program)->functions)
+			stats->count((std::string("functions_") + Purity::name(function.second->purity)).c_str());
+
+	if(cse) {
+		begin_phase("cse");
+
+		int temporaries = subexpressions->eliminate(static_cast<GlobalProgram *>(program));
+
+		end_phase();
+
+		if(stats)
+			stats->count("cse_temporaries", temporaries);
+	}
+
+	if(stats)
+		count_nodes(program);
+
+	if(backend == BACKEND_RUN) {
+		begin_phase("execution");
+		interpreter->run(program);
+	}
+
+	else if(backend == BACKEND_VM) {
+		begin_phase("bytecode");
+
+		bytecode = bytecode_compiler->compile(program);
+
+		// The registers of the VM are only allocated when needed
+		if(! vm)
+			vm = new VM();
+
+		end_phase();
+
+		if(stats)
+			for(auto chunk : bytecode->chunks)
+				stats->count("bytecode_ops", chunk->code.size());
+
+		begin_phase("execution");
+		vm->run(bytecode);
+	}
+
+	else if(backend == BACKEND_LLVM) {
+		std::ostringstream fallback;
+
+		begin_phase("translate");
+
+		llvm_translator->set_fallback_output(&fallback);
+
+		if(! llvm_translator->translate(program)) {
+			Diagnostic diagnostic(*llvm_translator->error);
+
+			diagnostics->add(diagnostic, 0, 0, 0);
+			return;
+		}
+
+		// Only programs with inline code need the C++ fallback
+		if(llvm_translator->has_fallback()) {
+			fallback_path = fallback_file.empty() ? std::string(name) + ".inline.cpp" : fallback_file;
+			fallback_output = fallback.str();
+
+			std::ofstream file(fallback_path);
+
+			if(! file)
+				ERROR(T_CRIT, "failed to write to file %s.", fallback_path.c_str());
+
+			file << fallback_output;
+
+			if(stats)
+				stats->count("fallback_bytes", fallback_output.size());
+		}
+	}
+
+	else {
+		begin_phase("translate");
+		translator->translate(program);
+	}
+
+	out->flush();
+	end_phase();
+
+	if(stats && (backend == BACKEND_CPP || backend == BACKEND_LLVM))
+		stats->count("bytes_emitted", counted.bytes);
 }
 
-/* Opens a file and reads the content into a buffer
- * Throws an error if file could not be opened
- */
-char * Compiler::read_file(char * file_name) {
-	FILE * file_stream;
-	char * buffer, * pbuffer;
+// Hand the functions of the source to a translator thread as they are parsed
+int Compiler::stream_source(std::ostream * out) {
+	FunctionStream functions;
+	std::thread translating(&Translator::translate_stream, translator, &functions);
+
+	parser->set_module_order(0);
+	parser->set_stream(&functions);
+
+	// The translator has to be stopped before an error leaves the compilation
+	try {
+		program = parser->parse();
+	} catch(...) {
+		parser->set_stream(NULL);
+		functions.close(NULL);
+		translating.join();
+		throw;
+	}
 
-	if(! (file_stream = fopen(file_name, "r")))
-		throw READ_FILE_ERROR;
+	parser->set_stream(NULL);
 
-	buffer = (char *) malloc(200 * sizeof(char));
-	pbuffer = buffer;
+	// Main is only written for a source without errors
+	functions.close(diagnostics->errors() ? NULL : static_cast<GlobalProgram *>(program));
+	translating.join();
+
+	out->flush();
+
+	if(stats)
+		stats->count("stream_peak_functions", functions.peak);
+
+	return ! diagnostics->errors();
+}
+
+// Start timing and tracing a phase
+void Compiler::begin_phase(const char * name) {
+	open_phases++;
+
+	if(stats)
+		stats->begin(name);
+
+	if(trace)
+		trace->begin(name, "phase");
+}
 
-	int n_total_read = 0;
-	int n_read = 0;
-	int i = 1;
+// End the innermost phase
+void Compiler::end_phase() {
+	open_phases--;
+
+	if(stats)
+		stats->end();
+
+	if(trace)
+		trace->end();
+}
+
+// Count the functions, variables and instructions of a program and its blocks
+void Compiler::count_nodes(Program * program) {
+	if(program == this->program) {
+		auto functions = static_cast<GlobalProgram *>(program)->functions;
+
+		stats->count("functions", functions->size());
+
+		for(auto & function : *functions)
+			count_nodes(function.second);
+	}
+
+	stats->count("variables", program->variables->size());
+	stats->count("instructions", program->get_instructions().size());
+
+	for(auto ins : program->get_instructions())
+		if(ins->type == TYPE_IF_STATEMENT)
+			count_nodes(static_cast<IfStatement *>(ins)->program);
+}
+
+/* Maps a file into memory, followed by a '\0'
+ * Returns NULL if file could not be opened
+ */
+char * Compiler::read_file(char * file_name, size_t & size) {
+	struct stat info;
+	char * buffer;
+	int fd;
+
+	if((fd = open(file_name, O_RDONLY)) < 0)
+		return NULL;
+
+	if(fstat(fd, &info) < 0) {
+		close(fd);
+		return NULL;
+	}
 
-	while((n_read = fread(pbuffer, sizeof(char), 200, file_stream)) == 200) {
-		n_total_read += n_read;
+	// Anonymous memory one byte longer than the file, which the file is mapped over,
+	// so that the byte after it is '\0' even when the file ends on a page boundary
+	buffer = (char *) mmap(NULL, info.st_size + 1, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 
-		buffer = (char *) realloc(buffer, ++i * 200 * sizeof(char) + 1);
-		pbuffer = buffer + n_total_read;
+	if(buffer == MAP_FAILED
+			|| (info.st_size && mmap(buffer, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)) {
+		close(fd);
+		return NULL;
 	}
 
-	n_total_read += n_read;
-	buffer[n_total_read] = '\0';
+	close(fd);
 
-	fclose(file_stream);
+	size = info.st_size;
 	return buffer;
 }
@@ -8,9 +8,28 @@
 #ifndef COMPILER_H_
 #define COMPILER_H_
 
+#include <string>
+#include <ostream>
+
 #include "parser.h"
+#include "purity.h"
+#include "cse.h"
+#include "module.h"
 #include "mem/program.h"
 #include "translator.h"
+#include "llvm_translator.h"
+#include "interpreter.h"
+#include "bytecode.h"
+#include "vm.h"
+#include "stats.h"
+#include "trace.h"
+#include "error.h"
+
+// Backends
+#define BACKEND_CPP 1
+#define BACKEND_LLVM 2
+#define BACKEND_RUN 3
+#define BACKEND_VM 4
 
 class Compiler {
 
@@ -18,22 +37,115 @@ public:
 	Compiler();
 	virtual ~Compiler();
 
-	// Called to compile a source dpl file
+	// Called to compile a source dpl file, return 0 if there were errors
 	int compile(char * file_name);
 
+	// Parse a file once, which every source is then compiled on top of,
+	// instead of being pasted in front of each. Return 0 if there were errors.
+	int load_prelude(char * file_name);
+
+	// Compile [source] to [output], [name] is the file name of diagnostics.
+	// A Compiler may compile any number of sources, one at a time, and
+	// keeps nothing in between but stats and trace. Return 0 if there were
+	// errors, which are left in diagnostics until the next compilation.
+	int compile(const char * name, const char * source, std::ostream & output);
+
 	// Line start
 	int line_start = 0;
 
+	// Backend that the program is translated with
+	int backend = BACKEND_CPP;
+
+	// File that the LLVM backend writes C++ for inline code to,
+	// the source file name followed by .inline.cpp if empty
+	std::string fallback_file;
+
+	// C++ for inline code of the last LLVM translation and the file it
+	// was written to, both empty if the program had none
+	std::string fallback_output;
+	std::string fallback_path;
+
+	// Keep the C++ of each function between compilations, and write a
+	// function that is translated the same from it. Not for streams.
+	int keep_functions = 0;
+
+	// Translate each function to C++ on another thread as soon as it is
+	// parsed, and free it once it is written, instead of translating the
+	// whole program after parsing. Only for the C++ backend and sources
+	// without a prelude or imports, the parse phase includes translation.
+	int stream = 0;
+
+	// Function bodies parsed at the same time, 0 for one per hardware
+	// thread. Modules parse their bodies one at a time.
+	int jobs = 0;
+
+	// Compute the subexpressions that a function body repeats once, in
+	// temporaries. Not done when streaming, a function is translated as
+	// soon as it is parsed.
+	int cse = 1;
+
+	// Timers and counters of the compilation, not collected if NULL
+	Stats * stats = NULL;
+
+	// Spans of the phases and of each function, not recorded if NULL
+	Trace * trace = NULL;
+
+	// Errors and warnings of the compilation
+	Diagnostics * diagnostics;
+
 private:
 	Parser * parser;
+	Purity * purity;
+	CSE * subexpressions;
+	ModuleGraph * modules;
 	Translator * translator;
+	LLVMTranslator * llvm_translator;
+	Interpreter * interpreter;
+	BytecodeCompiler * bytecode_compiler;
+	VM * vm;
+
+	// Mapped file of the last compile(file_name)
 	char * buffer;
+	size_t buffer_size;
 
-	// Main program
+	// Mapped file of the prelude, NULL if there is none
+	char * prelude_buffer;
+	size_t prelude_size;
+
+	// Main program, and the program it was parsed on, the prelude or the
+	// modules, NULL if neither
 	Program * program;
+	GlobalProgram * base;
+
+	// Bytecode of the program for the VM
+	Bytecode * bytecode;
+
+	// Prelude, NULL if there is none
+	GlobalProgram * prelude;
+
+	// Phases begun and not yet ended
+	int open_phases;
+
+	// Run the phases of the compilation
+	void compile_source(const char * name, const char * source, std::ostream & output);
+
+	// Free the program of the source and what the backends made of it
+	void release_program();
+
+	// Parse the source while a translator thread writes each function
+	// to [out], return 0 if there were errors
+	int stream_source(std::ostream * out);
+
+	// Map a file into memory as a string and set [size] to its length,
+	// return NULL if it could not be read
+	char * read_file(char * file_name, size_t & size);
+
+	// Count the nodes of [program] in stats
+	void count_nodes(Program * program);
 
-	// Open a file and put the contents in a buffer, might throw an error
-	char * read_file(char * file_name);
+	// Start and end a phase in stats and trace
+	void begin_phase(const char * name);
+	void end_phase();
 
 
 };
@@ -0,0 +1,466 @@
+/*
+ * cse.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include <cstring>
+
+#include "cse.h"
+#include "lexer.h"
+#include "expression.h"
+
+CSE::CSE() {
+
+	this->program = NULL;
+	this->tokens = NULL;
+	this->scope = NULL;
+	this->conditional = 0;
+	this->broken = 0;
+}
+
+// Nothing is changed before an instruction is looked at
+Effect::Effect() {
+	this->globals = 0;
+	this->all = 0;
+}
+
+// Eliminate the subexpressions of the functions of the source
+int CSE::eliminate(GlobalProgram * program) {
+	int temporaries = 0;
+
+	this->program = program;
+
+	// Functions of a prelude or a module have the arguments of another source
+	for(auto & function : *program->functions)
+		if(function.second->parent_program == program)
+			temporaries += eliminate(function.second);
+
+	return temporaries;
+}
+
+// Scan the instructions of the body, hoist the longest repeated subexpression
+// and scan again, until nothing is repeated
+int CSE::eliminate(Function * function) {
+	std::vector<Occurrence> occurrences, repeated;
+	std::vector<Effect> effects;
+	int n = 0;
+
+	while(1) {
+		auto & instructions = function->get_instructions();
+
+		occurrences.clear();
+		effects.assign(instructions.size(), Effect());
+
+		for(size_t i = 0; i < instructions.size(); i++) {
+			auto list = expressions(instructions[i]);
+
+			for(size_t e = 0; e < list.size(); e++) {
+				if(! list[e])
+					continue;
+
+				scan(list[e], function);
+
+				for(auto & operand : found) {
+					Occurrence occurrence;
+
+					occurrence.instruction = i;
+					occurrence.expression = e;
+					occurrence.tokens = list[e];
+					occurrence.operand = operand;
+
+					for(size_t t = operand.begin; t < operand.end; t++) {
+						occurrence.key += (char) (*list[e])[t]->type;
+						occurrence.key += (*list[e])[t]->value();
+						occurrence.key += '\0';
+					}
+
+					occurrences.push_back(occurrence);
+				}
+			}
+
+			add_effect(instructions[i], effects[i]);
+		}
+
+		if(! find_repeated(occurrences, effects, repeated))
+			break;
+
+		hoist(function, repeated, n++);
+	}
+
+	return n;
+}
+
+// Split the occurrences of each subexpression where its value may change,
+// and keep the longest part with more than one occurrence, the first one
+// of the body if several are as long
+int CSE::find_repeated(std::vector<Occurrence> & occurrences, std::vector<Effect> & effects, std::vector<Occurrence> & repeated) {
+	std::unordered_map<std::string, std::vector<size_t>> keys;
+	size_t longest = 0, earliest = 0;
+
+	repeated.clear();
+
+	for(size_t i = 0; i < occurrences.size(); i++)
+		keys[occurrences[i].key].push_back(i);
+
+	for(auto & key : keys) {
+		auto & list = key.second;
+		size_t first = 0;
+
+		for(size_t j = 1; j <= list.size(); j++) {
+			if(j < list.size() && same_value(occurrences[list[first]], occurrences[list[j]], effects))
+				continue;
+
+			Occurrence & occurrence = occurrences[list[first]];
+			size_t length = occurrence.operand.end - occurrence.operand.begin;
+
+			if(j - first > 1 && (length > longest || (length == longest && list[first] < earliest))) {
+				longest = length;
+				earliest = list[first];
+				repeated.clear();
+
+				for(size_t k = first; k < j; k++)
+					repeated.push_back(occurrences[list[k]]);
+			}
+
+			first = j;
+		}
+	}
+
+	return ! repeated.empty();
+}
+
+// The value is the same if nothing the subexpression reads is changed from
+// the first occurrence to the instruction of the other, and within one
+// instruction if it calls nothing that may change the globals it reads
+int CSE::same_value(Occurrence & from, Occurrence & to, std::vector<Effect> & effects) {
+	size_t last = to.instruction > from.instruction ? to.instruction : from.instruction + 1;
+
+	for(size_t i = from.instruction; i < last; i++) {
+		Effect & effect = effects[i];
+
+		if(effect.all || (effect.globals && to.operand.global))
+			return 0;
+
+		// Same instruction, what it assigns is assigned after it is computed
+		if(i == to.instruction)
+			continue;
+
+		for(size_t t = to.operand.begin; t < to.operand.end; t++) {
+			Token * tok = (*to.tokens)[t];
+
+			if(tok->type == TOK_NAME && (t + 1 == to.operand.end || (*to.tokens)[t + 1]->type != TOK_LEFT_PAR) && effect.names.count(tok->value()))
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+// Scan the expression as the parser parsed it, an expression it does not
+// take apart is left as it is
+void CSE::scan(const std::vector<Token *> * expression, Program * scope) {
+	Operand operand;
+
+	this->tokens = expression;
+	this->scope = scope;
+	this->conditional = 0;
+	this->broken = 0;
+
+	found.clear();
+
+	if(expression->empty())
+		return;
+
+	operand = scan_binary(0, 1);
+
+	if(broken || operand.end != expression->size())
+		found.clear();
+}
+
+// Scan the operands and the operators of a precedence, the right operand
+// of an operator is scanned with the operators that bind tighter
+Operand CSE::scan_binary(size_t i, int precedence) {
+	Operand left, right;
+	int level;
+
+	left = scan_operand(i);
+
+	while(! broken && left.end < tokens->size() && (level = expr::precedence((*tokens)[left.end]->type)) >= precedence) {
+		int op = (*tokens)[left.end]->type;
+
+		// The right operand of && and || is not always computed
+		if(op == TOK_AND || op == TOK_OR)
+			conditional++;
+
+		right = scan_binary(left.end + 1, level + 1);
+
+		if(op == TOK_AND || op == TOK_OR)
+			conditional--;
+
+		left.end = right.end;
+		left.pure = left.pure && right.pure;
+		left.exact = left.exact && right.exact;
+		left.global = left.global || right.global;
+		left.operations += right.operations + 1;
+
+		// Truth values are not a type of variable
+		if(level < PREC_ADDITIVE)
+			left.type = TOK_NULL;
+		else if(left.type == TOK_STRING || right.type == TOK_STRING)
+			left.type = TOK_STRING;
+		else if(left.type == TOK_FLOAT && (right.type == TOK_FLOAT || right.type == TOK_INT))
+			left.type = TOK_FLOAT;
+		else if(left.type == TOK_INT && (right.type == TOK_FLOAT || right.type == TOK_INT))
+			left.type = right.type;
+		else
+			left.type = TOK_NULL;
+
+		if(candidate(left))
+			found.push_back(left);
+	}
+
+	return left;
+}
+
+// Scan an operand, a call is a subexpression of its own
+Operand CSE::scan_operand(size_t i) {
+	Operand operand;
+	Token * tok;
+
+	operand.begin = i;
+	operand.end = i + 1;
+	operand.type = TOK_NULL;
+	operand.pure = 1;
+	operand.exact = 1;
+	operand.global = 0;
+	operand.operations = 0;
+
+	if(i >= tokens->size()) {
+		broken = 1;
+		return operand;
+	}
+
+	tok = (*tokens)[i];
+
+	switch(tok->type) {
+
+	case TOK_LEFT_PAR:
+		operand = scan_binary(i + 1, 1);
+
+		if(operand.end >= tokens->size() || (*tokens)[operand.end]->type != TOK_RIGHT_PAR)
+			broken = 1;
+
+		operand.begin = i;
+		operand.end++;
+		break;
+
+	// The backends do not all compute a sign the way C++ does
+	case TOK_PLUS:
+	case TOK_MINUS:
+		operand = scan_operand(i + 1);
+		operand.begin = i;
+		operand.exact = 0;
+		break;
+
+	// C++ computes float literals as doubles
+	case TOK_FLOAT:
+		operand.exact = 0;
+		operand.type = TOK_FLOAT;
+		break;
+
+	case TOK_INT:
+	case TOK_STRING:
+		operand.type = tok->type;
+		break;
+
+	case TOK_NAME:
+
+		// Call, its value is that of its return type
+		if(i + 1 < tokens->size() && (*tokens)[i + 1]->type == TOK_LEFT_PAR) {
+			Function * function = program->get_function(tok->value());
+			size_t j = i + 2;
+
+			operand.pure = function && ! function->changes_globals();
+			operand.global = ! function || function->purity != PURITY_PURE;
+			operand.type = function ? function->get_return_type() : TOK_NULL;
+
+			while(! broken && j < tokens->size() && (*tokens)[j]->type != TOK_RIGHT_PAR) {
+				Operand argument = scan_binary(j, 1);
+
+				operand.pure = operand.pure && argument.pure;
+				operand.operations += argument.operations;
+				j = argument.end;
+
+				if(j < tokens->size() && (*tokens)[j]->type == TOK_COMMA)
+					j++;
+				else if(j >= tokens->size() || (*tokens)[j]->type != TOK_RIGHT_PAR)
+					broken = 1;
+			}
+
+			if(j >= tokens->size())
+				broken = 1;
+
+			operand.end = j + 1;
+			operand.operations++;
+
+			if(candidate(operand))
+				found.push_back(operand);
+		}
+
+		// A name that is nowhere is left to the backends to report
+		else {
+			Variable * variable = Purity::find_variable(scope, tok->value(), operand.global);
+
+			operand.type = variable ? variable->type : TOK_NULL;
+		}
+
+		break;
+
+	default:
+		broken = 1;
+	}
+
+	return operand;
+}
+
+// Arithmetic on ints and floats that is computed whenever the instruction is
+int CSE::candidate(Operand & operand) {
+	return ! broken && ! conditional && operand.operations && operand.pure && operand.exact
+			&& (operand.type == TOK_INT || operand.type == TOK_FLOAT);
+}
+
+// Whether a function called in [expression] may change globals
+int CSE::calls_impure(const std::vector<Token *> * expression) {
+	Function * function;
+
+	for(size_t i = 0; expression && i + 1 < expression->size(); i++) {
+		if((*expression)[i]->type != TOK_NAME || (*expression)[i + 1]->type != TOK_LEFT_PAR)
+			continue;
+
+		if(! (function = program->get_function((*expression)[i]->value())) || function->changes_globals())
+			return 1;
+	}
+
+	return 0;
+}
+
+// Add the variables [instruction] assigns and whether it may change globals,
+// or anything with inline code
+void CSE::add_effect(Instruction * instruction, Effect & effect) {
+	for(auto expression : expressions(instruction))
+		if(calls_impure(expression))
+			effect.globals = 1;
+
+	switch(instruction->type) {
+
+	case TYPE_ASSIGNMENT:
+		effect.names.insert(static_cast<Assignment *>(instruction)->variable->name);
+		break;
+
+	case TYPE_IF_STATEMENT:
+		for(auto ins : static_cast<IfStatement *>(instruction)->program->get_instructions())
+			add_effect(ins, effect);
+
+		break;
+
+	case TYPE_FUNCTIONCALL:
+		if(static_cast<FunctionCall *>(instruction)->function->changes_globals())
+			effect.globals = 1;
+
+		break;
+
+	case TYPE_INLINE_INJECTION:
+		effect.all = 1;
+		break;
+	}
+}
+
+// The expressions of an instruction, the condition of an if statement and
+// not those of its block
+std::vector<std::vector<Token *> *> CSE::expressions(Instruction * instruction) {
+	switch(instruction->type) {
+
+	case TYPE_ASSIGNMENT:
+		return { static_cast<Assignment *>(instruction)->variable->value };
+
+	case TYPE_IF_STATEMENT:
+		return { static_cast<IfStatement *>(instruction)->expression };
+
+	case TYPE_RETURN:
+		return { static_cast<ReturnOperation *>(instruction)->value };
+
+	case TYPE_FUNCTIONCALL:
+		return static_cast<FunctionCall *>(instruction)->get_arguments();
+	}
+
+	return {};
+}
+
+// Replace an expression of an instruction
+std::vector<Token *> * CSE::set_expression(Instruction * instruction, size_t index, std::vector<Token *> * expression) {
+	std::vector<Token *> * replaced = NULL;
+
+	switch(instruction->type) {
+
+	case TYPE_ASSIGNMENT:
+		replaced = static_cast<Assignment *>(instruction)->variable->value;
+		static_cast<Assignment *>(instruction)->variable->value = expression;
+		break;
+
+	case TYPE_IF_STATEMENT:
+		replaced = static_cast<IfStatement *>(instruction)->expression;
+		static_cast<IfStatement *>(instruction)->expression = expression;
+		break;
+
+	case TYPE_RETURN:
+		replaced = static_cast<ReturnOperation *>(instruction)->value;
+		static_cast<ReturnOperation *>(instruction)->value = expression;
+		break;
+
+	case TYPE_FUNCTIONCALL:
+		replaced = static_cast<FunctionCall *>(instruction)->get_arguments()[index];
+		static_cast<FunctionCall *>(instruction)->set_argument(index, expression);
+		break;
+	}
+
+	return replaced;
+}
+
+// Assign the temporary before the first occurrence and read it in each of
+// them. Expressions with the same tokens are one node, which may be in other
+// instructions, so an expression is replaced by a copy and not changed.
+void CSE::hoist(Function * function, std::vector<Occurrence> & repeated, int n) {
+	auto & instructions = function->get_instructions();
+	Occurrence & first = repeated[0];
+	size_t i, j, at;
+
+	// Names that a source cannot use, the same in every function
+	while(temporaries.size() <= (size_t) n) {
+		std::string temporary = "_cse" + std::to_string(temporaries.size());
+		temporaries.push_back(names.add(temporary.c_str(), temporary.size()));
+	}
+
+	Token * name = new Token(temporaries[n], strlen(NameTable::at(temporaries[n])), TOK_NAME);
+	auto value = new std::vector<Token *>(first.tokens->begin() + first.operand.begin, first.tokens->begin() + first.operand.end);
+	Variable * variable = new Variable(NameTable::at(temporaries[n]), value, first.operand.type);
+
+	// Occurrences come in the order of the body and of their expressions
+	for(i = 0; i < repeated.size(); i = j) {
+		auto tokens = repeated[i].tokens;
+		auto copy = new std::vector<Token *>();
+
+		for(j = i, at = 0; j < repeated.size() && repeated[j].instruction == repeated[i].instruction && repeated[j].expression == repeated[i].expression; j++) {
+			copy->insert(copy->end(), tokens->begin() + at, tokens->begin() + repeated[j].operand.begin);
+			copy->push_back(name);
+			at = repeated[j].operand.end;
+		}
+
+		copy->insert(copy->end(), tokens->begin() + at, tokens->end());
+		function->replaced.push_back(set_expression(instructions[repeated[i].instruction], repeated[i].expression, copy));
+	}
+
+	function->push_variable(variable);
+	function->insert_instruction(first.instruction, new Assignment(variable, TOK_EQUAL));
+}
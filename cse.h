@@ -0,0 +1,151 @@
+/*
+ * cse.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#ifndef CSE_H_
+#define CSE_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "mem/program.h"
+#include "mem/function.h"
+#include "purity.h"
+#include "names.h"
+
+// Defines an operand or an operation found in an expression, a range of its tokens
+class Operand {
+
+public:
+	size_t begin;
+	size_t end;
+
+	// TOK_INT, TOK_FLOAT or TOK_STRING, TOK_NULL for anything else
+	int type;
+
+	// Whether it calls only functions that change no globals
+	int pure;
+
+	// Whether it has the same type in C++, which computes float literals as doubles
+	int exact;
+
+	// Whether it reads globals, through a name or a call
+	int global;
+
+	// Operators and calls in it
+	int operations;
+
+};
+
+// Defines a subexpression that may be computed once, in expression [expression]
+// of instruction [instruction] of a body
+class Occurrence {
+
+public:
+	size_t instruction;
+	size_t expression;
+	std::vector<Token *> * tokens;
+	Operand operand;
+
+	// Types and text of its tokens
+	std::string key;
+
+};
+
+// Defines what an instruction may change, for the instructions after it
+class Effect {
+
+public:
+	Effect();
+
+	// Variables assigned by the instruction or in its block
+	std::unordered_set<std::string> names;
+
+	// Whether it calls a function that may change globals
+	int globals;
+
+	// Whether it has inline code, which may change any variable
+	int all;
+
+};
+
+// Computes a subexpression that a function repeats once, in a temporary
+// assigned before the first instruction that needs it. Subexpressions are
+// arithmetic on ints and floats, and calls of functions that change no
+// globals, computed whenever the instruction is. The purity of the
+// functions has to be analysed first. Only the instructions of the body
+// itself are changed, the variables of blocks are not declared in C++.
+class CSE {
+
+public:
+	CSE();
+
+	// Eliminate the subexpressions of the functions [program] defined,
+	// return the number of temporaries
+	int eliminate(GlobalProgram * program);
+
+private:
+	GlobalProgram * program;
+
+	// Names of the temporaries, which the programs refer to, and their offsets
+	NameTable names;
+	std::vector<uint32_t> temporaries;
+
+	// Expression scanned, the block it is in, and the subexpressions found
+	const std::vector<Token *> * tokens;
+	Program * scope;
+	std::vector<Operand> found;
+
+	// Right operands of && and || around the token scanned, which are not
+	// always computed, and whether the expression could not be scanned
+	int conditional;
+	int broken;
+
+	// Eliminate the subexpressions of [function], return the number of temporaries
+	int eliminate(Function * function);
+
+	// Find the occurrence that is repeated without a change in between, with the
+	// most tokens, and the occurrences that repeat it. Return 0 if there is none.
+	int find_repeated(std::vector<Occurrence> & occurrences, std::vector<Effect> & effects, std::vector<Occurrence> & repeated);
+
+	// Whether occurrence [to] has the value of occurrence [from], the effects
+	// of the instructions from the instruction of [from] to that of [to]
+	int same_value(Occurrence & from, Occurrence & to, std::vector<Effect> & effects);
+
+	// Add the subexpressions of [expression] in [scope] to [found]
+	void scan(const std::vector<Token *> * expression, Program * scope);
+
+	// Scan operations of [precedence] or tighter at token [i]
+	Operand scan_binary(size_t i, int precedence);
+
+	// Scan an operand at token [i], a call, a literal, a name, a signed
+	// operand or an operation in parentheses
+	Operand scan_operand(size_t i);
+
+	// Whether [operand] may be computed once
+	int candidate(Operand & operand);
+
+	// Whether [expression] calls a function that may change globals
+	int calls_impure(const std::vector<Token *> * expression);
+
+	// Add what [instruction] may change to [effect]
+	void add_effect(Instruction * instruction, Effect & effect);
+
+	// Expressions of [instruction], computed whenever it is
+	std::vector<std::vector<Token *> *> expressions(Instruction * instruction);
+
+	// Replace expression [index] of [instruction] with [expression], return
+	// the expression replaced
+	std::vector<Token *> * set_expression(Instruction * instruction, size_t index, std::vector<Token *> * expression);
+
+	// Compute [repeated] in temporary [n] of [function]
+	void hoist(Function * function, std::vector<Occurrence> & repeated, int n);
+
+};
+
+#endif /* CSE_H_ */
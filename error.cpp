@@ -5,6 +5,230 @@
  *      Author: timmy.lindholm
  */
 
+#include <cstdarg>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <iomanip>
 
+#include "error.h"
 
+Diagnostic::Diagnostic(int type, const char * format, ...) {
+	char buffer[512];
+	va_list args;
 
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+	uint32_t hash = 2166136261u;
+	char code[8];
+
+	for(const char * c = format; *c; c++)
+		hash = (hash ^ (unsigned char) *c) * 16777619u;
+
+	snprintf(code, sizeof(code), "E%04x", (hash ^ (hash >> 16)) & 0xffff);
+
+	this->type = type;
+	this->message = buffer;
+	this->code = code;
+	this->line = 0;
+	this->column = 0;
+	this->length = 0;
+	this->fatal = false;
+
+	// Messages were written for stderr, some end with a newline
+	while(! message.empty() && isspace(message.back()))
+		message.pop_back();
+
+}
+
+Diagnostics::Diagnostics() {
+
+	this->source = NULL;
+	this->line_start = 0;
+
+}
+
+// Record a diagnostic, compilation stops once there are too many errors
+bool Diagnostics::add(Diagnostic & diagnostic, int line, int column, int length) {
+	if(diagnostic.fatal)
+		return false;
+
+	if(! diagnostic.line) {
+		diagnostic.line = line;
+		diagnostic.column = column;
+		diagnostic.length = length;
+	}
+
+	if(diagnostic.file.empty())
+		diagnostic.file = file_name;
+
+	list.push_back(diagnostic);
+
+	if(diagnostic.type == T_CRIT && errors() >= DIAG_MAX_ERRORS) {
+		Diagnostic stop(T_CRIT, "too many errors, compilation stopped.");
+
+		stop.file = file_name;
+		list.push_back(stop);
+
+		diagnostic.fatal = true;
+		return false;
+	}
+
+	return true;
+}
+
+void Diagnostics::clear() {
+	list.clear();
+	sources.clear();
+	source = NULL;
+}
+
+// Take over the diagnostics of a module
+void Diagnostics::append(Diagnostics & other) {
+	if(other.list.empty())
+		return;
+
+	list.insert(list.end(), other.list.begin(), other.list.end());
+	sources[other.file_name] = other.source;
+	other.list.clear();
+}
+
+int Diagnostics::errors() {
+	int n = 0;
+
+	for(auto & diagnostic : list)
+		if(diagnostic.type == T_CRIT)
+			n++;
+
+	return n;
+}
+
+// Output a string as a JSON string
+static void write_json_string(std::ostream & out, const std::string & value) {
+	out << '"';
+
+	for(char c : value) {
+		if(c == '"' || c == '\\')
+			out << '\\' << c;
+		else if((unsigned char) c < 0x20)
+			out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int) c << std::dec << std::setfill(' ');
+		else
+			out << c;
+	}
+
+	out << '"';
+}
+
+// Find the line in the source when it is asked for, only diagnostics that are output need it
+std::string Diagnostics::source_line(const Diagnostic & diagnostic) {
+	const char * pt = source;
+	const char * end;
+	int line = diagnostic.line + line_start;
+
+	// Lines of modules are counted from the start of their files
+	if(diagnostic.file != file_name) {
+		auto it = sources.find(diagnostic.file);
+
+		pt = it == sources.end() ? NULL : it->second;
+		line = diagnostic.line;
+	}
+
+	if(! pt || line < 1)
+		return "";
+
+	for(int i = 1; i < line && pt; i++)
+		if((pt = strchr(pt, '\n')))
+			pt++;
+
+	if(! pt)
+		return "";
+
+	end = strchr(pt, '\n');
+	return end ? std::string(pt, end - pt) : std::string(pt);
+}
+
+// Output all diagnostics, then the number of errors
+void Diagnostics::print(std::ostream & out) {
+	int n = errors();
+
+	for(auto & diagnostic : list) {
+		std::string text;
+
+		out << diagnostic.file;
+
+		if(diagnostic.line)
+			out << ":" << diagnostic.line << ":" << diagnostic.column;
+
+		out << (diagnostic.file.empty() && ! diagnostic.line ? "" : ": ") << (diagnostic.type == T_CRIT ? "error: " : "warning: ") << diagnostic.message << std::endl;
+
+		if(! diagnostic.line || (text = source_line(diagnostic)).empty())
+			continue;
+
+		// Tabs are kept so the mark lines up with the token
+		out << "    " << text << std::endl << "    ";
+
+		for(int i = 0; i < diagnostic.column - 1 && i < (int) text.size(); i++)
+			out << (text[i] == '\t' ? '\t' : ' ');
+
+		out << "^" << std::string(diagnostic.length > 1 ? diagnostic.length - 1 : 0, '~') << std::endl;
+	}
+
+	if(n)
+		out << n << (n == 1 ? " error" : " errors") << " generated." << std::endl;
+}
+
+// Output one object per diagnostic and line, so the output can be read as a stream
+void Diagnostics::write_json(std::ostream & out) {
+	for(auto & diagnostic : list) {
+		out << "{\"severity\": \"" << (diagnostic.type == T_CRIT ? "error" : "warning") << "\", \"code\": \"" << diagnostic.code << "\", \"message\": ";
+		write_json_string(out, diagnostic.message);
+		out << ", \"file\": ";
+		write_json_string(out, diagnostic.file);
+		out << ", \"line\": " << diagnostic.line << ", \"column\": " << diagnostic.column
+				<< ", \"end_column\": " << diagnostic.column + diagnostic.length << ", \"source\": ";
+		write_json_string(out, diagnostic.line ? source_line(diagnostic) : "");
+		out << "}" << std::endl;
+	}
+}
+
+// Output a log with a single run, each code is a rule
+void Diagnostics::write_sarif(std::ostream & out) {
+	std::vector<std::string> rules;
+
+	for(auto & diagnostic : list)
+		if(std::find(rules.begin(), rules.end(), diagnostic.code) == rules.end())
+			rules.push_back(diagnostic.code);
+
+	out << "{\n  \"version\": \"2.1.0\",\n  \"$schema\": \"https://json.schemastore.org/sarif-2.1.0.json\",\n  \"runs\": [{\n";
+	out << "    \"tool\": {\"driver\": {\"name\": \"dpl\", \"rules\": [";
+
+	for(size_t i = 0; i < rules.size(); i++)
+		out << (i ? ", " : "") << "{\"id\": \"" << rules[i] << "\"}";
+
+	out << "]}},\n    \"results\": [";
+
+	for(size_t i = 0; i < list.size(); i++) {
+		Diagnostic & diagnostic = list[i];
+
+		out << (i ? "," : "") << "\n      {\"ruleId\": \"" << diagnostic.code << "\", \"level\": \"" << (diagnostic.type == T_CRIT ? "error" : "warning") << "\", \"message\": {\"text\": ";
+		write_json_string(out, diagnostic.message);
+		out << "}, \"locations\": [{\"physicalLocation\": {\"artifactLocation\": {\"uri\": ";
+		write_json_string(out, diagnostic.file);
+		out << "}";
+
+		// SARIF regions start at line 1, a diagnostic without a position has none
+		if(diagnostic.line > 0) {
+			out << ", \"region\": {\"startLine\": " << diagnostic.line << ", \"startColumn\": " << diagnostic.column
+					<< ", \"endColumn\": " << diagnostic.column + diagnostic.length << ", \"snippet\": {\"text\": ";
+			write_json_string(out, source_line(diagnostic));
+			out << "}}";
+		}
+
+		out << "}}]}";
+	}
+
+	out << "\n    ]\n  }]\n}" << std::endl;
+}
@@ -8,12 +8,96 @@
 #ifndef ERROR_H_
 #define ERROR_H_
 
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #define T_CRIT 0
 #define T_WARNING 1
 
-// Macro to output an error and cease execution if
-// the type is of error
-#define ERROR(error_type, format, ...) {fprintf(stderr, error_type ? "Warning: " : "Error: "); fprintf(stderr, format, __VA_ARGS__);  if(error_type == T_CRIT) {exit(0);}}
+// Errors after which compilation stops
+#define DIAG_MAX_ERRORS 100
+
+// Macro to output a warning, or to throw an error as a Diagnostic which
+// is collected by Diagnostics where compilation can recover from it
+#define ERROR(error_type, format, ...) {if(error_type == T_CRIT) {throw Diagnostic(error_type, format, __VA_ARGS__);} fprintf(stderr, "Warning: "); fprintf(stderr, format, __VA_ARGS__);}
+
+// Defines an error or a warning at a position of a source file,
+// a line of 0 if the position is not known
+class Diagnostic {
+
+public:
+	// Format the message like printf
+	Diagnostic(int type, const char * format, ...);
+
+	int type;
+	std::string message;
+
+	// Code of the kind of diagnostic, E and 4 hex digits of a hash of the
+	// format, so it stays the same as long as the format does
+	std::string code;
+
+	// Position and length of the token the diagnostic is about
+	std::string file;
+	int line;
+	int column;
+	int length;
+
+	// Set once compilation cannot go on, so recovery is not attempted again
+	bool fatal;
+
+};
+
+// Collects the diagnostics of a compilation, to report them all at once
+class Diagnostics {
+
+public:
+	Diagnostics();
+
+	// File diagnostics without a file are located in
+	std::string file_name;
+
+	// Source of the file, from which lines are quoted when they are
+	// output, and the line the lexer counted from
+	const char * source;
+	int line_start;
+
+	// Sources of the modules the file imports by their file names,
+	// their lines are counted from the first
+	std::unordered_map<std::string, const char *> sources;
+
+	// Diagnostics in the order they occurred
+	std::vector<Diagnostic> list;
+
+	// Record [diagnostic] at the token at [line] and [column] of [length]
+	// if it has no position, return whether compilation can go on
+	bool add(Diagnostic & diagnostic, int line, int column, int length);
+
+	// Number of errors
+	int errors();
+
+	// Forget the diagnostics and the source of the last compilation
+	void clear();
+
+	// Move the diagnostics of [other] to the end of the list, its source
+	// is quoted from for them
+	void append(Diagnostics & other);
+
+	// Output the diagnostics as file:line:column: error: message,
+	// followed by the line of source and a mark under the token
+	void print(std::ostream & out);
+
+	// Output the diagnostics as JSON, one object per line
+	void write_json(std::ostream & out);
+
+	// Output the diagnostics as a SARIF 2.1.0 log
+	void write_sarif(std::ostream & out);
 
+private:
+	// Text of the line of the source [diagnostic] is at, empty if it is not known
+	std::string source_line(const Diagnostic & diagnostic);
+};
 
 #endif /* ERROR_H_ */
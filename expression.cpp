@@ -5,32 +5,167 @@
  *      Author: eatit
  */
 
+#include <cstring>
 #include <stack>
 #include <vector>
 
 #include "lexer.h"
 #include "expression.h"
+#include "mem/program.h"
+#include "mem/function.h"
 
-namespace expr {
+// The table follows the numbering of the token types
+static_assert(expr::precedence(TOK_MOD) == PREC_MULTIPLICATIVE, "precedences out of step with lexer.h");
+static_assert(expr::precedence(TOK_EQUAL) == 0 && expr::precedence(TOK_EQUAL_EQUAL) == PREC_COMPARISON, "precedences out of step with lexer.h");
+static_assert(expr::precedence(TOK_AT) == 0 && expr::precedence(TOK_OR) == PREC_OR, "precedences out of step with lexer.h");
 
-	// Defines an operator with correct precedence
-	typedef struct {
-		char * name;
-		int precedence;
-	} Operator;
+namespace expr {
 
 	// Convert infix expression to postfix expression
-	char * infix_to_post(std::vector<Token *> tokens) {
-		std::stack<Token> op_stack;
+	std::vector<Token *> * infix_to_post(std::vector<Token *> * infix) {
+		std::vector<Token *> * postfix;
+		std::stack<Token *> op_stack;
+
+		postfix = new std::vector<Token *>;
 
 		// Loop through tokens
-		for(auto token : tokens) {
-			std::cerr << token->value;
+		for(size_t i = 0; i < infix->size(); i++) {
+			Token * tok = infix->at(i);
+
+			// Function call, push the function below its left paranthesis
+			if(tok->type == TOK_NAME && i + 1 < infix->size() && infix->at(i + 1)->type == TOK_LEFT_PAR) {
+				op_stack.push(new Token(tok->offset, tok->length, TOK_CALL));
+				op_stack.push(infix->at(++i));
+			}
+
+			// Operand
+			else if(tok->type == TOK_INT || tok->type == TOK_FLOAT || tok->type == TOK_STRING || tok->type == TOK_NAME)
+				postfix->push_back(tok);
+
+			else if(tok->type == TOK_LEFT_PAR)
+				op_stack.push(tok);
+
+			// Argument separator, finish the current argument
+			else if(tok->type == TOK_COMMA) {
+				while(! op_stack.empty() && op_stack.top()->type != TOK_LEFT_PAR) {
+					postfix->push_back(op_stack.top());
+					op_stack.pop();
+				}
+			}
+
+			else if(tok->type == TOK_RIGHT_PAR) {
+				while(! op_stack.empty() && op_stack.top()->type != TOK_LEFT_PAR) {
+					postfix->push_back(op_stack.top());
+					op_stack.pop();
+				}
+
+				if(! op_stack.empty())
+					op_stack.pop();
+
+				// End of function call
+				if(! op_stack.empty() && op_stack.top()->type == TOK_CALL) {
+					postfix->push_back(op_stack.top());
+					op_stack.pop();
+				}
+			}
+
+			// Operator, left associative
+			else if(precedence(tok->type)) {
+				while(! op_stack.empty() && precedence(op_stack.top()->type) >= precedence(tok->type)) {
+					postfix->push_back(op_stack.top());
+					op_stack.pop();
+				}
+
+				op_stack.push(tok);
+			}
+
+			// Anything else is kept in place
+			else
+				postfix->push_back(tok);
 		}
+
+		while(! op_stack.empty()) {
+			postfix->push_back(op_stack.top());
+			op_stack.pop();
+		}
+
+		return postfix;
 	}
 
-}
+	// Call tokens are the only ones the conversion makes
+	void release_post(std::vector<Token *> * postfix) {
+		for(auto tok : *postfix)
+			if(tok->type == TOK_CALL)
+				delete tok;
+
+		delete postfix;
+	}
+
+	// Keep the first token of each operand the tokens so far leave, an
+	// operator or a call starts where its first operand does
+	std::vector<size_t> right_operands(const std::vector<Token *> * postfix, GlobalProgram * program) {
+		std::vector<size_t> rights(postfix->size(), 0);
+		std::vector<size_t> starts;
+
+		for(size_t i = 0; i < postfix->size(); i++) {
+			Token * tok = (*postfix)[i];
+			size_t n = 0, start = i;
 
+			if(tok->type == TOK_CALL) {
+				Function * function = program->get_function(tok->value());
+				n = function ? function->get_arguments_size() : 0;
+			}
 
+			else if(precedence(tok->type))
+				n = 2;
 
+			// A faulty expression is left to the caller
+			if(n > starts.size())
+				break;
 
+			if(n) {
+				if(tok->type == TOK_AND || tok->type == TOK_OR)
+					rights[starts.back()] = i;
+
+				start = starts[starts.size() - n];
+				starts.resize(starts.size() - n);
+			}
+
+			starts.push_back(start);
+		}
+
+		return rights;
+	}
+
+
+	// FNV-1a over the type and the text of each token
+	size_t Hash::operator()(const std::vector<Token *> * expression) const {
+		size_t hash = 14695981039346656037ULL;
+
+		for(auto tok : *expression) {
+			hash = (hash ^ (size_t) tok->type) * 1099511628211ULL;
+
+			for(const char * pt = tok->value(); *pt; pt++)
+				hash = (hash ^ (unsigned char) *pt) * 1099511628211ULL;
+		}
+
+		return hash;
+	}
+
+	// Names and numbers are interned by the lexer, their text is only
+	// compared when the offsets differ
+	bool Equal::operator()(const std::vector<Token *> * a, const std::vector<Token *> * b) const {
+		if(a->size() != b->size())
+			return false;
+
+		for(size_t i = 0; i < a->size(); i++) {
+			Token * x = (*a)[i], * y = (*b)[i];
+
+			if(x->type != y->type || (x->offset != y->offset && (x->length != y->length || strcmp(x->value(), y->value()))))
+				return false;
+		}
+
+		return true;
+	}
+
+}
@@ -8,10 +8,77 @@
 #ifndef EXPRESSION_H_
 #define EXPRESSION_H_
 
+#include <cstddef>
+#include <vector>
+
+class Token;
+class GlobalProgram;
+
+// Precedence of the operators, from the loosest to the tightest, all of
+// them are left associative
+#define PREC_OR 2
+#define PREC_AND 3
+#define PREC_COMPARISON 4
+#define PREC_ADDITIVE 5
+#define PREC_MULTIPLICATIVE 6
+
 namespace expr {
 
+	// Precedence of each token type of lexer.h, 0 if not an operator
+	constexpr unsigned char precedences[] = {
+		0,						// TOK_NULL
+		0, 0, 0, 0,				// TOK_INT, TOK_FLOAT, TOK_STRING, TOK_NAME
+		PREC_ADDITIVE,			// TOK_PLUS
+		PREC_ADDITIVE,			// TOK_MINUS
+		PREC_MULTIPLICATIVE,	// TOK_MULT
+		PREC_MULTIPLICATIVE,	// TOK_DIV
+		PREC_MULTIPLICATIVE,	// TOK_MOD
+		0, 0, 0, 0, 0, 0, 0,	// TOK_RIGHT_PAR to TOK_PIPE
+		0, 0, 0, 0,				// TOK_UNI_QUANT to TOK_IMPLIES
+		PREC_COMPARISON,		// TOK_GREATER
+		PREC_COMPARISON,		// TOK_LESSER
+		PREC_COMPARISON,		// TOK_GREATER_EQUAL
+		PREC_COMPARISON,		// TOK_LESSER_EQUAL
+		0,						// TOK_EQUAL
+		PREC_COMPARISON,		// TOK_EQUAL_EQUAL
+		0, 0, 0, 0, 0, 0, 0,	// TOK_IF to TOK_AT
+		PREC_AND,				// TOK_AND
+		PREC_OR,				// TOK_OR
+	};
+
 	// Convert infix expression to postfix expression
-	char * infix_to_post(char * infix);
+	// function calls are replaced by a TOK_CALL token after their arguments
+	std::vector<Token *> * infix_to_post(std::vector<Token *> * infix);
+
+	// Delete a postfix expression of infix_to_post and the call tokens it
+	// made, the other tokens are those of the infix expression
+	void release_post(std::vector<Token *> * postfix);
+
+	// For each token of postfix expression [postfix], the index of the && or
+	// || whose right operand starts at it, 0 if none. A call takes as many
+	// operands as its function in [program] has arguments.
+	std::vector<size_t> right_operands(const std::vector<Token *> * postfix, GlobalProgram * program);
+
+	// Return the precedence of operator [type], 0 if not an operator
+	constexpr int precedence(int type) {
+		return type >= 0 && type < (int) sizeof(precedences) ? precedences[type] : 0;
+	}
+
+	// Hash of an expression by the types and the text of its tokens
+	class Hash {
+
+	public:
+		size_t operator()(const std::vector<Token *> * expression) const;
+
+	};
+
+	// Whether two expressions have tokens of the same types and text
+	class Equal {
+
+	public:
+		bool operator()(const std::vector<Token *> * a, const std::vector<Token *> * b) const;
+
+	};
 
 }
 
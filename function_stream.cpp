@@ -0,0 +1,59 @@
+/*
+ * function_stream.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include "function_stream.h"
+
+FunctionStream::FunctionStream() {
+
+	this->program = NULL;
+	this->peak = 0;
+	this->closed = false;
+
+}
+
+// Queue a function, waiting while the translator is too far behind
+void FunctionStream::push(Function * function, std::vector<Variable *> & variables) {
+	std::unique_lock<std::mutex> guard(lock);
+	StreamItem item;
+
+	changed.wait(guard, [this] { return items.size() < STREAM_QUEUE_SIZE; });
+
+	item.function = function;
+	item.variables.swap(variables);
+	items.push_back(item);
+
+	if(items.size() > peak)
+		peak = items.size();
+
+	changed.notify_all();
+}
+
+// Let the translator finish
+void FunctionStream::close(GlobalProgram * program) {
+	std::lock_guard<std::mutex> guard(lock);
+
+	this->program = program;
+	closed = true;
+
+	changed.notify_all();
+}
+
+// Take the oldest function
+int FunctionStream::pop(StreamItem & item) {
+	std::unique_lock<std::mutex> guard(lock);
+
+	changed.wait(guard, [this] { return closed || ! items.empty(); });
+
+	if(items.empty())
+		return 0;
+
+	item = items.front();
+	items.pop_front();
+
+	changed.notify_all();
+	return 1;
+}
@@ -0,0 +1,68 @@
+/*
+ * function_stream.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#ifndef FUNCTION_STREAM_H_
+#define FUNCTION_STREAM_H_
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include "mem/program.h"
+#include "mem/function.h"
+
+// Functions the parser may be ahead of the translator by
+#define STREAM_QUEUE_SIZE 4
+
+// Defines a function handed from the parser to the translator, with the
+// global variables first assigned since the function before it
+class StreamItem {
+
+public:
+	Function * function;
+	std::vector<Variable *> variables;
+
+};
+
+/*
+ * Hands functions from the parser to a translator on another thread as
+ * soon as each is parsed. The parser waits once the translator is
+ * STREAM_QUEUE_SIZE functions behind, so no more than that many parsed
+ * functions are held at once.
+ */
+class FunctionStream {
+
+public:
+	FunctionStream();
+
+	// Hand [function] over, NULL for the variables after the last function
+	void push(Function * function, std::vector<Variable *> & variables);
+
+	// End the stream, [program] is the global program of the source,
+	// NULL if it could not be parsed
+	void close(GlobalProgram * program);
+
+	// Wait for the next function, return 0 once the stream is closed and
+	// every function has been taken
+	int pop(StreamItem & item);
+
+	// Global program the stream was closed with
+	GlobalProgram * program;
+
+	// Most functions that were waiting at once
+	size_t peak;
+
+private:
+	std::deque<StreamItem> items;
+	bool closed;
+
+	std::mutex lock;
+	std::condition_variable changed;
+};
+
+#endif /* FUNCTION_STREAM_H_ */
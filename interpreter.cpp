@@ -0,0 +1,362 @@
+/*
+ * interpreter.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include <cmath>
+#include <cstdlib>
+
+#include <iostream>
+
+#include "interpreter.h"
+#include "expression.h"
+#include "error.h"
+
+// print in stdlib/lib1.dpl
+static Value builtin_print(std::vector<Value> & args) {
+	Value & value = args.at(0);
+
+	if(value.type == TOK_INT)
+		std::cout << value.i << std::endl;
+	else if(value.type == TOK_FLOAT)
+		std::cout << value.f << std::endl;
+	else
+		std::cout << value.s << std::endl;
+
+	return Value();
+}
+
+Interpreter::Interpreter() {
+
+	this->program = NULL;
+	this->frame = NULL;
+	this->returning = 0;
+
+	// Define builtin functions
+	builtins["print"] = builtin_print;
+}
+
+// Run a program, the global scope is the body of main
+void Interpreter::run(Program * program) {
+	std::unordered_map<Variable *, Value> main_frame;
+
+	this->program = static_cast<GlobalProgram *>(program);
+	this->frame = &main_frame;
+
+	globals.clear();
+	returning = 0;
+
+	// The expressions go with the program, and so do their postfix forms
+	try {
+		execute(program);
+	} catch(...) {
+		release_postfix();
+		throw;
+	}
+
+	release_postfix();
+}
+
+// Free the postfix forms of the run
+void Interpreter::release_postfix() {
+	for(auto & expression : postfix)
+		expr::release_post(expression.second.tokens);
+
+	postfix.clear();
+}
+
+// Execute the instructions of a program until a return
+void Interpreter::execute(Program * scope) {
+	for(auto ins : scope->get_instructions()) {
+		execute_instruction(scope, ins);
+
+		if(returning)
+			return;
+	}
+}
+
+// Execute a single instruction
+void Interpreter::execute_instruction(Program * scope, Instruction * instruction) {
+	switch(instruction->type) {
+
+	// Assign the variable the name refers to, a block assigns the variables
+	// of its function like the translation does
+	case TYPE_ASSIGNMENT: {
+		Assignment * assignment = static_cast<Assignment *>(instruction);
+		Variable * var = scope->resolve_variable(assignment->variable->name);
+
+		slot(var) = convert(evaluate(scope, assignment->variable->value), var->type);
+		break;
+	}
+
+	case TYPE_RETURN: {
+		Program * function = scope;
+
+		while(function->program_type != PROGRAM_FUNCTION)
+			function = function->parent_program;
+
+		return_value = convert(evaluate(scope, static_cast<ReturnOperation *>(instruction)->value),
+				static_cast<Function *>(function)->get_return_type());
+		returning = 1;
+		break;
+	}
+
+	case TYPE_IF_STATEMENT: {
+		IfStatement * statement = static_cast<IfStatement *>(instruction);
+		Value condition = evaluate(scope, statement->expression);
+
+		if(truth(condition))
+			execute(statement->program);
+
+		break;
+	}
+
+	case TYPE_FUNCTIONCALL: {
+		FunctionCall * call = static_cast<FunctionCall *>(instruction);
+		std::vector<Value> args;
+
+		for(auto arg : call->get_arguments())
+			args.push_back(evaluate(scope, arg));
+
+		this->call(call->function, args);
+		break;
+	}
+
+	case TYPE_INLINE_INJECTION:
+		ERROR(T_CRIT, "%s", "inline code in the global scope can not be run.\n");
+		break;
+	}
+}
+
+// Evaluate an infix expression through its postfix form
+Value Interpreter::evaluate(Program * scope, std::vector<Token *> * infix) {
+	std::vector<Token *> * tokens;
+	std::vector<Value> stack;
+
+	// Convert once per expression
+	auto it = postfix.find(infix);
+
+	if(it == postfix.end()) {
+		Postfix form;
+
+		form.tokens = expr::infix_to_post(infix);
+		form.rights = expr::right_operands(form.tokens, program);
+		it = postfix.insert(std::make_pair(infix, form)).first;
+	}
+
+	tokens = it->second.tokens;
+	std::vector<size_t> & rights = it->second.rights;
+
+	for(size_t i = 0; i < tokens->size(); i++) {
+		Token * tok = (*tokens)[i];
+
+		// The left operand of && or || is done, the right one and the
+		// operator are skipped when it decides
+		if(rights[i]) {
+			int op = (*tokens)[rights[i]]->type;
+			int left = truth(stack.back());
+
+			if(op == TOK_AND ? ! left : left) {
+				stack.back() = Value(left);
+				i = rights[i];
+				continue;
+			}
+		}
+
+		switch(tok->type) {
+
+		case TOK_INT:
+			stack.push_back(Value((int) strtol(tok->value(), NULL, 10)));
+			break;
+
+		case TOK_FLOAT:
+			stack.push_back(Value(strtof(tok->value(), NULL)));
+			break;
+
+		case TOK_STRING:
+			stack.push_back(Value(std::string(tok->value())));
+			break;
+
+		case TOK_NAME: {
+			Variable * var = scope->resolve_variable(tok->value());
+
+			if(! var)
+				ERROR(T_CRIT, "undefined variable %s.\n", tok->value());
+
+			stack.push_back(slot(var));
+			break;
+		}
+
+		case TOK_CALL: {
+			Function * function = program->get_function(tok->value());
+			size_t n = function->get_arguments_size();
+			std::vector<Value> args(stack.end() - n, stack.end());
+
+			stack.resize(stack.size() - n);
+			stack.push_back(call(function, args));
+			break;
+		}
+
+		default: {
+			if(! expr::precedence(tok->type) || stack.size() < 2)
+				ERROR(T_CRIT, "unexpected '%s' in expression.\n", tok->value());
+
+			Value b = stack.back();
+			stack.pop_back();
+
+			stack.back() = operate(tok->type, stack.back(), b);
+			break;
+		}
+
+		}
+	}
+
+	if(stack.size() != 1)
+		ERROR(T_CRIT, "%s", "faulty expression.\n");
+
+	return stack.back();
+}
+
+// Call a function, arguments are converted to the types of the parameters
+Value Interpreter::call(Function * function, std::vector<Value> & args) {
+	std::unordered_map<Variable *, Value> callee_frame;
+	std::unordered_map<Variable *, Value> * caller_frame;
+	Value result;
+
+	// Functions with inline code only run if the interpreter implements them
+	if(function->has_inline_code()) {
+		auto it = builtins.find(function->name);
+
+		if(it == builtins.end())
+			ERROR(T_CRIT, "function %s contains inline code and can not be run.\n", function->name);
+
+		return it->second(args);
+	}
+
+	for(size_t i = 0; i < args.size(); i++) {
+		Argument * arg = function->get_argument(i);
+		callee_frame[arg] = convert(args[i], arg->type);
+	}
+
+	caller_frame = frame;
+	frame = &callee_frame;
+
+	execute(function);
+
+	frame = caller_frame;
+
+	if(returning) {
+		returning = 0;
+		result = return_value;
+	}
+
+	return result;
+}
+
+// Apply a binary operator, ints are promoted to floats like in C++
+Value Interpreter::operate(int op, Value & a, Value & b) {
+
+	// Logical and or or, only reached when the left operand does not decide
+	if(op == TOK_AND)
+		return Value(truth(a) && truth(b));
+
+	if(op == TOK_OR)
+		return Value(truth(a) || truth(b));
+
+	// Strings are concatenated and compared
+	if(a.type == TOK_STRING || b.type == TOK_STRING) {
+		if(a.type != b.type)
+			ERROR(T_CRIT, "%s", "operation on a string and a number.\n");
+
+		switch(op) {
+		case TOK_PLUS: return Value(a.s + b.s);
+		case TOK_GREATER: return Value(a.s > b.s);
+		case TOK_LESSER: return Value(a.s < b.s);
+		case TOK_GREATER_EQUAL: return Value(a.s >= b.s);
+		case TOK_LESSER_EQUAL: return Value(a.s <= b.s);
+		case TOK_EQUAL_EQUAL: return Value(a.s == b.s);
+		}
+
+		ERROR(T_CRIT, "%s", "invalid operation on strings.\n");
+	}
+
+	// Floats
+	if(a.type == TOK_FLOAT || b.type == TOK_FLOAT) {
+		float x = a.type == TOK_FLOAT ? a.f : a.i;
+		float y = b.type == TOK_FLOAT ? b.f : b.i;
+
+		switch(op) {
+		case TOK_PLUS: return Value(x + y);
+		case TOK_MINUS: return Value(x - y);
+		case TOK_MULT: return Value(x * y);
+		case TOK_DIV: return Value(x / y);
+		case TOK_MOD: return Value(fmodf(x, y));
+		case TOK_GREATER: return Value(x > y);
+		case TOK_LESSER: return Value(x < y);
+		case TOK_GREATER_EQUAL: return Value(x >= y);
+		case TOK_LESSER_EQUAL: return Value(x <= y);
+		case TOK_EQUAL_EQUAL: return Value(x == y);
+		}
+	}
+
+	// Ints
+	switch(op) {
+	case TOK_PLUS: return Value(a.i + b.i);
+	case TOK_MINUS: return Value(a.i - b.i);
+	case TOK_MULT: return Value(a.i * b.i);
+	case TOK_GREATER: return Value(a.i > b.i);
+	case TOK_LESSER: return Value(a.i < b.i);
+	case TOK_GREATER_EQUAL: return Value(a.i >= b.i);
+	case TOK_LESSER_EQUAL: return Value(a.i <= b.i);
+	case TOK_EQUAL_EQUAL: return Value(a.i == b.i);
+
+	case TOK_DIV:
+	case TOK_MOD:
+		if(b.i == 0)
+			ERROR(T_CRIT, "%s", "division by zero.\n");
+
+		return Value(op == TOK_DIV ? a.i / b.i : a.i % b.i);
+	}
+
+	return Value();
+}
+
+// Convert a value to the type of a variable, values of unknown type are kept
+Value Interpreter::convert(Value value, int type) {
+	if(type == TOK_INT && value.type == TOK_FLOAT)
+		return Value((int) value.f);
+
+	if(type == TOK_FLOAT && value.type == TOK_INT)
+		return Value((float) value.i);
+
+	return value;
+}
+
+// Whether a value is true in a condition
+int Interpreter::truth(Value & value) {
+	if(value.type == TOK_FLOAT)
+		return value.f != 0;
+
+	if(value.type == TOK_STRING)
+		return 1;
+
+	return value.i != 0;
+}
+
+// Return the storage of a variable, globals are shared by every frame
+Value & Interpreter::slot(Variable * variable) {
+	auto it = frame->find(variable);
+
+	if(it != frame->end())
+		return it->second;
+
+	// Globals are the variables of the global program
+	auto global = program->variables->find(variable->name);
+
+	if(global != program->variables->end() && global->second == variable)
+		return globals[variable];
+
+	return (*frame)[variable];
+}
@@ -0,0 +1,107 @@
+/*
+ * interpreter.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#ifndef INTERPRETER_H_
+#define INTERPRETER_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "mem/program.h"
+#include "mem/function.h"
+
+// Defines a value of a running program
+class Value {
+
+public:
+	Value() : type(TOK_NULL), i(0), f(0) {}
+	Value(int i) : type(TOK_INT), i(i), f(0) {}
+	Value(float f) : type(TOK_FLOAT), i(0), f(f) {}
+	Value(std::string s) : type(TOK_STRING), i(0), f(0), s(s) {}
+
+	// The type of the value, one of TOK_INT, TOK_FLOAT or TOK_STRING
+	int type;
+
+	int i;
+	float f;
+	std::string s;
+
+};
+
+// Defines a function implemented by the interpreter itself, used in place
+// of library functions whose body is inline C/C++ code
+typedef Value (* Builtin)(std::vector<Value> & args);
+
+// Defines the postfix form of an expression
+class Postfix {
+
+public:
+	std::vector<Token *> * tokens;
+
+	// Right operands of && and ||, see expr::right_operands
+	std::vector<size_t> rights;
+
+};
+
+// Runs a parsed program directly, without translating it
+class Interpreter {
+
+public:
+	Interpreter();
+
+	// Run a program
+	void run(Program * program);
+
+private:
+	GlobalProgram * program;
+
+	// Values of the global variables
+	std::unordered_map<Variable *, Value> globals;
+
+	// Values of the variables of the running function
+	std::unordered_map<Variable *, Value> * frame;
+
+	// Postfix form of each expression, converted once per run
+	std::unordered_map<std::vector<Token *> *, Postfix> postfix;
+
+	// Builtin functions by name
+	std::unordered_map<std::string, Builtin> builtins;
+
+	// Set while unwinding a return operation
+	int returning;
+	Value return_value;
+
+	// Execute the instructions of a program
+	void execute(Program * scope);
+
+	// Free the postfix forms of the expressions
+	void release_postfix();
+
+	// Execute a single instruction in [scope]
+	void execute_instruction(Program * scope, Instruction * instruction);
+
+	// Evaluate an infix expression in [scope]
+	Value evaluate(Program * scope, std::vector<Token *> * infix);
+
+	// Call a function with the values in [args]
+	Value call(Function * function, std::vector<Value> & args);
+
+	// Apply a binary operator
+	Value operate(int op, Value & a, Value & b);
+
+	// Convert a value to a variable of [type]
+	Value convert(Value value, int type);
+
+	// Whether a value is true in a condition
+	int truth(Value & value);
+
+	// Return the storage of a variable
+	Value & slot(Variable * variable);
+};
+
+#endif /* INTERPRETER_H_ */
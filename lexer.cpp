@@ -5,15 +5,36 @@
  *      Author: timmy.lindholm
  */
 
+#include <algorithm>
+#include <cstring>
+#include <new>
+
 #include "lexer.h"
 #include "error.h"
 
 Lexer::Lexer() {
 
 	n_lines = 1;
+	column = 1;
+	length = 0;
 	buffer = NULL;
 	pt = NULL;
+	line_begin = NULL;
+	token_begin = NULL;
 	last_token = NULL;
+	error = NULL;
+	errors = 0;
+	lex_phase = NULL;
+	n_tokens = NULL;
+	block_used = 0;
+	block_size = 0;
+	next_block_size = TOKEN_BLOCK_SIZE;
+	kept_blocks = 0;
+	kept_used = 0;
+	kept_size = 0;
+	taken_blocks = -1;
+	taken_used = 0;
+	taken_size = 0;
 
 	// Initialize symbols map
 	symbols["+"] = TOK_PLUS;
@@ -62,53 +83,111 @@ Lexer::Lexer() {
 
 	// Initialize keywords map
 	keywords["ret"] = TOK_RETURN;
+	keywords["import"] = TOK_IMPORT;
+}
+
+// Free the tokens, the programs made of them are gone
+Lexer::~Lexer() {
+	for(auto block : blocks)
+		operator delete(block);
+
+	delete error;
 }
 
 // Returns the next token in input buffer
 Token * Lexer::next_token() {
+	Token * tok;
+	double start;
+
+	if(! lex_phase)
+		return scan_token();
+
+	// Only wall time, processor time is too expensive to read per token
+	start = Stats::wall_time();
+	tok = scan_token();
+
+	lex_phase->wall += Stats::wall_time() - start;
+	lex_phase->calls++;
+	(*n_tokens)++;
+
+	return tok;
+}
+
+// Count tokens and time lexing
+void Lexer::set_stats(Stats * stats) {
+	lex_phase = stats ? stats->get_phase("lex") : NULL;
+	n_tokens = stats ? &stats->counter("tokens") : NULL;
+
+	if(lex_phase)
+		lex_phase->cpu = -1;
+}
+
+// Scan the next token in input buffer
+Token * Lexer::scan_token() {
 	int type;
-	std::string * value;
+	uint32_t value;
+	size_t size;
+	const char * start;
 
 	type = TOK_NULL;
 
 	// Skip spaces
 	while(isspace(*pt)) {
-		if(*pt == '\n')
+		if(*pt == '\n') {
 			n_lines++;
+			line_begin = pt + 1;
+		}
 
 		pt++;
 	}
 
-	// End of code
-	if(*pt == '\0')
-		return new Token(new std::string, type);
+	column = pt - line_begin + 1;
+	length = 0;
+	token_begin = pt;
+
+	// End of code, the last token as well so loops until a token stop there
+	if(*pt == '\0') {
+		last_token = make_token(intern(""), 0, type);
+		return last_token;
+	}
+
+	start = pt;
 
 	// Integer or float
 	if(isdigit(*pt))
-		value = get_number(type);
+		value = get_number(type, size);
 
 	// String
 	else if(*pt == '"' || *pt == '\'')
-		value = get_string(*pt++, type);
+		value = get_string(*pt++, type, size);
 
 	// Keyword
 	else if(isalpha(*pt))
-		value = get_keyword(type);
+		value = get_keyword(type, size);
 
 	// Symbol
 	else
-		value = get_symbol(type);
+		value = get_symbol(type, size);
+
+	length = pt - start;
+	last_token = make_token(value, size, type);
+
+	// The parser may come across the error after more tokens
+	if(type == TOK_ERROR) {
+		error->line = n_lines;
+		error->column = column;
+		error->length = length;
+	}
 
-	last_token = new Token(value, type);
 	return last_token;
 }
 
 // Fetch an integer or a float, return the corresponding string
 // and set type to the TOK_TYPE accordingly
-std::string * Lexer::get_number(int &type) {
-	std::string * value;
+uint32_t Lexer::get_number(int &type, size_t &size) {
+	const char * start;
 
-	value = new std::string;
+	start = pt;
 	type = TOK_INT;
 
 	while(isdigit(*pt) || *pt == '.') {
@@ -119,46 +198,53 @@ std::string * Lexer::get_number(int &type) {
 			type = TOK_FLOAT;
 		}
 
-		*value += *pt++;
+		pt++;
 	}
 
-	return value;
+	size = pt - start;
+	return intern(std::string_view(start, size));
 }
 
 // Fetch a string using the delimiter specified, either " or '
-std::string * Lexer::get_string(char delimiter, int &type) {
-	std::string * value;
-	value = new std::string;
+uint32_t Lexer::get_string(char delimiter, int &type, size_t &size) {
+	const char * start;
+
+	start = pt;
 
 	// Loop until ending delimiter
 	while(*pt != delimiter && *pt != '\0')
-		*value += *pt++;
+		pt++;
 
 	// No ending delimiter
 	if(*pt == '\0')
-		ERROR(T_CRIT, "no ending delimiter %c for string, on line %d.", delimiter, n_lines);
+		return fail(Diagnostic(T_CRIT, "no ending delimiter %c for string, on line %d.", delimiter, n_lines), type, size);
 
 	pt++;
 	type = TOK_STRING;
 
-	return value;
+	size = pt - start - 1;
+	return intern(std::string_view(start, size));
 }
 
 /* Fetches a keyword or variable name, based on whether the name is a reserved
  * keyword or not.
  */
-std::string * Lexer::get_keyword(int &type) {
-	std::string * search;
-	std::unordered_map<std::string, int>::iterator it;
+uint32_t Lexer::get_keyword(int &type, size_t &size) {
+	uint32_t search;
+	const char * start;
+	std::unordered_map<std::string_view, int>::iterator it;
 
-	search = new std::string;
+	start = pt;
 
 	// Get name
 	while(isalnum(*pt) || *pt == '_')
-		*search += *pt++;
+		pt++;
+
+	size = pt - start;
+	search = intern(std::string_view(start, size));
 
 	// Keyword or name
-	if((it = keywords.find(*search)) == symbols.end())
+	if((it = keywords.find(std::string_view(start, size))) == keywords.end())
 		type = TOK_NAME;
 	else
 		type = it->second;
@@ -167,7 +253,7 @@ std::string * Lexer::get_keyword(int &type) {
 }
 
 // Fetches a symbol based on whether it is in the symbols map or not
-std::string * Lexer::get_symbol(int &type) {
+uint32_t Lexer::get_symbol(int &type, size_t &size) {
 	std::string search;
 	std::unordered_map<std::string, int>::iterator it, _it;
 
@@ -182,9 +268,11 @@ std::string * Lexer::get_symbol(int &type) {
 		search += *(++pt);
 	}
 
-	// No match
-	if(type == TOK_NULL)
-		ERROR(T_CRIT, "unknown symbol %s, on line %d.", search.c_str(), n_lines);
+	// No match, skipped so that lexing can go on after the error
+	if(type == TOK_NULL) {
+		pt++;
+		return fail(Diagnostic(T_CRIT, "unknown symbol %s, on line %d.", search.c_str(), n_lines), type, size);
+	}
 
 	// Comment
 	if(type == TOK_SHORT_COM) {
@@ -192,15 +280,145 @@ std::string * Lexer::get_symbol(int &type) {
 			pt++;
 	}
 
-	return new std::string(it->first);
+	size = it->first.size();
+	return intern(it->first);
+}
+
+// Errors are rare, they are kept out of the paths of the tokens
+uint32_t Lexer::fail(const Diagnostic & diagnostic, int & type, size_t & size) {
+	delete error;
+	error = new Diagnostic(diagnostic);
+	errors++;
+	type = TOK_ERROR;
+	size = 0;
+
+	return intern("");
+}
+
+// Make a token of a text that was not lexed, a ( or a , of a call
+Token * Lexer::make_token(const char * value, int type) {
+	size_t size = strlen(value);
+
+	return make_token(intern(std::string_view(value, size)), size, type);
+}
+
+// Make a token in the last block, a token costs no allocation of its own
+Token * Lexer::make_token(uint32_t offset, size_t length, int type) {
+	if(block_used == block_size) {
+		block_size = next_block_size;
+		next_block_size = std::min(2 * next_block_size, TOKEN_BLOCK_SIZE);
+
+		blocks.push_back(static_cast<Token *>(operator new(block_size * sizeof(Token))));
+		block_used = 0;
+	}
+
+	return new(blocks.back() + block_used++) Token(offset, length, type, 1);
+}
+
+// The tokens made so far stay until the lexer is deleted, the names go to
+// the kept ones, which are looked up first
+void Lexer::keep() {
+	kept_blocks = blocks.size();
+	kept_used = block_used;
+	kept_size = block_size;
+
+	kept.merge(interned);
+	interned.clear();
+	names.keep();
+}
+
+// Go back to the blocks and the names of keep(), the next tokens are made
+// after the kept ones in the last kept block
+void Lexer::release() {
+	for(size_t i = kept_blocks; i < blocks.size(); i++)
+		operator delete(blocks[i]);
+
+	blocks.resize(kept_blocks);
+	block_used = kept_used;
+	block_size = kept_size;
+	next_block_size = TOKEN_BLOCK_SIZE;
+	taken_blocks = -1;
+
+	interned.clear();
+	names.release();
+	last_token = NULL;
+}
+
+// A new block is made for the next token, the block being filled is resumed after
+void Lexer::begin_tokens() {
+	taken_blocks = blocks.size();
+	taken_used = block_used;
+	taken_size = block_size;
+
+	block_used = block_size = 0;
+	next_block_size = TOKEN_FIRST_BLOCK_SIZE;
+}
+
+// Move the blocks made since begin_tokens() out of the lexer
+std::vector<Token *> Lexer::take_tokens() {
+	std::vector<Token *> taken(blocks.begin() + taken_blocks, blocks.end());
+
+	blocks.resize(taken_blocks);
+	block_used = taken_used;
+	block_size = taken_size;
+	next_block_size = TOKEN_BLOCK_SIZE;
+	taken_blocks = -1;
+
+	return taken;
+}
+
+// The tokens of the blocks are not referred to any more
+void Lexer::free_tokens(std::vector<Token *> & blocks) {
+	for(auto block : blocks)
+		operator delete(block);
+
+	blocks.clear();
+}
+
+// Tokens of a lexer stay until the lexer releases them
+void Token::release(Token * tok) {
+	if(! tok->pooled)
+		delete tok;
+}
+
+// Store a value once, tokens with the same text share it. The text in
+// the table is the key, so a value is not copied to be looked up.
+uint32_t Lexer::intern(std::string_view value) {
+	uint32_t offset;
+
+	if(! kept.empty()) {
+		auto it = kept.find(value);
+
+		if(it != kept.end())
+			return it->second;
+	}
+
+	auto it = interned.find(value);
+
+	if(it != interned.end())
+		return it->second;
+
+	offset = names.add(value.data(), value.size());
+	interned.emplace(std::string_view(NameTable::at(offset), value.size()), offset);
+
+	return offset;
 }
 
 /*
  * Sets the internal code buffer to the string pointed to by
  * [buffer].
  */
-void Lexer::set_input_code(char * buffer) {
+void Lexer::set_input_code(const char * buffer) {
 	this->buffer = buffer;
 	this->pt = this->buffer;
+	this->line_begin = this->buffer;
+}
+
+// Move to a position of the buffer, the line it is on starts after the last newline
+void Lexer::set_position(const char * position, int line) {
+	pt = position;
+	n_lines = line;
+
+	for(line_begin = position; line_begin > buffer && *(line_begin - 1) != '\n'; line_begin--);
 }
 
@@ -10,7 +10,16 @@
 
 #include <iostream>
 #include <cctype>
+#include <cstdint>
+#include <string_view>
+#include <vector>
 #include <unordered_map>
+#include <unordered_set>
+
+#include "stats.h"
+#include "names.h"
+
+class Diagnostic;
 
 // Tokens
 #define TOK_NULL 0
@@ -69,72 +78,189 @@
 #define TOK_DOUBLE_COLON 40
 #define TOK_LEFT_SHIFT 41
 
+// Call of a function in a postfix expression, the value is the function name
+#define TOK_CALL 42
+
+#define TOK_IMPORT 43
+
+// Text the lexer could not make a token of, the error is in Lexer::error
+#define TOK_ERROR 44
+
 // Whether token is of assignment type
 #define IS_ASSIGNMENT(type) (type == TOK_EQUAL)
 
 // Whether token is of operator type
-#define IS_OPERATOR(type) (type == TOK_PLUS || type == TOK_MINUS || type == TOK_MULT || type == TOK_DIV)
+#define IS_OPERATOR(type) (type == TOK_PLUS || type == TOK_MINUS || type == TOK_MULT || type == TOK_DIV || type == TOK_MOD)
 
 // Whether token is a comparison operator
 #define IS_COMPARISON(type) (type == TOK_LESSER || type == TOK_GREATER || type == TOK_GREATER_EQUAL || type == TOK_LESSER_EQUAL || type == TOK_EQUAL_EQUAL)
 
-// Defines a single token
+// Tokens a lexer allocates at once
+#define TOKEN_BLOCK_SIZE 4096
+
+// Tokens of the first block of a function that has blocks of its own, the
+// next ones double up to TOKEN_BLOCK_SIZE
+#define TOKEN_FIRST_BLOCK_SIZE 256
+
+// Length of a token that is as long or longer
+#define TOKEN_LENGTH_MAX 0xffff
+
+// Defines a single token in 8 bytes, its text is in a name table
 class Token {
 
 public:
 
-	const char * value;
-	int type;
+	// Offset of the text in the name tables, its length up to
+	// TOKEN_LENGTH_MAX, and the type of the token
+	uint32_t offset;
+	uint16_t length;
+	uint16_t type : 15;
+
+	// Whether a lexer made the token in one of its blocks, which it frees
+	uint16_t pooled : 1;
 
 	// Initialize a new token
-	Token(std::string * value, int type) {
-		this->value = value->c_str();
+	Token(uint32_t offset, size_t length, int type, int pooled = 0) {
+		this->offset = offset;
+		this->length = length < TOKEN_LENGTH_MAX ? length : TOKEN_LENGTH_MAX;
 		this->type = type;
+		this->pooled = pooled;
 	}
 
-	Token(char * value, int type) {
-		this->value = value;
-		this->type = type;
+	// Text of the token, followed by a zero
+	const char * value() const {
+		return NameTable::at(offset);
 	}
 
+	// Free a token that is no longer referred to, the tokens of a lexer
+	// are freed with it
+	static void release(Token * tok);
+
 };
 
 class Lexer {
 
 public:
 	Lexer();
+	~Lexer();
 
 	// Number of lines parsed
 	int n_lines;
 
+	// Column of the last token, from 1, and its length in the source
+	int column;
+	int length;
+
+	// Start of the last token in the buffer
+	const char * token_begin;
+
 	// A reference to the last token
 	Token * last_token;
 
-	// Return the next token in char buffer
+	// Error of the last TOK_ERROR token, at the position of the token,
+	// NULL before the first, and the number of such tokens made
+	Diagnostic * error;
+	int errors;
+
+	// Return the next token in char buffer, an error is returned as a
+	// TOK_ERROR token and lexing goes on after it
 	Token * next_token();
 
 	// Sets the internal buffer to the code pointed to by argument
-	void set_input_code(char * buffer);
+	void set_input_code(const char * buffer);
+
+	// Go on lexing from [position] in the buffer, which is on [line]
+	void set_position(const char * position, int line);
+
+	// Count tokens and time lexing in [stats], NULL to stop
+	void set_stats(Stats * stats);
+
+	// Return a new token, which lives until the lexer releases it
+	Token * make_token(const char * value, int type);
+	Token * make_token(uint32_t offset, size_t length, int type);
+
+	// Keep the tokens and names made so far when the others are released,
+	// the ones of the prelude every source is parsed on
+	void keep();
+
+	// Free the tokens and names made since keep(), nothing may refer to them
+	void release();
+
+	// Make the next tokens in blocks of their own, until take_tokens()
+	void begin_tokens();
+
+	// Return the blocks of the tokens made since begin_tokens(), the next
+	// tokens go to the blocks of the lexer again
+	std::vector<Token *> take_tokens();
+
+	// Free blocks returned by take_tokens()
+	static void free_tokens(std::vector<Token *> & blocks);
 
 private:
-	char * buffer;
-	char * pt;
+	const char * buffer;
+	const char * pt;
+
+	// Start of the line being lexed
+	const char * line_begin;
+
+	// Lexing time and token count, NULL if not collected
+	Phase * lex_phase;
+	long * n_tokens;
+
+	// Blocks of the tokens made so far, one after the other in each block
+	// so that the tokens of an expression are next to each other, the
+	// number of tokens made in the last block, its size and the size of
+	// the next one
+	std::vector<Token *> blocks;
+	int block_used;
+	int block_size;
+	int next_block_size;
+
+	// Blocks kept by keep(), and the tokens made in the last one
+	size_t kept_blocks;
+	int kept_used;
+	int kept_size;
+
+	// First block made since begin_tokens(), -1 outside of it, and the
+	// tokens made in the block before it
+	long taken_blocks;
+	int taken_used;
+	int taken_size;
+
+	// Scan the next token
+	Token * scan_token();
+
+	// Keep [diagnostic] as the error of the token being scanned and set
+	// [type] to TOK_ERROR and [size] to 0, return the value of the token
+	uint32_t fail(const Diagnostic & diagnostic, int & type, size_t & size);
 
 	// A list of tokens and their corresponding token ids
 	std::unordered_map<std::string, int> symbols;
-	std::unordered_map<std::string, int> keywords;
+	std::unordered_map<std::string_view, int> keywords;
+
+	// Names, numbers and strings lexed so far, each stored once in names
+	// until the lexer releases them, and the ones it keeps, by their text
+	NameTable names;
+	std::unordered_map<std::string_view, uint32_t> interned;
+	std::unordered_map<std::string_view, uint32_t> kept;
+
+	// Return the offset of the stored copy of [value]
+	uint32_t intern(std::string_view value);
+
+	// The value getters return the offset of the value of the token and
+	// set [size] to its length
 
 	// Used to parse a string for an integer or a float
-	std::string * get_number(int &type);
+	uint32_t get_number(int &type, size_t &size);
 
 	// Get a string
-	std::string * get_string(char delimiter, int &type);
+	uint32_t get_string(char delimiter, int &type, size_t &size);
 
 	// Get a reserved keyword or variable name
-	std::string * get_keyword(int &type);
+	uint32_t get_keyword(int &type, size_t &size);
 
 	// Get a symbol, for instance a + or a - sign
-	std::string * get_symbol(int &type);
+	uint32_t get_symbol(int &type, size_t &size);
 };
 
 #endif /* LEXER_H_ */
@@ -0,0 +1,868 @@
+/*
+ * llvm_translator.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stack>
+
+#include "llvm_translator.h"
+#include "expression.h"
+#include "error.h"
+
+// Type of comparison results, not a DPL type
+#define IR_BOOL -1
+
+LLVMTranslator::LLVMTranslator() : Translator() {
+
+	this->fallback = NULL;
+	this->error = NULL;
+	this->function = NULL;
+	this->n_values = 0;
+	this->n_labels = 0;
+
+	// Define IR types
+	ir_types[TOK_INT] = "i32";
+	ir_types[TOK_FLOAT] = "float";
+	ir_types[TOK_STRING] = "i8*";
+	ir_types[TOK_NULL] = "void";
+	ir_types[IR_BOOL] = "i1";
+
+	// Define C types for the boundary to C++
+	c_types[TOK_INT] = "int";
+	c_types[TOK_FLOAT] = "float";
+	c_types[TOK_STRING] = "const char *";
+	c_types[TOK_NULL] = "void";
+}
+
+// Set the stream that C++ for inline code is written to
+void LLVMTranslator::set_fallback_output(std::ostream * fallback) {
+	this->fallback = fallback;
+}
+
+// Whether the last translated program needs the C++ fallback
+int LLVMTranslator::has_fallback() {
+	return ! opaque.empty() || ! injections.empty();
+}
+
+LLVMTranslator::~LLVMTranslator() {
+	delete error;
+}
+
+// Only the first error is reported, the others may follow from it
+void LLVMTranslator::fail(const Diagnostic & diagnostic) {
+	if(! error)
+		error = new Diagnostic(diagnostic);
+}
+
+// Takes in a program as argument and translates it into IR
+int LLVMTranslator::translate(Program * program) {
+	GlobalProgram * global;
+
+	delete error;
+	error = NULL;
+
+	this->program = program;
+	global = static_cast<GlobalProgram *>(program);
+
+	// The fallback refers to the string table of the program
+	this->strings = global;
+	this->streaming = 0;
+	this->translations.clear();
+
+	addresses.clear();
+	opaque.clear();
+	return_types.clear();
+	variable_types.clear();
+	arguments.clear();
+	injections.clear();
+
+	// Find the functions that have to be translated to C++
+	for(auto & function : *global->functions) {
+		if(function.second->has_inline_code())
+			opaque[function.second] = 1;
+
+		for(auto arg : function.second->get_arguments())
+			arguments[arg] = 1;
+	}
+
+	*out << "; DPL program" << std::endl;
+	*out << "declare i32 @strcmp(i8*, i8*)" << std::endl;
+
+	declare_ir_strings();
+	declare_ir_globals();
+
+	for(auto & function : *global->functions) {
+		if(opaque.count(function.second))
+			continue;
+
+		if(trace)
+			trace->begin(function.first, "translate");
+
+		define_ir_function(function.second);
+
+		if(trace)
+			trace->end();
+
+		if(error)
+			return 0;
+	}
+
+	define_ir_main();
+	declare_ir_functions();
+
+	if(has_fallback()) {
+		if(! fallback) {
+			fail(Diagnostic(T_CRIT, "%s", "program contains inline code, which requires a C++ fallback output.\n"));
+			return 0;
+		}
+
+		write_fallback();
+	}
+
+	return ! error;
+}
+
+// Output each string literal as a private constant
+void LLVMTranslator::declare_ir_strings() {
+	GlobalProgram * global;
+	int i = 0;
+
+	global = static_cast<GlobalProgram *>(this->program);
+	string_lengths.clear();
+
+	*out << std::endl;
+
+	for(auto & literal : *global->strings) {
+		std::string value = unescape_string(literal.c_str());
+
+		string_lengths.push_back(value.size() + 1);
+		*out << "@.str." << i++ << " = private unnamed_addr constant [" << value.size() + 1 << " x i8] c\"";
+
+		for(unsigned char c : value) {
+			if(c == '"' || c == '\\' || ! isprint(c)) {
+				char hex[4];
+				snprintf(hex, sizeof(hex), "\\%02X", c);
+				*out << hex;
+			}
+			else
+				*out << c;
+		}
+
+		*out << "\\00\"" << std::endl;
+	}
+}
+
+// Output the global variables, initialized to zero
+void LLVMTranslator::declare_ir_globals() {
+	scopes.assign(1, program);
+
+	for(auto & var : *program->variables) {
+		int type = variable_type(var.second);
+
+		addresses[var.second] = std::string("@") + var.second->name;
+		*out << "@" << var.second->name << " = global " << ir_types[type] << " "
+				<< (type == TOK_STRING ? "null" : type == TOK_FLOAT ? "0.0" : "0") << std::endl;
+	}
+
+	*out << std::endl;
+}
+
+// Output declarations of the functions defined by the C++ fallback
+void LLVMTranslator::declare_ir_functions() {
+	for(auto & function : opaque) {
+		std::string params;
+
+		for(int i = 0; i < function.first->get_arguments_size(); i++) {
+			Argument * arg = function.first->get_argument(i);
+
+			params += (i ? ", " : "") + ir_types[variable_type(arg)];
+		}
+
+		*out << "declare " << ir_types[function_type(function.first)] << " @dpl_ffi_" << function.first->name
+				<< "(" << params << ")" << std::endl;
+	}
+
+	for(size_t i = 0; i < injections.size(); i++)
+		*out << "declare void @dpl_inline_" << i << "()" << std::endl;
+}
+
+// Define a function in IR, arguments are stored in stack slots so that
+// they can be treated like any other variable
+void LLVMTranslator::define_ir_function(Function * function) {
+	int type = function_type(function);
+	std::string params, slots, attributes;
+
+	this->function = function;
+	n_values = 0;
+	n_labels = 0;
+	scopes.assign(1, program);
+	scopes.push_back(function);
+
+	for(int i = 0; i < function->get_arguments_size(); i++) {
+		Argument * arg = function->get_argument(i);
+		std::string ty = ir_types[variable_type(arg)];
+		std::string address = std::string("%") + arg->name + ".addr";
+
+		params += (i ? ", " : "") + ty + " %a." + arg->name;
+		slots += "  " + address + " = alloca " + ty + "\n";
+		slots += "  store " + ty + " %a." + arg->name + ", " + ty + "* " + address + "\n";
+
+		addresses[arg] = address;
+	}
+
+	// Stack slots are the only memory a pure function writes
+	if(function->purity == PURITY_PURE)
+		attributes = " readnone";
+	else if(function->purity == PURITY_READS_GLOBALS)
+		attributes = " readonly";
+
+	*out << "define " << ir_types[type] << " @" << function->name << "(" << params << ")" << attributes << " {" << std::endl;
+	*out << "entry:" << std::endl << slots;
+	block = "entry";
+
+	allocate_variables(function);
+	lower_program(function);
+
+	// Functions without a return at the end of each path
+	if(type == TOK_NULL)
+		*out << "  ret void" << std::endl;
+	else
+		*out << "  ret " << ir_types[type] << " " << (type == TOK_STRING ? "null" : type == TOK_FLOAT ? "0.0" : "0") << std::endl;
+
+	*out << "}" << std::endl << std::endl;
+}
+
+// Define the main function, which runs the instructions of the global scope
+void LLVMTranslator::define_ir_main() {
+	this->function = NULL;
+	n_values = 0;
+	n_labels = 0;
+	scopes.assign(1, program);
+
+	*out << "define i32 @main() {" << std::endl << "entry:" << std::endl;
+	block = "entry";
+
+	// Global variables are module globals, only blocks need stack slots
+	for(auto ins : program->get_instructions()) {
+		if(ins->type == TYPE_IF_STATEMENT)
+			allocate_variables(static_cast<IfStatement *>(ins)->program);
+	}
+
+	lower_program(program);
+
+	*out << "  ret i32 0" << std::endl << "}" << std::endl << std::endl;
+}
+
+// Allocate a stack slot for every variable in program and its blocks, a
+// block stores to the variables of its function and only has the ones
+// that are first assigned in it
+void LLVMTranslator::allocate_variables(Program * program) {
+	for(auto & var : *program->variables) {
+		if(program->resolve_variable(var.second->name) != var.second)
+			continue;
+
+		std::string address = "%v" + std::to_string(n_values++) + "." + var.second->name;
+
+		addresses[var.second] = address;
+		*out << "  " << address << " = alloca " << ir_types[variable_type(var.second)] << std::endl;
+	}
+
+	for(auto ins : program->get_instructions()) {
+		if(ins->type == TYPE_IF_STATEMENT)
+			allocate_variables(static_cast<IfStatement *>(ins)->program);
+	}
+}
+
+// Translate the instructions of a program
+void LLVMTranslator::lower_program(Program * program) {
+	for(auto ins : program->get_instructions())
+		lower_instruction(ins);
+}
+
+// Translate a single instruction
+void LLVMTranslator::lower_instruction(Instruction * instruction) {
+	std::string value;
+	int type;
+
+	switch(instruction->type) {
+
+	// Store in the slot of the variable the name refers to
+	case TYPE_ASSIGNMENT: {
+		Assignment * assignment = static_cast<Assignment *>(instruction);
+		Variable * var = resolve(assignment->variable->name);
+		int var_type = variable_type(var);
+		std::string ty = ir_types[var_type];
+
+		value = lower_expression(assignment->variable->value, type);
+		value = convert(value, type, var_type);
+
+		*out << "  store " << ty << " " << value << ", " << ty << "* " << addresses[var] << std::endl;
+		break;
+	}
+
+	case TYPE_RETURN: {
+		int return_type = function_type(function);
+
+		value = lower_expression(static_cast<ReturnOperation *>(instruction)->value, type);
+
+		if(return_type == TOK_NULL)
+			*out << "  ret void" << std::endl;
+		else
+			*out << "  ret " << ir_types[return_type] << " " << convert(value, type, return_type) << std::endl;
+
+		// Anything after a return is unreachable
+		start_block(new_label());
+		break;
+	}
+
+	case TYPE_IF_STATEMENT: {
+		IfStatement * statement = static_cast<IfStatement *>(instruction);
+		std::string then_label = new_label(), end_label = new_label();
+
+		value = lower_expression(statement->expression, type);
+		value = convert(value, type, IR_BOOL);
+
+		*out << "  br i1 " << value << ", label %" << then_label << ", label %" << end_label << std::endl;
+		start_block(then_label);
+
+		scopes.push_back(statement->program);
+		lower_program(statement->program);
+		scopes.pop_back();
+
+		*out << "  br label %" << end_label << std::endl;
+		start_block(end_label);
+		break;
+	}
+
+	case TYPE_FUNCTIONCALL: {
+		FunctionCall * call = static_cast<FunctionCall *>(instruction);
+		std::vector<std::string> values;
+		std::vector<int> value_types;
+
+		for(auto arg : call->get_arguments()) {
+			values.push_back(lower_expression(arg, type));
+			value_types.push_back(type);
+		}
+
+		lower_call(call->function, values, value_types);
+		break;
+	}
+
+	// Inline code in the global scope is called from the C++ fallback
+	case TYPE_INLINE_INJECTION:
+		*out << "  call void @dpl_inline_" << injections.size() << "()" << std::endl;
+		injections.push_back(static_cast<InlineInjection *>(instruction));
+		break;
+	}
+}
+
+// Translate a call to [callee], the arguments are converted to the types
+// of the parameters. Functions with inline code are called through their shim.
+std::string LLVMTranslator::lower_call(Function * callee, std::vector<std::string> & values, std::vector<int> & value_types) {
+	int type = function_type(callee);
+	std::string args, result;
+
+	for(int i = 0; i < callee->get_arguments_size(); i++) {
+		int arg_type = variable_type(callee->get_argument(i));
+
+		args += (i ? ", " : "") + ir_types[arg_type] + " " + convert(values[i], value_types[i], arg_type);
+	}
+
+	*out << "  ";
+
+	if(type != TOK_NULL) {
+		result = new_value();
+		*out << result << " = ";
+	}
+
+	*out << "call " << ir_types[type] << " @" << (opaque.count(callee) ? "dpl_ffi_" : "") << callee->name
+			<< "(" << args << ")" << std::endl;
+
+	return result;
+}
+
+// Translate an infix expression by evaluating its postfix form on a stack
+// of operands, [type] is set to the type of the result
+std::string LLVMTranslator::lower_expression(std::vector<Token *> * infix, int & type) {
+	GlobalProgram * global;
+	std::vector<Token *> * postfix;
+	std::stack<std::pair<std::string, int>> values;
+	std::vector<size_t> rights;
+
+	// Block the left operand of each && and || ends in and the block both
+	// operands join in, by the index of the operator
+	std::unordered_map<size_t, std::pair<std::string, std::string>> joins;
+
+	global = static_cast<GlobalProgram *>(this->program);
+	postfix = expr::infix_to_post(infix);
+	rights = expr::right_operands(postfix, global);
+
+	for(size_t i = 0; i < postfix->size(); i++) {
+		Token * tok = (*postfix)[i];
+
+		if(error)
+			break;
+
+		// The left operand of && or || is done, the right one is branched
+		// over when it decides
+		if(rights[i]) {
+			std::string left = convert(values.top().first, values.top().second, IR_BOOL);
+			std::string right_label = new_label(), join_label = new_label();
+
+			if((*postfix)[rights[i]]->type == TOK_AND)
+				*out << "  br i1 " << left << ", label %" << right_label << ", label %" << join_label << std::endl;
+			else
+				*out << "  br i1 " << left << ", label %" << join_label << ", label %" << right_label << std::endl;
+
+			joins[rights[i]] = std::make_pair(block, join_label);
+			values.top() = std::make_pair(left, IR_BOOL);
+			start_block(right_label);
+		}
+
+		switch(tok->type) {
+
+		case TOK_INT:
+			values.push(std::make_pair(std::string(tok->value()), TOK_INT));
+			break;
+
+		// Float constants are written as the hex of the double they round to
+		case TOK_FLOAT: {
+			double d = (float) strtod(tok->value(), NULL);
+			unsigned long long bits;
+			char hex[24];
+
+			memcpy(&bits, &d, sizeof(bits));
+			snprintf(hex, sizeof(hex), "0x%016llX", bits);
+
+			values.push(std::make_pair(std::string(hex), TOK_FLOAT));
+			break;
+		}
+
+		case TOK_STRING: {
+			int index = global->get_string(tok->value());
+			std::string array = "[" + std::to_string(string_lengths[index]) + " x i8]";
+
+			values.push(std::make_pair("getelementptr inbounds (" + array + ", " + array + "* @.str." + std::to_string(index)
+					+ ", i64 0, i64 0)", TOK_STRING));
+			break;
+		}
+
+		case TOK_NAME: {
+			Variable * var = resolve(tok->value());
+
+			if(! var) {
+				fail(Diagnostic(T_CRIT, "undefined variable %s.\n", tok->value()));
+				break;
+			}
+
+			std::string value = new_value();
+			std::string ty = ir_types[variable_type(var)];
+
+			*out << "  " << value << " = load " << ty << ", " << ty << "* " << addresses[var] << std::endl;
+			values.push(std::make_pair(value, variable_type(var)));
+			break;
+		}
+
+		case TOK_CALL: {
+			Function * callee = global->get_function(tok->value());
+			int n = callee->get_arguments_size();
+			std::vector<std::string> args(n);
+			std::vector<int> arg_types(n);
+
+			for(int i = n - 1; i >= 0; i--) {
+				args[i] = values.top().first;
+				arg_types[i] = values.top().second;
+				values.pop();
+			}
+
+			if(function_type(callee) == TOK_NULL) {
+				fail(Diagnostic(T_CRIT, "function %s has no return value.\n", tok->value()));
+				break;
+			}
+
+			std::string value = lower_call(callee, args, arg_types);
+			values.push(std::make_pair(value, function_type(callee)));
+			break;
+		}
+
+		default: {
+			if(! expr::precedence(tok->type) || values.size() < 2) {
+				fail(Diagnostic(T_CRIT, "unexpected '%s' in expression, not supported by the LLVM backend.\n", tok->value()));
+				break;
+			}
+
+			std::pair<std::string, int> b = values.top();
+			values.pop();
+			std::pair<std::string, int> a = values.top();
+			values.pop();
+
+			std::string value = new_value();
+			int result;
+
+			// Logical and or or, the value of the left operand decides when
+			// the right one was branched over
+			if(tok->type == TOK_AND || tok->type == TOK_OR) {
+				std::pair<std::string, std::string> & join = joins.at(i);
+				std::string y = convert(b.first, b.second, IR_BOOL);
+				std::string from = block;
+
+				*out << "  br label %" << join.second << std::endl;
+				start_block(join.second);
+
+				*out << "  " << value << " = phi i1 [ " << (tok->type == TOK_AND ? "false" : "true") << ", %" << join.first
+						<< " ], [ " << y << ", %" << from << " ]" << std::endl;
+				result = IR_BOOL;
+			}
+
+			// Strings are compared through strcmp
+			else if(a.second == TOK_STRING || b.second == TOK_STRING) {
+				if(a.second != b.second || ! IS_COMPARISON(tok->type)) {
+					fail(Diagnostic(T_CRIT, "operator '%s' on strings is not supported by the LLVM backend.\n", tok->value()));
+					break;
+				}
+
+				std::string cmp = new_value();
+				const char * pred = tok->type == TOK_GREATER ? "sgt" : tok->type == TOK_LESSER ? "slt"
+						: tok->type == TOK_GREATER_EQUAL ? "sge" : tok->type == TOK_LESSER_EQUAL ? "sle" : "eq";
+
+				*out << "  " << cmp << " = call i32 @strcmp(i8* " << a.first << ", i8* " << b.first << ")" << std::endl;
+				*out << "  " << value << " = icmp " << pred << " i32 " << cmp << ", 0" << std::endl;
+				result = IR_BOOL;
+			}
+
+			// Arithmetic and comparison of numbers
+			else {
+				int operand = (a.second == TOK_FLOAT || b.second == TOK_FLOAT) ? TOK_FLOAT : TOK_INT;
+				std::string x = convert(a.first, a.second, operand);
+				std::string y = convert(b.first, b.second, operand);
+				const char * op;
+
+				if(IS_COMPARISON(tok->type)) {
+					if(operand == TOK_FLOAT)
+						op = tok->type == TOK_GREATER ? "fcmp ogt" : tok->type == TOK_LESSER ? "fcmp olt"
+								: tok->type == TOK_GREATER_EQUAL ? "fcmp oge" : tok->type == TOK_LESSER_EQUAL ? "fcmp ole" : "fcmp oeq";
+					else
+						op = tok->type == TOK_GREATER ? "icmp sgt" : tok->type == TOK_LESSER ? "icmp slt"
+								: tok->type == TOK_GREATER_EQUAL ? "icmp sge" : tok->type == TOK_LESSER_EQUAL ? "icmp sle" : "icmp eq";
+
+					result = IR_BOOL;
+				}
+
+				else {
+					if(operand == TOK_FLOAT)
+						op = tok->type == TOK_PLUS ? "fadd" : tok->type == TOK_MINUS ? "fsub"
+								: tok->type == TOK_MULT ? "fmul" : tok->type == TOK_DIV ? "fdiv" : "frem";
+					else
+						op = tok->type == TOK_PLUS ? "add" : tok->type == TOK_MINUS ? "sub"
+								: tok->type == TOK_MULT ? "mul" : tok->type == TOK_DIV ? "sdiv" : "srem";
+
+					result = operand;
+				}
+
+				*out << "  " << value << " = " << op << " " << ir_types[operand] << " " << x << ", " << y << std::endl;
+			}
+
+			values.push(std::make_pair(value, result));
+			break;
+		}
+
+		}
+	}
+
+	expr::release_post(postfix);
+
+	// The rest of the function is translated with a placeholder value
+	if(error || values.size() != 1) {
+		fail(Diagnostic(T_CRIT, "%s", "faulty expression.\n"));
+
+		type = TOK_INT;
+		return "0";
+	}
+
+	type = values.top().second;
+	return values.top().first;
+}
+
+// Determine the type of an infix expression
+int LLVMTranslator::infer_type(std::vector<Token *> * infix) {
+	GlobalProgram * global;
+	std::vector<Token *> * postfix;
+	std::stack<int> types;
+
+	global = static_cast<GlobalProgram *>(this->program);
+	postfix = expr::infix_to_post(infix);
+
+	for(auto tok : *postfix) {
+		if(tok->type == TOK_INT || tok->type == TOK_FLOAT || tok->type == TOK_STRING)
+			types.push(tok->type);
+
+		else if(tok->type == TOK_NAME) {
+			Variable * var = resolve(tok->value());
+			types.push(var ? variable_type(var) : TOK_INT);
+		}
+
+		else if(tok->type == TOK_CALL) {
+			Function * callee = global->get_function(tok->value());
+
+			for(int i = 0; i < callee->get_arguments_size() && ! types.empty(); i++)
+				types.pop();
+
+			types.push(function_type(callee));
+		}
+
+		else if(expr::precedence(tok->type) && types.size() >= 2) {
+			int b = types.top();
+			types.pop();
+			int a = types.top();
+			types.pop();
+
+			if(IS_COMPARISON(tok->type) || tok->type == TOK_AND || tok->type == TOK_OR)
+				types.push(IR_BOOL);
+			else if(a == TOK_STRING || b == TOK_STRING)
+				types.push(TOK_STRING);
+			else
+				types.push((a == TOK_FLOAT || b == TOK_FLOAT) ? TOK_FLOAT : TOK_INT);
+		}
+	}
+
+	expr::release_post(postfix);
+
+	return types.empty() ? TOK_NULL : types.top();
+}
+
+// Convert a value between types
+std::string LLVMTranslator::convert(std::string value, int from, int to) {
+	std::string result;
+
+	if(from == to)
+		return value;
+
+	if(from == TOK_STRING || to == TOK_STRING) {
+		fail(Diagnostic(T_CRIT, "%s", "conversion between strings and numbers is not supported by the LLVM backend.\n"));
+		return value;
+	}
+
+	// Booleans are widened to ints first
+	if(from == IR_BOOL) {
+		result = new_value();
+		*out << "  " << result << " = zext i1 " << value << " to i32" << std::endl;
+
+		return convert(result, TOK_INT, to);
+	}
+
+	result = new_value();
+
+	if(to == IR_BOOL && from == TOK_FLOAT)
+		*out << "  " << result << " = fcmp une float " << value << ", 0.0" << std::endl;
+	else if(to == IR_BOOL)
+		*out << "  " << result << " = icmp ne i32 " << value << ", 0" << std::endl;
+	else if(to == TOK_FLOAT)
+		*out << "  " << result << " = sitofp i32 " << value << " to float" << std::endl;
+	else
+		*out << "  " << result << " = fptosi float " << value << " to i32" << std::endl;
+
+	return result;
+}
+
+// Return the type of a variable, for variables whose type was not known
+// while parsing the type of the assigned value is used, for arguments
+// that were never called with a value int is assumed
+int LLVMTranslator::variable_type(Variable * variable) {
+	if(variable->type == TOK_INT || variable->type == TOK_FLOAT || variable->type == TOK_STRING)
+		return variable->type;
+
+	if(arguments.count(variable) || ! variable->value)
+		return TOK_INT;
+
+	auto it = variable_types.find(variable);
+
+	if(it != variable_types.end())
+		return it->second;
+
+	// Guard against variables defined in terms of themselves
+	variable_types[variable] = TOK_INT;
+
+	int type = infer_type(variable->value);
+
+	if(type != TOK_FLOAT && type != TOK_STRING)
+		type = TOK_INT;
+
+	return variable_types[variable] = type;
+}
+
+// Return the return type of a function, inferred from its return
+// operations when the parser could not determine it
+int LLVMTranslator::function_type(Function * function) {
+	int type = function->get_return_type();
+
+	if(type == TOK_INT || type == TOK_FLOAT || type == TOK_STRING)
+		return type;
+
+	auto it = return_types.find(function);
+
+	if(it != return_types.end())
+		return it->second;
+
+	// Guard against recursion
+	return_types[function] = TOK_INT;
+
+	std::vector<Program *> saved = scopes;
+
+	scopes.assign(1, program);
+	scopes.push_back(function);
+	type = infer_return_type(function);
+	scopes = saved;
+
+	if(type == IR_BOOL)
+		type = TOK_INT;
+
+	return return_types[function] = type;
+}
+
+// Find the type of the first return operation in program
+int LLVMTranslator::infer_return_type(Program * program) {
+	for(auto ins : program->get_instructions()) {
+		int type = TOK_NULL;
+
+		if(ins->type == TYPE_RETURN)
+			return infer_type(static_cast<ReturnOperation *>(ins)->value);
+
+		if(ins->type == TYPE_IF_STATEMENT) {
+			scopes.push_back(static_cast<IfStatement *>(ins)->program);
+			type = infer_return_type(static_cast<IfStatement *>(ins)->program);
+			scopes.pop_back();
+		}
+
+		if(type != TOK_NULL)
+			return type;
+	}
+
+	return TOK_NULL;
+}
+
+// Resolve a variable from the innermost scope, see Program::resolve_variable
+Variable * LLVMTranslator::resolve(const char * name) {
+	return scopes.back()->resolve_variable(name);
+}
+
+// Return a new value name
+std::string LLVMTranslator::new_value() {
+	return "%t" + std::to_string(n_values++);
+}
+
+// Return a new label
+std::string LLVMTranslator::new_label() {
+	return "L" + std::to_string(n_labels++);
+}
+
+// Start a new basic block
+void LLVMTranslator::start_block(std::string label) {
+	*out << label << ":" << std::endl;
+	block = label;
+}
+
+// Output the C++ fallback: declarations of everything defined in IR, the
+// functions with inline code, their C shims and the global inline code
+void LLVMTranslator::write_fallback() {
+	GlobalProgram * global;
+	std::ostream * ir;
+
+	global = static_cast<GlobalProgram *>(this->program);
+	ir = out;
+	out = fallback;
+
+	default_includes();
+	declare_strings();
+
+	*out << std::endl;
+
+	// Global variables defined in IR
+	for(auto & var : *global->variables)
+		*out << "extern \"C\" " << c_types[variable_type(var.second)] << " " << var.second->name << ";" << std::endl;
+
+	// Functions defined in IR, strings cross the boundary as C strings
+	for(auto & function : *global->functions) {
+		Function * f = function.second;
+		int type = function_type(f), strings = type == TOK_STRING;
+		std::string c_params, params, args;
+
+		if(opaque.count(f))
+			continue;
+
+		for(int i = 0; i < f->get_arguments_size(); i++) {
+			Argument * arg = f->get_argument(i);
+			int arg_type = variable_type(arg);
+
+			c_params += (i ? ", " : "") + c_types[arg_type] + " " + arg->name;
+			params += (i ? ", " : "") + types[arg_type] + " " + arg->name;
+			args += (i ? ", " : "") + std::string(arg->name) + (arg_type == TOK_STRING ? ".c_str()" : "");
+			strings |= arg_type == TOK_STRING;
+		}
+
+		if(! strings) {
+			*out << "extern \"C\" " << c_types[type] << " " << f->name << "(" << c_params << ");" << std::endl;
+			continue;
+		}
+
+		// Wrap functions taking or returning strings in one using runtime strings,
+		// the IR function is declared under another name through an asm label
+		*out << c_types[type] << " dpl_ir_" << f->name << "(" << c_params << ") __asm__(\"" << f->name << "\");" << std::endl;
+		*out << "static inline " << types[type] << " " << f->name << "(" << params << ") { return "
+				<< (type == TOK_STRING ? "dpl::string(" : "(") << "dpl_ir_" << f->name << "(" << args << ")); }" << std::endl;
+	}
+
+	*out << std::endl;
+
+	// Functions with inline code
+	for(auto & function : opaque)
+		*out << function_signature(function.first) << ";" << std::endl;
+
+	*out << std::endl;
+
+	for(auto & function : opaque)
+		define_function(function.first);
+
+	// Shims called from IR, functions that were never called are skipped
+	for(auto & function : opaque) {
+		Function * f = function.first;
+		int type = function_type(f), called = 1;
+		std::string c_params, args;
+
+		for(int i = 0; i < f->get_arguments_size(); i++) {
+			Argument * arg = f->get_argument(i);
+			int arg_type = variable_type(arg);
+
+			called &= arg->type == arg_type;
+			c_params += (i ? ", " : "") + c_types[arg_type] + " " + arg->name;
+			args += (i ? ", " : "") + (arg_type == TOK_STRING ? "dpl::string(" + std::string(arg->name) + ")" : std::string(arg->name));
+		}
+
+		if(! called)
+			continue;
+
+		*out << "extern \"C\" " << c_types[type] << " dpl_ffi_" << f->name << "(" << c_params << ") {" << std::endl;
+
+		if(type == TOK_NULL)
+			*out << f->name << "(" << args << ");" << std::endl;
+		else if(type == TOK_STRING)
+			*out << "return strdup(" << f->name << "(" << args << ").c_str());" << std::endl;
+		else
+			*out << "return " << f->name << "(" << args << ");" << std::endl;
+
+		*out << "}" << std::endl << std::endl;
+	}
+
+	// Inline code of the global scope
+	for(size_t i = 0; i < injections.size(); i++) {
+		*out << "extern \"C\" void dpl_inline_" << i << "() {" << std::endl;
+		translate_inline_injection(injections[i]);
+		*out << std::endl << "}" << std::endl << std::endl;
+	}
+
+	out = ir;
+}
@@ -0,0 +1,151 @@
+/*
+ * llvm_translator.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#ifndef LLVM_TRANSLATOR_H_
+#define LLVM_TRANSLATOR_H_
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "translator.h"
+#include "error.h"
+
+// Translates a program into textual LLVM IR, which llc assembles without
+// any C++ frontend. Functions containing inline C/C++ code, and inline code
+// in the global scope, are written as C++ to a separate fallback stream that
+// is compiled and linked together with the IR.
+class LLVMTranslator : public Translator {
+
+public:
+	LLVMTranslator();
+	~LLVMTranslator();
+
+	// Translate a program into LLVM IR, return 0 if it uses something the
+	// backend does not support, which is kept in error
+	int translate(Program * program);
+
+	// First error of the last translation, NULL if it had none
+	Diagnostic * error;
+
+	// Set the stream that C++ for inline code is written to
+	void set_fallback_output(std::ostream * fallback);
+
+	// Whether the last translated program needs the C++ fallback
+	int has_fallback();
+
+private:
+	// C++ fallback stream
+	std::ostream * fallback;
+
+	// IR types of DPL types
+	std::unordered_map<int, std::string> ir_types;
+
+	// C types used for values crossing between IR and C++
+	std::unordered_map<int, std::string> c_types;
+
+	// IR address of each variable slot
+	std::unordered_map<Variable *, std::string> addresses;
+
+	// Functions that contain inline code, translated to C++
+	std::unordered_map<Function *, int> opaque;
+
+	// Inferred return types
+	std::unordered_map<Function *, int> return_types;
+
+	// Inferred variable types
+	std::unordered_map<Variable *, int> variable_types;
+
+	// Arguments of every function
+	std::unordered_map<Variable *, int> arguments;
+
+	// Length of each string literal constant, including the terminating zero
+	std::vector<size_t> string_lengths;
+
+	// Inline code in the global scope
+	std::vector<InlineInjection *> injections;
+
+	// Scopes used to resolve names, innermost last
+	std::vector<Program *> scopes;
+
+	// Function being translated, NULL while translating main
+	Function * function;
+
+	// Counters for values and labels of the current function
+	int n_values;
+	int n_labels;
+
+	// Label of the basic block being written
+	std::string block;
+
+	// Keep [diagnostic] unless the translation already failed, the
+	// translation goes on to the end of the function
+	void fail(const Diagnostic & diagnostic);
+
+	// Output the IR constants of the string literal table
+	void declare_ir_strings();
+
+	// Output the global variables
+	void declare_ir_globals();
+
+	// Output declarations of external functions
+	void declare_ir_functions();
+
+	// Define a function in IR
+	void define_ir_function(Function * function);
+
+	// Define main in IR
+	void define_ir_main();
+
+	// Allocate stack slots for the variables of program and its blocks that
+	// are their own
+	void allocate_variables(Program * program);
+
+	// Translate the instructions of a program
+	void lower_program(Program * program);
+
+	// Translate a single instruction
+	void lower_instruction(Instruction * instruction);
+
+	// Translate a call and return the resulting value, empty if void
+	std::string lower_call(Function * callee, std::vector<std::string> & values, std::vector<int> & value_types);
+
+	// Translate an infix expression, return the operand holding its value
+	std::string lower_expression(std::vector<Token *> * infix, int & type);
+
+	// Determine the type of an infix expression without translating it
+	int infer_type(std::vector<Token *> * infix);
+
+	// Convert [value] of type [from] to type [to]
+	std::string convert(std::string value, int from, int to);
+
+	// Return the type of a variable, the type of its value if unknown
+	int variable_type(Variable * variable);
+
+	// Return the return type of a function, TOK_NULL if void
+	int function_type(Function * function);
+
+	// Find the return type among the return operations of program
+	int infer_return_type(Program * program);
+
+	// Resolve variable [name] through the scopes
+	Variable * resolve(const char * name);
+
+	// Return a new value name
+	std::string new_value();
+
+	// Return a new label
+	std::string new_label();
+
+	// Start a basic block
+	void start_block(std::string label);
+
+	// Output the C++ fallback for opaque functions and inline code
+	void write_fallback();
+};
+
+#endif /* LLVM_TRANSLATOR_H_ */
@@ -5,28 +5,221 @@
  *      Author: timmy.lindholm
  */
 
-#include <ctime>
-#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include "compiler.h"
+#include "error.h"
+#include "alloc_profile.h"
+#include "server.h"
 
+/*
+ * Usage: dpl [options] file [line start]
+ *
+ * Options:
+ *   --emit-llvm         translate to LLVM IR instead of C++, C++ for inline
+ *                       code is written to <file>.inline.cpp
+ *   --fallback <file>   file for the C++ of inline code with --emit-llvm
+ *   --run               run the program directly instead of translating it,
+ *                       functions with inline code must be builtins
+ *   --vm                like --run, but compiled to register bytecode first
+ *   --stream            translate each function while the rest of the file
+ *                       is parsed, functions are templates on the types of
+ *                       their arguments and the output needs C++14
+ *   --jobs <n>          parse up to n function bodies at the same time,
+ *                       one per hardware thread if 0, the default
+ *   --no-cse            keep the subexpressions a function body repeats,
+ *                       instead of computing each once in a temporary
+ *   --stats             print timers of each phase and counters to stderr
+ *   --stats-json <file> write the timers and counters to file as JSON
+ *   --trace <file>      write spans of the phases and of each function
+ *                       parsed and translated as Chrome trace event JSON
+ *   --diagnostics-json <file>
+ *                       write errors as JSON to file, one object per line
+ *   --diagnostics-sarif <file>
+ *                       write errors to file as a SARIF 2.1.0 log
+ *   --prelude <file>    parse file once and compile the source on top of
+ *                       it, instead of pasting it in front of the source
+ *   --server <socket>   answer compile requests on a Unix domain socket,
+ *                       keeping the compiler, the prelude and translations
+ *                       of earlier requests between them
+ *   --connect <socket>  compile with the server on socket
+ *   --alloc-profile     like --stats, with the bytes still allocated after
+ *                       each phase and the call sites that allocated the
+ *                       most, named if dpl was linked with -rdynamic
+ *
+ * The IR is assembled with llc -relocation-model=pic -filetype=obj and linked
+ * with the fallback, compiled with runtime/ in the include path.
+ */
 int main(int argc, char ** argv) {
-	clock_t start = clock();
+	Compiler compiler;
+	char * file_name = NULL;
+	char * line_start = NULL;
+	char * stats_file = NULL;
+	char * trace_file = NULL;
+	char * diagnostics_json = NULL;
+	char * diagnostics_sarif = NULL;
+	char * prelude_file = NULL;
+	char * server_socket = NULL;
+	char * connect_socket = NULL;
+	int print_stats = 0;
+	int alloc_profile = 0;
+	int status = 0;
 
-	// Spawn a child process
-	if(fork()) {
-		wait(NULL);
+	// Parse options and arguments
+	for(int i = 1; i < argc; i++) {
+		if(! strcmp(argv[i], "--emit-llvm"))
+			compiler.backend = BACKEND_LLVM;
+		else if(! strcmp(argv[i], "--run"))
+			compiler.backend = BACKEND_RUN;
+		else if(! strcmp(argv[i], "--vm"))
+			compiler.backend = BACKEND_VM;
+		else if(! strcmp(argv[i], "--stream"))
+			compiler.stream = 1;
+		else if(! strcmp(argv[i], "--no-cse"))
+			compiler.cse = 0;
+		else if(! strcmp(argv[i], "--jobs") && i + 1 < argc)
+			compiler.jobs = (int) strtol(argv[++i], (char **) NULL, 10);
+		else if(! strcmp(argv[i], "--stats"))
+			print_stats = 1;
+		else if(! strcmp(argv[i], "--alloc-profile"))
+			print_stats = alloc_profile = 1;
+		else if(! strcmp(argv[i], "--stats-json") && i + 1 < argc)
+			stats_file = argv[++i];
+		else if(! strcmp(argv[i], "--trace") && i + 1 < argc)
+			trace_file = argv[++i];
+		else if(! strcmp(argv[i], "--diagnostics-json") && i + 1 < argc)
+			diagnostics_json = argv[++i];
+		else if(! strcmp(argv[i], "--diagnostics-sarif") && i + 1 < argc)
+			diagnostics_sarif = argv[++i];
+		else if(! strcmp(argv[i], "--prelude") && i + 1 < argc)
+			prelude_file = argv[++i];
+		else if(! strcmp(argv[i], "--server") && i + 1 < argc)
+			server_socket = argv[++i];
+		else if(! strcmp(argv[i], "--connect") && i + 1 < argc)
+			connect_socket = argv[++i];
+		else if(! strcmp(argv[i], "--fallback") && i + 1 < argc)
+			compiler.fallback_file = argv[++i];
+		else if(! file_name)
+			file_name = argv[i];
+		else
+			line_start = argv[i];
+	}
 
-		clock_t end = clock();
-		std::cerr << "\nexecution time: " << (double)(end - start) / CLOCKS_PER_SEC * 1000 << " ms" << std::endl;
+	if(! file_name && ! server_socket) {
+		std::cerr << "usage: " << argv[0] << " [--emit-llvm | --run | --vm] [--stream] [--jobs n] [--no-cse] [--fallback file] [--stats] [--stats-json file] [--alloc-profile] [--trace file] [--diagnostics-json file] [--diagnostics-sarif file] [--prelude file] [--server socket | --connect socket] file [line start]" << std::endl;
+		return 1;
 	}
-	else {
-		Compiler compiler;
 
-		compiler.line_start = (argc >= 3) ? ((int) strtol(argv[2], (char **) NULL, 10) - 1) : 0;
-		compiler.compile(argv[1]);
+	// Stats have the heap traffic of the phases, call sites are only profiled on demand
+#ifdef DPL_ALLOC_PROFILE
+	if(print_stats || stats_file)
+		AllocProfile::enable(alloc_profile);
+#else
+	if(alloc_profile) {
+		std::cerr << "Error: --alloc-profile needs dpl built with DPL_ALLOC_PROFILE." << std::endl;
+		return 1;
 	}
+#endif
 
-}
+	if(print_stats || stats_file)
+		compiler.stats = new Stats();
+
+	if(trace_file)
+		compiler.trace = new Trace();
+
+	compiler.line_start = line_start ? ((int) strtol(line_start, (char **) NULL, 10) - 1) : 0;
+
+	// The prelude is parsed here, not by the server that is connected to
+	if(prelude_file && ! connect_socket && ! compiler.load_prelude(prelude_file)) {
+		compiler.diagnostics->print(std::cerr);
+		return 1;
+	}
+
+	if(server_socket) {
+		Server server(&compiler);
+
+		if(! server.serve(server_socket)) {
+			std::cerr << "Error: failed to listen on " << server_socket << "." << std::endl;
+			return 1;
+		}
+
+		return 0;
+	}
+
+	if(connect_socket) {
+		if((status = Server::request(connect_socket, compiler.backend, compiler.line_start, file_name)) < 0) {
+			std::cerr << "Error: failed to connect to " << connect_socket << "." << std::endl;
+			return 1;
+		}
+
+		return status;
+	}
+
+	// All errors are reported at once, the status tells whether there were any
+	status = compiler.compile(file_name) ? 0 : 1;
+	compiler.diagnostics->print(std::cerr);
+
+	if(diagnostics_json) {
+		std::ofstream file(diagnostics_json);
 
+		if(! file) {
+			std::cerr << "Error: failed to write to file " << diagnostics_json << "." << std::endl;
+			return 1;
+		}
 
+		compiler.diagnostics->write_json(file);
+	}
+
+	if(diagnostics_sarif) {
+		std::ofstream file(diagnostics_sarif);
+
+		if(! file) {
+			std::cerr << "Error: failed to write to file " << diagnostics_sarif << "." << std::endl;
+			return 1;
+		}
+
+		compiler.diagnostics->write_sarif(file);
+	}
+
+#ifdef DPL_ALLOC_PROFILE
+	if(compiler.stats)
+		AllocProfile::count(compiler.stats);
+#endif
+
+	if(print_stats) {
+		std::cerr << std::endl;
+		compiler.stats->print(std::cerr);
+	}
+
+#ifdef DPL_ALLOC_PROFILE
+	if(alloc_profile) {
+		std::cerr << std::endl;
+		AllocProfile::report(std::cerr, ALLOC_REPORT_SITES);
+	}
+#endif
 
+	if(stats_file) {
+		std::ofstream file(stats_file);
+
+		if(! file) {
+			std::cerr << "Error: failed to write to file " << stats_file << "." << std::endl;
+			return 1;
+		}
+
+		compiler.stats->write_json(file);
+	}
+
+	if(trace_file) {
+		std::ofstream file(trace_file);
+
+		if(! file) {
+			std::cerr << "Error: failed to write to file " << trace_file << "." << std::endl;
+			return 1;
+		}
+
+		compiler.trace->write(file);
+	}
+
+	return status;
+}
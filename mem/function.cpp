@@ -5,27 +5,52 @@
  *      Author: eatit
  */
 
+#include <cstring>
+
 #include "function.h"
 
 Function::Function(Program * parent_program) : Program(parent_program, PROGRAM_FUNCTION) {
 
 	this->name = NULL;
 	this->arguments = new std::vector<Argument *>;
-	this->args_index = 0;
 	this->return_type = 0;
+	this->caller = 0;
+	this->purity = PURITY_UNKNOWN;
+}
+
+Function::~Function() {
+	for(auto argument : *arguments)
+		delete argument;
+
+	delete arguments;
+
+	Lexer::free_tokens(tokens);
+}
+
+// Get all arguments of the function
+const std::vector<Argument *> & Function::get_arguments() const {
+	return *arguments;
 }
 
-// Get the next argument in argument vector, return 0 if last one
-// and reset index
-Argument * Function::get_next_argument() {
-	Argument * arg;
+// Set the arguments as the last call did
+void Function::apply_call() {
+	std::lock_guard<std::mutex> guard(lock);
+
+	if(call_values.empty())
+		return;
 
-	arg = arguments->at(args_index++);
+	for(size_t i = 0; i < call_values.size(); i++) {
+		arguments->at(i)->value = call_values[i].first;
+		arguments->at(i)->type = call_values[i].second;
+	}
 
-	if(args_index == arguments->size())
-		args_index = 0;
+	if(! return_type)
+		return_type = TOK_AUTO;
+}
 
-	return arg;
+// Get the argument at an index
+Argument * Function::get_argument(int index) {
+	return arguments->at(index);
 }
 
 // Return the size of arguments
@@ -40,10 +65,8 @@ Variable * Function::get_variable(std::string name) {
 
 	// Search arguments
 	for(auto arg : *arguments) {
-		if(! strcmp(arg->name, name.c_str())) {
-			std::cerr << "arg type: " << arg->type << std::endl;
+		if(! strcmp(arg->name, name.c_str()))
 			return arg;
-		}
 	}
 
 	// Search local scope
@@ -86,3 +109,8 @@ int Function::get_return_type() {
 void Function::set_return_type(int type) {
 	return_type = type;
 }
+
+// A function that is not analysed may do anything
+int Function::changes_globals() {
+	return purity == PURITY_UNKNOWN || purity >= PURITY_WRITES_GLOBALS;
+}
@@ -10,20 +10,35 @@
 
 #include <vector>
 #include <map>
+#include <mutex>
 #include "variable.h"
 #include "program.h"
 
+// What a function may read and change, from the purity analysis. Each one
+// includes the ones before it.
+#define PURITY_UNKNOWN 0
+#define PURITY_PURE 1
+#define PURITY_READS_GLOBALS 2
+#define PURITY_WRITES_GLOBALS 3
+#define PURITY_OPAQUE 4
+
 class Function : public Program {
 
 public:
 	Function(Program * parent_program);
 
+	// Delete the arguments, not their values, and the tokens of the body
+	~Function();
+
 	// The name of the function
 	const char * name;
 
-	// Get the next argument in argument vector
-	// return to index 0 after last
-	Argument * get_next_argument();
+	// Get the arguments, in the order of the definition. Any number of
+	// readers may go through them at the same time.
+	const std::vector<Argument *> & get_arguments() const;
+
+	// Get the argument at [index]
+	Argument * get_argument(int index);
 
 	// Return the size of arguments
 	int get_arguments_size();
@@ -46,15 +61,39 @@ public:
 	// Set the return type
 	void set_return_type(int type);
 
+	// Held while a call changes the arguments or the return type, modules
+	// and bodies that call the function may be parsed at the same time
+	std::mutex lock;
+
+	// Key of the call that comes last, by the order of its module and its
+	// position in the source, and the values and types of its arguments.
+	// The arguments take them once the source is parsed, as if the calls
+	// had been parsed one after the other.
+	long long caller;
+	std::vector<std::pair<std::vector<Token *> *, int>> call_values;
+
+	// Give the arguments the values and types of the last call, and a
+	// function that is called without a return type the type auto
+	void apply_call();
+
+	// Whether the function reads only its arguments, reads globals,
+	// changes them through the functions it calls, or has inline code.
+	// Unknown until the purity analysis runs, streamed functions never know.
+	int purity;
+
+	// Whether a call may change globals, as far as purity is known
+	int changes_globals();
+
+	// Blocks of the tokens of a streamed body, which go with the function
+	// instead of staying with the lexer
+	std::vector<Token *> tokens;
+
 private:
 	// The arguments that the function takes
 	std::vector<Argument *> * arguments;
 
 	// The possible return type of the function
 	int return_type;
-
-	// Arguments index
-	int args_index;
 };
 
 #endif /* MEM_FUNCTION_H_ */
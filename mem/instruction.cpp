@@ -17,26 +17,23 @@ FunctionCall::FunctionCall(Function * function) : Instruction(TYPE_FUNCTIONCALL)
 	this->arguments = new std::vector<std::vector<Token *> *>();
 }
 
+FunctionCall::~FunctionCall() {
+	delete arguments;
+}
+
 // Push an argument into the arguments vector
 void FunctionCall::push_argument(std::vector<Token *> * argument) {
 	arguments->push_back(argument);
 }
 
-// Get the next argument in the arguments vector
-std::vector<Token *> * FunctionCall::get_next_argument() {
-	static int i = 0;
-	std::vector<Token *> * arg;
-
-	int len = arguments->size();
-
-	if(i == len) {
-		i = 0;
-		return 0;
-	}
-
-	arg = arguments->at(i++);
+// Replace the argument at an index
+void FunctionCall::set_argument(int index, std::vector<Token *> * argument) {
+	arguments->at(index) = argument;
+}
 
-	return arg;
+// Get all argument values of the call
+const std::vector<std::vector<Token *> *> & FunctionCall::get_arguments() const {
+	return *arguments;
 }
 
 // Initialize a assignment instruction
@@ -36,12 +36,17 @@ class FunctionCall : public Instruction {
 
 public:
 	FunctionCall(Function * function);
+	~FunctionCall();
 
 	// Push an argument into the arguments vector
 	void push_argument(std::vector<Token *> * argument);
 
-	// Get next argument value in the arguments vector
-	std::vector<Token *> * get_next_argument();
+	// Replace the argument at [index]
+	void set_argument(int index, std::vector<Token *> * argument);
+
+	// Get the argument values, in the order of the call. Any number of
+	// readers may go through them at the same time.
+	const std::vector<std::vector<Token *> *> & get_arguments() const;
 
 	// The function assoiciated with the instruction
 	Function * function;
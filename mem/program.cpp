@@ -5,19 +5,32 @@
  *      Author: eatit
  */
 
+#include <cstring>
+
 #include "program.h"
+#include "function.h"
 
 // Initialize a new program
 Program::Program(Program * parent_program, const int program_type)
 : program_type(program_type) {
 	this->parent_program = parent_program;
 	this->variables = new std::unordered_map<std::string, Variable *>();
-	this->instructions = new std::queue<Instruction *>();
+	this->instructions = new std::vector<Instruction *>();
+}
+
+Program::~Program() {
+	delete variables;
+	delete instructions;
 }
 
 // Push a new instruction on to the instruction queue
 void Program::push_instruction(Instruction * instruction) {
-	instructions->push(instruction);
+	instructions->push_back(instruction);
+}
+
+// Insert an instruction before the one at [index]
+void Program::insert_instruction(size_t index, Instruction * instruction) {
+	instructions->insert(instructions->begin() + index, instruction);
 }
 
 // Get the variable [name] in current program
@@ -29,39 +42,173 @@ Variable * Program::get_variable(std::string name) {
 	if((it = variables->find(name)) != variables->end())
 		return it->second;
 
-	// Search global scope
+	// Search enclosing scopes, a block sees the variables of its function
+	if(parent_program != NULL)
+		return parent_program->get_variable(name);
+
+	return 0;
+}
+
+// Get the variable [name] refers to, blocks share the variables of their
+// function or of the global program
+Variable * Program::resolve_variable(const char * name) {
+	std::unordered_map<std::string, Variable *>::iterator it;
 	Program * scope;
-	scope = this;
 
-	while(scope != NULL && scope->program_type != PROGRAM_GLOBAL)
-		scope = scope->parent_program;
+	for(scope = this; scope->program_type == PROGRAM_BLOCK; scope = scope->parent_program);
 
-	if((it = scope->variables->find(name)) != scope->variables->end())
-		return it->second;
+	for(; scope != NULL; scope = scope->parent_program) {
+		if(scope->program_type == PROGRAM_FUNCTION)
+			for(auto argument : static_cast<Function *>(scope)->get_arguments())
+				if(! strcmp(argument->name, name))
+					return argument;
+
+		if((it = scope->variables->find(name)) != scope->variables->end())
+			return it->second;
+	}
+
+	// Only assigned in a block
+	for(scope = this; scope->program_type == PROGRAM_BLOCK; scope = scope->parent_program)
+		if((it = scope->variables->find(name)) != scope->variables->end())
+			return it->second;
 
 	return 0;
 }
 
-
 // Add variable [name] to current program
 void Program::push_variable(Variable * var) {
 	variables->insert(std::pair<std::string, Variable *>(std::string(var->name), var));
 }
 
-// Get the next instruction of the instructions queue
-Instruction * Program::get_next_instruction() {
-	if(instructions->empty())
-		return 0;
+// Whether the program or any of its blocks contains inline code
+int Program::has_inline_code() {
+	for(auto ins : *instructions) {
+		if(ins->type == TYPE_INLINE_INJECTION)
+			return 1;
+
+		if(ins->type == TYPE_IF_STATEMENT && static_cast<IfStatement *>(ins)->program->has_inline_code())
+			return 1;
+	}
+
+	return 0;
+}
+
+// Free the program, tokens are deleted with the expressions they are in
+void Program::release() {
+	std::unordered_set<std::vector<Token *> *> expressions;
+	std::unordered_set<Variable *> variables;
+	std::unordered_set<Token *> tokens;
+
+	release(expressions, variables);
+
+	for(auto expression : expressions) {
+		if(! expression)
+			continue;
+
+		tokens.insert(expression->begin(), expression->end());
+		delete expression;
+	}
+
+	for(auto tok : tokens)
+		Token::release(tok);
+
+	for(auto variable : variables)
+		delete variable;
+}
+
+// Delete the instructions of the program and of its blocks
+void Program::release(std::unordered_set<std::vector<Token *> *> & expressions, std::unordered_set<Variable *> & variables) {
+	std::vector<Token *> * argument;
+	int n;
+
+	expressions.insert(replaced.begin(), replaced.end());
+	replaced.clear();
+
+	for(auto ins : *instructions) {
+		switch(ins->type) {
+
+		case TYPE_ASSIGNMENT:
+			variables.insert(static_cast<Assignment *>(ins)->variable);
+			expressions.insert(static_cast<Assignment *>(ins)->variable->value);
+			delete static_cast<Assignment *>(ins);
+			break;
+
+		case TYPE_RETURN:
+			expressions.insert(static_cast<ReturnOperation *>(ins)->value);
+			delete static_cast<ReturnOperation *>(ins);
+			break;
+
+		case TYPE_IF_STATEMENT:
+			expressions.insert(static_cast<IfStatement *>(ins)->expression);
+			static_cast<IfStatement *>(ins)->program->release(expressions, variables);
+
+			delete static_cast<IfStatement *>(ins)->program;
+			delete static_cast<IfStatement *>(ins);
+			break;
+
+		// The function called keeps the arguments of its last call
+		case TYPE_FUNCTIONCALL: {
+			FunctionCall * call = static_cast<FunctionCall *>(ins);
+			std::lock_guard<std::mutex> guard(call->function->lock);
+
+			for(n = 0; n < (int) call->get_arguments().size(); n++) {
+				argument = call->get_arguments()[n];
+
+				if(call->function->get_argument(n)->value == argument)
+					call->function->get_argument(n)->value = NULL;
+
+				if(n < (int) call->function->call_values.size() && call->function->call_values[n].first == argument)
+					call->function->call_values[n].first = NULL;
+
+				expressions.insert(argument);
+			}
 
-	Instruction * in = instructions->front();
-	instructions->pop();
+			delete call;
+			break;
+		}
 
-	return in;
+		case TYPE_INLINE_INJECTION:
+			expressions.insert(static_cast<InlineInjection *>(ins)->code);
+			delete static_cast<InlineInjection *>(ins);
+			break;
+		}
+	}
+
+	for(auto & variable : *this->variables)
+		variables.insert(variable.second);
+
+	instructions->clear();
+	this->variables->clear();
+}
+
+// Get all instructions of the program
+const std::vector<Instruction *> & Program::get_instructions() {
+	return *instructions;
 }
 
 // Initialize a new global program
 GlobalProgram::GlobalProgram() : Program(NULL, PROGRAM_GLOBAL) {
 	this->functions = new std::map<std::string, Function *>();
+	this->strings = new std::vector<std::string>();
+	this->string_index = new std::unordered_map<std::string, int>();
+}
+
+// Initialize a global program that goes on from a prelude
+GlobalProgram::GlobalProgram(GlobalProgram * prelude) : Program(NULL, PROGRAM_GLOBAL) {
+	delete this->variables;
+	delete this->instructions;
+
+	this->variables = new std::unordered_map<std::string, Variable *>(*prelude->variables);
+	this->instructions = new std::vector<Instruction *>(*prelude->instructions);
+	this->functions = new std::map<std::string, Function *>(*prelude->functions);
+	this->strings = new std::vector<std::string>(*prelude->strings);
+	this->string_index = new std::unordered_map<std::string, int>(*prelude->string_index);
+}
+
+GlobalProgram::~GlobalProgram() {
+	delete functions;
+	delete strings;
+	delete string_index;
 }
 
 // Get the function in global program with [name]
@@ -87,3 +234,98 @@ Function * GlobalProgram::get_function(char * name) {
 void GlobalProgram::push_function(const char * name, Function * function) {
 	functions->insert(std::pair<std::string, Function *>(std::string(name), function));
 }
+
+// Get the index of string literal [value], add it if not present
+int GlobalProgram::push_string(const char * value) {
+	auto it = string_index->insert(std::pair<std::string, int>(std::string(value), strings->size()));
+
+	if(it.second)
+		strings->push_back(it.first->first);
+
+	return it.first->second;
+}
+
+// Get the index of string literal [value]
+// return -1 if the literal is not in the table
+int GlobalProgram::get_string(const char * value) {
+	std::unordered_map<std::string, int>::iterator it;
+
+	if((it = string_index->find(std::string(value))) == string_index->end())
+		return -1;
+
+	return it->second;
+}
+
+// Free what the program added to its base, expressions and variables may be
+// shared by the functions and are deleted once
+void GlobalProgram::release_on(GlobalProgram * base) {
+	std::unordered_set<std::vector<Token *> *> expressions;
+	std::unordered_set<Variable *> variables;
+	std::unordered_set<Token *> tokens;
+	std::vector<Function *> defined;
+
+	for(auto & function : *functions)
+		if(! base || ! base->functions->count(function.first))
+			defined.push_back(function.second);
+
+	// The instructions and variables of the base stay with it
+	if(base) {
+		instructions->erase(instructions->begin(), instructions->begin() + base->instructions->size());
+
+		for(auto & variable : *base->variables) {
+			auto it = this->variables->find(variable.first);
+
+			if(it != this->variables->end() && it->second == variable.second)
+				this->variables->erase(it);
+		}
+	}
+
+	release(expressions, variables);
+
+	for(auto function : defined)
+		function->release(expressions, variables);
+
+	// Calls have taken their values back from the arguments, defaults are
+	// left, and kept by the arguments once a call replaced them
+	for(auto function : defined)
+		for(auto argument : function->get_arguments()) {
+			expressions.insert(argument->value);
+			expressions.insert(argument->default_value);
+		}
+
+	for(auto expression : expressions) {
+		if(! expression)
+			continue;
+
+		tokens.insert(expression->begin(), expression->end());
+		delete expression;
+	}
+
+	for(auto tok : tokens)
+		Token::release(tok);
+
+	for(auto variable : variables)
+		delete variable;
+
+	for(auto function : defined)
+		delete function;
+
+	functions->clear();
+}
+
+// Add the functions, variables, strings and instructions [module] has and [base] has not
+void GlobalProgram::import(GlobalProgram * module, GlobalProgram * base) {
+	for(auto & function : *module->functions)
+		if(! base->functions->count(function.first))
+			functions->insert(function);
+
+	for(auto & variable : *module->variables)
+		if(! base->variables->count(variable.first))
+			variables->insert(variable);
+
+	for(auto & value : *module->strings)
+		push_string(value.c_str());
+
+	// Instructions of the module follow the ones of its base
+	instructions->insert(instructions->end(), module->instructions->begin() + base->instructions->size(), module->instructions->end());
+}
@@ -9,23 +9,32 @@
 #define MEM_PROGRAM_H_
 
 #include <map>
-#include <queue>
+#include <vector>
+#include <unordered_set>
 
 #include "variable.h"
 #include "instruction.h"
 
 #define PROGRAM_FUNCTION 1
 #define PROGRAM_GLOBAL 2
+#define PROGRAM_BLOCK 3
 
 class Function;
+class GlobalProgram;
 
 class Program {
 
+	// Releases the functions it defines along with itself
+	friend class GlobalProgram;
+
 public:
 
 	// Initializor, pass the parent program as parameter
 	Program(Program * parent_program, const int program_type = PROGRAM_GLOBAL);
 
+	// Delete the containers, not what is in them
+	virtual ~Program();
+
 	/*
 	 * Defines the parent program, for instance the main program for a global function
 	 */
@@ -39,19 +48,44 @@ public:
 	// return 0 if it does not exist
 	virtual Variable * get_variable(std::string name);
 
+	// Get the variable that [name] refers to in the translation, where
+	// blocks have no variables of their own: an argument or a variable
+	// of the function, or a global. A name that is first assigned in a
+	// block is the variable of the block. Return 0 if it does not exist.
+	Variable * resolve_variable(const char * name);
+
 	// Add variable [name] to the current program
 	void push_variable(Variable * var);
 
-	// Get the next instruction
-	Instruction * get_next_instruction();
+	// Get all instructions
+	const std::vector<Instruction *> & get_instructions();
+
+	// Whether the program or any of its blocks contains inline code
+	int has_inline_code();
 
 	// Push a new instruction on to the instruction queue
 	void push_instruction(Instruction * instruction);
 
-private:
+	// Insert [instruction] before the instruction at [index]
+	void insert_instruction(size_t index, Instruction * instruction);
+
+	// Expressions a pass took out of the instructions, or the parser left
+	// out of a statement with an error, which other instructions may
+	// still hold, deleted along with the instructions
+	std::vector<std::vector<Token *> *> replaced;
+
+	// Delete the instructions, blocks and variables of the program once it
+	// has been translated, the program is left empty
+	void release();
+
+protected:
 
-	// Defines a set of instructions following the FIFO format
-	std::queue<Instruction *> * instructions;
+	// Defines a set of instructions in the order they were pushed
+	std::vector<Instruction *> * instructions;
+
+	// Delete the instructions and blocks, and collect the expressions and
+	// variables they refer to, which may be shared, to delete them once
+	void release(std::unordered_set<std::vector<Token *> *> & expressions, std::unordered_set<Variable *> & variables);
 
 };
 
@@ -61,6 +95,12 @@ class GlobalProgram : public Program {
 public:
 	GlobalProgram();
 
+	// Start with the functions, variables, strings and instructions of
+	// [prelude], in containers of its own so [prelude] is left as it is
+	GlobalProgram(GlobalProgram * prelude);
+
+	~GlobalProgram();
+
 	// Defines a set of functions
 	std::map<std::string, Function *> * functions;
 
@@ -72,8 +112,28 @@ public:
 	// Push a function to the function map
 	void push_function(const char * name, Function * function);
 
+	// String literals used in expressions, without duplicates
+	std::vector<std::string> * strings;
+
+	// Get the index of string literal [value] in strings
+	// the literal is added if it is not already present
+	int push_string(const char * value);
+
+	// Get the index of string literal [value], -1 if not present
+	int get_string(const char * value);
+
+	// Add what [module] defines on top of [base], the program it was
+	// parsed on, unless it is already here through another module
+	void import(GlobalProgram * module, GlobalProgram * base);
+
+	// Delete the functions, instructions and variables the program has and
+	// [base], the program it was parsed on, has not. [base] is NULL if it
+	// was parsed on nothing. Only the containers are left for the destructor.
+	void release_on(GlobalProgram * base);
 
 private:
+	// Index of each string literal in strings
+	std::unordered_map<std::string, int> * string_index;
 
 };
 #endif /* MEM_PROGRAM_H_ */
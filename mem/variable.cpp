@@ -20,7 +20,7 @@ Variable::Variable(const char * name, std::vector<Token *> * value, int type) {
 Argument::Argument(const char * name, std::vector<Token *> * value, int type)
 : Variable(name, value, type) {
 
-	this->default_value = NULL;
+	this->default_value = value;
 	this->default_type = type;
 
 }
@@ -0,0 +1,301 @@
+/*
+ * module.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "module.h"
+#include "lexer.h"
+
+Module::Module(const std::string & path) {
+
+	this->path = path;
+	this->order = 0;
+	this->level = 0;
+	this->base = NULL;
+	this->program = NULL;
+	this->parser = NULL;
+	this->diagnostics = new Diagnostics();
+	this->state = 0;
+
+}
+
+// The program refers to the names of the parser, and is freed first
+Module::~Module() {
+	if(program) {
+		program->release_on(base);
+		delete program;
+	}
+
+	delete base;
+	delete parser;
+	delete diagnostics;
+}
+
+ModuleGraph::ModuleGraph() {
+
+	this->base = NULL;
+
+}
+
+ModuleGraph::~ModuleGraph() {
+	clear();
+}
+
+// Find the modules of a source, each file is read and scanned once
+int ModuleGraph::build(const char * name, const char * source, int line_start, Diagnostics * diagnostics) {
+	std::vector<Import> imports;
+	char resolved[PATH_MAX];
+
+	clear();
+	scan(source, line_start, imports);
+
+	if(imports.empty())
+		return 1;
+
+	// A module that imports the source is a cycle as well
+	if(realpath(name, resolved))
+		source_path = resolved;
+
+	return visit(name, imports, this->imports, diagnostics);
+}
+
+// Lex the source for import followed by a file name, errors are left to the parser
+void ModuleGraph::scan(const char * source, int line_start, std::vector<Import> & imports) {
+	Lexer lexer;
+	Token * tok;
+
+	// Most sources import nothing, and are not lexed twice
+	if(! strstr(source, "import"))
+		return;
+
+	lexer.set_input_code(source);
+	lexer.n_lines = 1 - line_start;
+
+	tok = lexer.next_token();
+
+	while(tok->type != TOK_NULL) {
+		if(tok->type != TOK_IMPORT) {
+			tok = lexer.next_token();
+			continue;
+		}
+
+		// The parser reports an import without a file name
+		if((tok = lexer.next_token())->type != TOK_STRING)
+			continue;
+
+		Import import;
+
+		import.name = tok->value();
+		import.line = lexer.n_lines;
+		import.column = lexer.column;
+		import.length = lexer.length;
+
+		imports.push_back(import);
+		tok = lexer.next_token();
+	}
+}
+
+// Visit the modules depth first, a module takes its order after the modules it imports
+int ModuleGraph::visit(const char * name, std::vector<Import> & imports, std::vector<Module *> & dependencies, Diagnostics * diagnostics) {
+	std::string directory(name);
+	char resolved[PATH_MAX];
+	size_t slash;
+	int ok = 1;
+
+	// Files are imported relative to the file that imports them
+	slash = directory.rfind('/');
+	directory = slash == std::string::npos ? "." : directory.substr(0, slash ? slash : 1);
+
+	for(auto & import : imports) {
+		std::string path = import.name[0] == '/' ? import.name : directory + "/" + import.name;
+		Module * module;
+
+		if(! realpath(path.c_str(), resolved)) {
+			Diagnostic diagnostic(T_CRIT, "failed to read module %s, on line %d.", import.name.c_str(), import.line);
+
+			diagnostic.file = name;
+			diagnostics->add(diagnostic, import.line, import.column, import.length);
+			ok = 0;
+			continue;
+		}
+
+		auto it = paths.find(resolved);
+
+		if(it == paths.end() && source_path != resolved) {
+			std::ifstream file(resolved, std::ios::binary);
+			std::ostringstream content;
+
+			// A directory or a file without permission to read it
+			if(! file || ! (content << file.rdbuf()) || file.bad()) {
+				Diagnostic diagnostic(T_CRIT, "failed to read module %s, on line %d.", import.name.c_str(), import.line);
+
+				diagnostic.file = name;
+				diagnostics->add(diagnostic, import.line, import.column, import.length);
+				ok = 0;
+				continue;
+			}
+
+			module = new Module(resolved);
+			paths[module->path] = module;
+
+			module->source = content.str();
+
+			module->diagnostics->file_name = module->path;
+			module->diagnostics->source = module->source.c_str();
+			diagnostics->sources[module->path] = module->source.c_str();
+
+			scan(module->source.c_str(), 0, module->imports);
+
+			module->state = 1;
+
+			if(! visit(module->path.c_str(), module->imports, module->dependencies, diagnostics))
+				ok = 0;
+
+			module->state = 2;
+
+			for(auto dependency : module->dependencies)
+				module->level = std::max(module->level, dependency->level + 1);
+
+			modules.push_back(module);
+			module->order = modules.size();
+		}
+
+		else
+			module = it == paths.end() ? NULL : it->second;
+
+		// The module is still being visited, or it is the source
+		if(! module || module->state == 1) {
+			Diagnostic diagnostic(T_CRIT, "module %s imports the file that imports it, on line %d.", import.name.c_str(), import.line);
+
+			diagnostic.file = name;
+			diagnostics->add(diagnostic, import.line, import.column, import.length);
+			ok = 0;
+			continue;
+		}
+
+		dependencies.push_back(module);
+	}
+
+	return ok;
+}
+
+// Parse the modules level by level, the modules of a level at the same time
+GlobalProgram * ModuleGraph::parse(GlobalProgram * prelude, Diagnostics * diagnostics) {
+	std::vector<Module *> level;
+	std::vector<std::thread> threads;
+	int levels = 0;
+
+	if(imports.empty())
+		return NULL;
+
+	for(auto module : modules)
+		levels = std::max(levels, module->level + 1);
+
+	for(int n = 0; n < levels; n++) {
+		level.clear();
+
+		for(auto module : modules)
+			if(module->level == n)
+				level.push_back(module);
+
+		for(auto module : level)
+			module->base = merge(prelude, module->dependencies);
+
+		// The last module of a level is parsed on this thread
+		for(size_t i = 0; i + 1 < level.size(); i++)
+			threads.push_back(std::thread(parse_module, level[i]));
+
+		parse_module(level.back());
+
+		for(auto & thread : threads)
+			thread.join();
+
+		threads.clear();
+
+		for(auto module : level)
+			if(module->fault)
+				std::rethrow_exception(module->fault);
+
+		for(auto module : level)
+			diagnostics->append(*module->diagnostics);
+
+		// Modules above one with errors would only report them again
+		if(diagnostics->errors())
+			return NULL;
+	}
+
+	return base = merge(prelude, imports);
+}
+
+// Merge the modules that are imported, directly or not, each once in order
+GlobalProgram * ModuleGraph::merge(GlobalProgram * prelude, std::vector<Module *> & dependencies) {
+	std::vector<Module *> closure, pending(dependencies);
+	GlobalProgram * base;
+
+	while(pending.size()) {
+		Module * module = pending.back();
+
+		pending.pop_back();
+
+		if(std::find(closure.begin(), closure.end(), module) != closure.end())
+			continue;
+
+		closure.push_back(module);
+		pending.insert(pending.end(), module->dependencies.begin(), module->dependencies.end());
+	}
+
+	std::sort(closure.begin(), closure.end(), [](Module * a, Module * b) { return a->order < b->order; });
+
+	base = prelude ? new GlobalProgram(prelude) : new GlobalProgram();
+
+	for(auto module : closure)
+		base->import(module->program, module->base);
+
+	return base;
+}
+
+// Parse a module with a parser of its own, on any thread
+void ModuleGraph::parse_module(Module * module) {
+	module->parser = new Parser();
+	module->parser->set_diagnostics(module->diagnostics);
+	module->parser->set_line_start(0);
+	module->parser->set_input_code(module->source.c_str());
+	module->parser->set_module_order(module->order);
+
+	// Errors are in the diagnostics of the module, anything else may not leave the thread
+	try {
+		module->program = static_cast<GlobalProgram *>(module->parser->parse_on(module->base));
+	} catch(std::exception &) {
+		module->fault = std::current_exception();
+	}
+}
+
+// Order of the source, the modules come first
+int ModuleGraph::source_order() {
+	return modules.size() + 1;
+}
+
+// Delete the modules, the programs of the last source are not used any more.
+// A module calls the functions of the modules before it, and goes first.
+void ModuleGraph::clear() {
+	delete base;
+	base = NULL;
+
+	for(auto module = modules.rbegin(); module != modules.rend(); module++)
+		delete *module;
+
+	modules.clear();
+	imports.clear();
+	paths.clear();
+	source_path.clear();
+}
@@ -0,0 +1,129 @@
+/*
+ * module.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#ifndef MODULE_H_
+#define MODULE_H_
+
+#include <string>
+#include <vector>
+#include <exception>
+#include <unordered_map>
+
+#include "parser.h"
+#include "error.h"
+#include "mem/program.h"
+
+// Defines an import of a module, at the position of its file name
+class Import {
+
+public:
+	std::string name;
+	int line;
+	int column;
+	int length;
+
+};
+
+// Defines a file imported by the source or by another module
+class Module {
+
+public:
+	Module(const std::string & path);
+	~Module();
+
+	// Canonical path of the file and its source
+	std::string path;
+	std::string source;
+
+	// Imports of the module and the modules they name, in source order
+	std::vector<Import> imports;
+	std::vector<Module *> dependencies;
+
+	// Position in the order modules are parsed, from 1, after the modules
+	// it imports, and the length of the longest chain of imports below it.
+	// Modules of the same level do not depend on each other.
+	int order;
+	int level;
+
+	// Prelude and every module the module imports, directly or not, merged
+	// in order, which the module is parsed on
+	GlobalProgram * base;
+	GlobalProgram * program;
+
+	// Parser of the module, it owns the names of the program
+	Parser * parser;
+	Diagnostics * diagnostics;
+
+	// Fault of the compiler while the module was parsed, which the thread
+	// that waits for it throws
+	std::exception_ptr fault;
+
+	// 0 until the module is visited, 1 while its imports are, 2 after
+	int state;
+
+};
+
+/*
+ * Finds the modules a source imports, directly or not, and parses each of
+ * them once in an order where every module comes after the modules it
+ * imports. Modules that do not depend on each other are parsed at the same
+ * time, each by a parser of its own. The modules stay until the graph is
+ * cleared, the program of the source refers to their functions.
+ */
+class ModuleGraph {
+
+public:
+	ModuleGraph();
+	~ModuleGraph();
+
+	// Modules in the order they are parsed
+	std::vector<Module *> modules;
+
+	// Find the modules imported by [source] of file [name], which counts its
+	// lines from [line_start]. Errors are added to [diagnostics]. Return 0 if
+	// a module could not be read or imports itself.
+	int build(const char * name, const char * source, int line_start, Diagnostics * diagnostics);
+
+	// Parse the modules on top of [prelude], NULL if there is none, and
+	// return the program the source is parsed on, NULL without imports.
+	// Errors of the modules are appended to [diagnostics].
+	GlobalProgram * parse(GlobalProgram * prelude, Diagnostics * diagnostics);
+
+	// Order of the source, after every module
+	int source_order();
+
+	// Forget the modules of the last source
+	void clear();
+
+private:
+	// Modules by their canonical paths
+	std::unordered_map<std::string, Module *> paths;
+
+	// Modules the source imports, and the canonical path of the source
+	std::vector<Module *> imports;
+	std::string source_path;
+
+	// Program the source is parsed on, NULL until the modules are parsed
+	GlobalProgram * base;
+
+	// Find the imports of [source], it is only lexed if it names import
+	static void scan(const char * source, int line_start, std::vector<Import> & imports);
+
+	// Resolve [imports] of the file [name] to modules, and visit them
+	// before [name] takes the next order. Errors are added to [diagnostics].
+	int visit(const char * name, std::vector<Import> & imports, std::vector<Module *> & dependencies, Diagnostics * diagnostics);
+
+	// Build a program of [prelude] and the modules [dependencies] import,
+	// directly or not, in order. It shares what it has with them, deleting
+	// it only deletes its containers.
+	GlobalProgram * merge(GlobalProgram * prelude, std::vector<Module *> & dependencies);
+
+	// Parse [module] on its base
+	static void parse_module(Module * module);
+};
+
+#endif /* MODULE_H_ */
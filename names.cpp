@@ -0,0 +1,92 @@
+/*
+ * names.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include <cstring>
+#include <new>
+
+#include "names.h"
+
+char * NameTable::chunks[NAME_CHUNKS];
+std::vector<uint32_t> NameTable::free_chunks;
+uint32_t NameTable::next_chunk = 0;
+std::mutex NameTable::lock;
+
+NameTable::NameTable() {
+
+	this->kept = 0;
+	this->used = 0;
+	this->size = 0;
+
+}
+
+// The chunks go back to the directory
+NameTable::~NameTable() {
+	kept = 0;
+	release();
+}
+
+// Append to the last chunk, a text that does not fit starts the next one
+uint32_t NameTable::add(const char * value, size_t length) {
+	uint32_t offset;
+
+	if(own.empty() || used + length + 1 > size)
+		take(length + 1);
+
+	offset = (own.back() << NAME_CHUNK_BITS) | used;
+
+	memcpy(chunks[own.back()] + used, value, length);
+	chunks[own.back()][used + length] = '\0';
+	used += length + 1;
+
+	return offset;
+}
+
+// A chunk is only ever written by the table that took it
+void NameTable::take(size_t length) {
+	uint32_t index;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		if(! free_chunks.empty()) {
+			index = free_chunks.back();
+			free_chunks.pop_back();
+		}
+
+		else if(next_chunk < NAME_CHUNKS)
+			index = next_chunk++;
+
+		else
+			throw std::bad_alloc();
+	}
+
+	size = length > NAME_CHUNK_SIZE ? length : NAME_CHUNK_SIZE;
+	chunks[index] = new char[size];
+	used = 0;
+
+	own.push_back(index);
+}
+
+// The next text starts a chunk, the last one is full as far as the table is concerned
+void NameTable::keep() {
+	kept = own.size();
+	used = size;
+}
+
+// Give back the chunks taken since keep()
+void NameTable::release() {
+	std::lock_guard<std::mutex> guard(lock);
+
+	for(size_t i = kept; i < own.size(); i++) {
+		delete[] chunks[own[i]];
+		chunks[own[i]] = NULL;
+		free_chunks.push_back(own[i]);
+	}
+
+	own.resize(kept);
+	used = size;
+}
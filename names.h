@@ -0,0 +1,72 @@
+/*
+ * names.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#ifndef NAMES_H_
+#define NAMES_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Bits of an offset that are the position in its chunk, the others are
+// the index of the chunk
+#define NAME_CHUNK_BITS 16
+
+// Characters of a chunk, a longer text has a chunk of its own
+#define NAME_CHUNK_SIZE (1 << NAME_CHUNK_BITS)
+
+// Chunks of all tables at once
+#define NAME_CHUNKS (1 << (32 - NAME_CHUNK_BITS))
+
+/*
+ * Stores the text of names, numbers and strings, which tokens refer to by a
+ * 32-bit offset instead of a pointer. The texts of every table are in
+ * chunks of one directory, and each is followed by a zero. A table fills
+ * chunks of its own, so tables on different threads only wait for each
+ * other to take a chunk, and a text does not move until its table frees it.
+ */
+class NameTable {
+
+public:
+	NameTable();
+	~NameTable();
+
+	// Copy [length] characters of [value], return the offset of the copy
+	uint32_t add(const char * value, size_t length);
+
+	// Text at [offset]
+	static const char * at(uint32_t offset) {
+		return chunks[offset >> NAME_CHUNK_BITS] + (offset & (NAME_CHUNK_SIZE - 1));
+	}
+
+	// Keep the texts added so far when the others are released
+	void keep();
+
+	// Free the texts added since keep(), nothing may refer to them
+	void release();
+
+private:
+	// Chunks of every table by index, the indexes of chunks that were
+	// freed and the first that was never taken
+	static char * chunks[NAME_CHUNKS];
+	static std::vector<uint32_t> free_chunks;
+	static uint32_t next_chunk;
+	static std::mutex lock;
+
+	// Chunks of the table, the kept ones first, and the characters used
+	// and available in the last
+	std::vector<uint32_t> own;
+	size_t kept;
+	size_t used;
+	size_t size;
+
+	// Start a chunk of at least [length] characters
+	void take(size_t length);
+};
+
+#endif /* NAMES_H_ */
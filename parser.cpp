@@ -5,18 +5,20 @@
  *      Author: timmy.lindholm
  */
 
-#include <stack>
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
 
 #include "parser.h"
 #include "lexer.h"
 #include "error.h"
+#include "expression.h"
 
-// Defines an operator with correct precedence
-typedef struct {
-	char * name;
-	int precedence;
-} Operator;
+// Keep an error of the statement being parsed, formatted like printf, and
+// return [value] from the parse function it was found in
+#define PARSE_ERROR(value, format, ...) {fail(Diagnostic(T_CRIT, format, __VA_ARGS__)); return value;}
 
 Parser::Parser() {
 
@@ -24,111 +26,251 @@ Parser::Parser() {
 	this->buffer = NULL;
 	this->global_program = NULL;
 	this->program = NULL;
+	this->trace = NULL;
+	this->stats = NULL;
+	this->diagnostics = NULL;
+	this->prelude = NULL;
+	this->module_order = 0;
+	this->stream = NULL;
+	this->jobs = 1;
+	this->owner = this;
+	this->lexer_errors = 0;
+	this->error = NULL;
+}
+
+Parser::~Parser() {
+	for(auto parser : body_parsers)
+		delete parser;
+
+	for(auto diagnostics : range_diagnostics)
+		delete diagnostics;
+
+	if(owner != this)
+		delete stats;
+
+	delete error;
+	delete lexer;
 }
 
 /*
  * Parses the code which resides in buffer
  * May be called recursively, thus the non-static program
- * pointer
+ * pointer. Return 0 if parsing stopped at an error.
 */
-void Parser::parse(Program * program) {
+int Parser::parse(Program * program) {
 	Token * tok;
-	FunctionCall * funccall;
 
 	this->program = program;
 	tok = lexer->next_token();
 
 	while(tok->type != TOK_NULL && tok->type != TOK_RIGHT_CBRACK) {
-		// Entry points for keywords and instructions
-		switch(tok->type) {
 
-		// Function or variable name
-		case TOK_NAME:
-			const char * name;
+		// Record the error and go on with the next statement of this block
+		if(! parse_statement(tok)) {
+			Diagnostic diagnostic = statement_error(*error);
 
-			name = tok->value;
-			tok = lexer->next_token();
+			if(! report(diagnostic))
+				return 0;
 
-			// Function call
-			if(tok->type == TOK_LEFT_PAR) {
-				parse_function_call(name, &funccall);
-			}
+			this->program = program;
+			tok = synchronize();
+			continue;
+		}
 
-			// Function definition
-			else if(tok->type == TOK_COLON) {
-				if(program != global_program)
-					ERROR(T_CRIT, "function definitions may only occur in the global scope, on line %d.", lexer->n_lines);
+		// The statement went past a token the lexer failed on
+		if(lexer->errors != lexer_errors) {
+			Diagnostic diagnostic(*lexer->error);
 
-				parse_function_definition(name);
-			}
+			lexer_errors = lexer->errors;
 
-			// Assignment operation
-			else if(IS_ASSIGNMENT(tok->type)) {
-				parse_assignment_operation(name, tok->type);
-			}
+			if(! report(diagnostic))
+				return 0;
+		}
 
-			// Unknown
-			else {
-				ERROR(T_CRIT, "unknown token %s on line %d.", name, lexer->n_lines);
-			}
+		tok = lexer->next_token();
+	}
+
+	return 1;
+}
 
-			break;
+// Parse the statement starting at [tok], return 0 if it has an error
+int Parser::parse_statement(Token * tok) {
+	FunctionCall * funccall;
+
+	// Entry points for keywords and instructions
+	switch(tok->type) {
+
+	// Text the lexer could not make a token of
+	case TOK_ERROR:
+		fail(*lexer->error);
+		return 0;
 
-		// If or else if
-		case TOK_IF:
-			parse_if_statement();
-			break;
+	// Function or variable name
+	case TOK_NAME: {
+		const char * name, * begin;
 
-		case TOK_ELSE_IF:
-			break;
+		name = tok->value();
+		begin = lexer->token_begin;
+		tok = lexer->next_token();
+
+		// Function call
+		if(tok->type == TOK_LEFT_PAR)
+			return parse_function_call(name, &funccall) != NULL;
 
-		// While loop
-		case TOK_WHILE:
-			break;
+		// Function definition
+		else if(tok->type == TOK_COLON) {
+			if(program != global_program)
+				PARSE_ERROR(0, "function definitions may only occur in the global scope, on line %d.", lexer->n_lines);
 
-		// For all
-		case TOK_UNI_QUANT:
-			break;
+			auto range = range_headers.find(begin);
 
-		// Return statement
-		case TOK_RETURN:
-			if(program->program_type != PROGRAM_FUNCTION) {
-				if(program->parent_program->program_type != PROGRAM_FUNCTION)
-					ERROR(T_CRIT, "return statements may only be used inside functions, on line %d.", lexer->n_lines);
+			// Registered before the main pass, the body is parsed after it
+			if(range != range_headers.end()) {
+				lexer->set_position(ranges[range->second].end, ranges[range->second].end_line);
+				return 1;
 			}
 
-			parse_return_operation();
-			break;
+			Function * function = parse_function_definition(name);
+
+			// The translator takes the function while the rest is parsed
+			if(stream && function)
+				stream->push(function, stream_variables);
 
-		case TOK_AT:
-			parse_inline_code_operation();
+			return function != NULL;
+		}
+
+		// Assignment operation
+		else if(IS_ASSIGNMENT(tok->type))
+			return parse_assignment_operation(name, tok->type);
+
+		// Unknown
+		PARSE_ERROR(0, "unknown token %s on line %d.", name, lexer->n_lines);
+	}
+
+	// If or else if
+	case TOK_IF:
+		return parse_if_statement();
+
+	case TOK_ELSE_IF:
+		return 1;
 
-			break;
+	// While loop
+	case TOK_WHILE:
+		return 1;
 
-		default:
-			break;
+	// For all
+	case TOK_UNI_QUANT:
+		return 1;
+
+	// Return statement
+	case TOK_RETURN:
+		if(program->program_type != PROGRAM_FUNCTION) {
+			if(program->parent_program->program_type != PROGRAM_FUNCTION)
+				PARSE_ERROR(0, "return statements may only be used inside functions, on line %d.", lexer->n_lines);
 		}
 
-		tok = lexer->next_token();
+		return parse_return_operation();
+
+	case TOK_AT:
+		return parse_inline_code_operation();
+
+	// Import of a module
+	case TOK_IMPORT:
+		if(program != global_program)
+			PARSE_ERROR(0, "imports may only occur in the global scope, on line %d.", lexer->n_lines);
+
+		return parse_import();
+
+	default:
+		return 1;
 	}
 }
 
+// Only the first error of a statement is kept, the others may follow from it
+void Parser::fail(const Diagnostic & diagnostic) {
+	if(! error)
+		error = new Diagnostic(diagnostic);
+}
+
+// Record [diagnostic] and forget the error of the statement. If parsing
+// stops, because there are no diagnostics or too many errors, [diagnostic]
+// is kept as the error instead and 0 returned.
+int Parser::report(Diagnostic & diagnostic) {
+	delete error;
+	error = NULL;
+
+	if(diagnostics && diagnostics->add(diagnostic, lexer->n_lines, lexer->column, lexer->length))
+		return 1;
+
+	error = new Diagnostic(diagnostic);
+	return 0;
+}
+
+// The lexer counts its errors, a statement that made one reports it instead
+Diagnostic Parser::statement_error(Diagnostic & diagnostic) {
+	if(lexer->errors == lexer_errors)
+		return diagnostic;
+
+	lexer_errors = lexer->errors;
+	return *lexer->error;
+}
+
+/*
+ * Skip from the last token to the end of the statement it is in, which is
+ * the next '.', or the '}' closing a block opened on the way. Return the
+ * token after it, or a '}' ending the current block, or the end of file.
+ * Errors of the lexer on the way are recorded as well.
+ */
+Token * Parser::synchronize() {
+	Token * tok;
+	int depth;
+
+	tok = lexer->last_token;
+	depth = 0;
+
+	while(tok->type != TOK_NULL) {
+		if(tok->type == TOK_LEFT_CBRACK)
+			depth++;
+
+		else if(tok->type == TOK_RIGHT_CBRACK) {
+			if(! depth)
+				return tok;
+
+			if(! --depth)
+				return lexer->next_token();
+		}
+
+		else if(tok->type == TOK_DOT && ! depth)
+			return lexer->next_token();
+
+		// Errors of the lexer in the statement skipped are recorded as well
+		if((tok = lexer->next_token())->type == TOK_ERROR) {
+			Diagnostic diagnostic(*lexer->error);
+
+			lexer_errors = lexer->errors;
+			diagnostics->add(diagnostic, lexer->n_lines, lexer->column, lexer->length);
+		}
+	}
+
+	return tok;
+}
+
 // Parse an inline code operation
-void Parser::parse_inline_code_operation() {
+int Parser::parse_inline_code_operation() {
 	Token * tok;
 	int left_curly;
 	std::vector<Token *> * code;
 
 	left_curly = 0;
-	code = new std::vector<Token *>();
 
 	tok = lexer->next_token();
 
 	// Make sure token is of left curly
 	if(tok->type != TOK_LEFT_CBRACK)
-		ERROR(T_CRIT, "unexpected token %s on line %d, expected {", tok->value, lexer->n_lines);
+		PARSE_ERROR(0, "unexpected token %s on line %d, expected {", tok->value(), lexer->n_lines);
 
 	// Fetch all tokens until right curly is reached
+	code = new std::vector<Token *>();
 	tok = lexer->next_token();
 
 	while(tok->type != TOK_NULL) {
@@ -149,429 +291,313 @@ void Parser::parse_inline_code_operation() {
 	}
 
 	// No ending curly
-	if(tok->type == TOK_NULL)
-		ERROR(T_CRIT, "unexpected end of file on line %d", lexer->n_lines);
+	if(tok->type == TOK_NULL) {
+		delete code;
+		PARSE_ERROR(0, "unexpected end of file on line %d", lexer->n_lines);
+	}
 
 	// Add inline injection instruction
 	InlineInjection * instruction = new InlineInjection(code);
 
 	program->push_instruction(instruction);
+	return 1;
 }
 
 // Parse an assignment operation and create the corresponding memory layout
-void Parser::parse_assignment_operation(const char * name, int assign_type) {
+int Parser::parse_assignment_operation(const char * name, int assign_type) {
 	std::vector<Token *> * expression;
 	int type;
 
 	// Get the expression
-	expression = parse_expression(type);
-
-	for(auto x : *expression) {
-		std::cerr << x->value << ": " << x->type << " ";
-	}
-
-	std::cerr << std::endl;
+	if(! (expression = parse_expression(type)))
+		return 0;
 
 	// Create the variable and add it to the current program
 	Variable * variable = new Variable(name, expression, type);
 	program->push_variable(variable);
 
+	// Globals are declared before the first function streamed after them
+	if(stream && program == global_program && program->variables->find(name)->second == variable)
+		stream_variables.push_back(variable);
+
 	// Create assignment instruction
 	Assignment * assignment = new Assignment(variable, assign_type);
 	program->push_instruction(assignment);
+	return 1;
 }
 
-// Convert infix expression to postfix expression for convenience
-// and determine the type of the expression, return in standard form
+// Parse an arithmetic expression and determine its type, return its
+// tokens in standard form
 std::vector<Token *> * Parser::parse_expression(int &type, int tok_delim) {
-	Token * tok;
-	int left_pars;
-	std::stack<Token *> op_stack;
-	std::vector<Token *> * expression, * exp;
-	std::unordered_map<int, int> operators;
+	return parse_operation(type, tok_delim, 0);
+}
 
-	operators[TOK_MULT] = 3;
-	operators[TOK_DIV] = 3;
-	operators[TOK_PLUS] = 2;
-	operators[TOK_MINUS] = 2;
-	operators[TOK_LEFT_PAR] = 1;
+// Parse a logical expression and return the associated tokens in standard
+// notation
+std::vector<Token *> * Parser::parse_logical_expression(int tok_delim) {
+	int type;
 
-	expression = new std::vector<Token *>;
-	exp = new std::vector<Token *>;
+	return parse_operation(type, tok_delim, 1);
+}
+
+/*
+ * Parse an expression by precedence climbing, with the precedences of
+ * expr::precedences. Arithmetic expressions take the arithmetic operators,
+ * conditions every operator. The tokens are kept in infix order, the
+ * backends order them themselves.
+ */
+std::vector<Token *> * Parser::parse_operation(int & type, int tok_delim, int logical) {
+	ExpressionState state;
+	Token * tok;
+	int operation_type;
 
-	left_pars = 0;
-	type = TOK_NULL;
+	state.tokens = new std::vector<Token *>;
+	state.logical = logical;
+	state.type = TOK_NULL;
+	state.comparison = 0;
 
-	// Loop through tokens until dot or end of line
 	tok = lexer->next_token();
 
-	while(tok->type != TOK_NULL && tok->type != tok_delim) {
-		if(tok->type == TOK_RIGHT_PAR && ! left_pars)
-			break;
+	// Empty, for instance a return without a value
+	if(tok->type == tok_delim || (! logical && tok->type == TOK_RIGHT_PAR)) {
+		type = TOK_NULL;
+		return share_expression(state.tokens);
+	}
 
-		exp->push_back(tok);
+	// The tokens are only shared once the expression is complete
+	if(! (tok = parse_binary(state, tok, 1, operation_type))) {
+		delete state.tokens;
+		return NULL;
+	}
 
-		// Numeric operand
-		if(tok->type == TOK_INT || tok->type == TOK_FLOAT) {
-			if(tok->type == TOK_FLOAT)
-				type = TOK_FLOAT;
-			else if(tok->type == TOK_INT && type != TOK_FLOAT && type != TOK_STRING)
-				type = TOK_INT;
+	// Arguments of a call end at the ) of the call
+	if(tok->type != tok_delim && (logical || tok->type != TOK_RIGHT_PAR)) {
+		delete state.tokens;
 
-			expression->push_back(tok);
-		}
+		if(tok->type == TOK_NULL)
+			PARSE_ERROR(NULL, "unexpected end of file on line %d", lexer->n_lines);
 
-		// String operand
-		else if(tok->type == TOK_STRING) {
-			type = TOK_STRING;
-			expression->push_back(tok);
-		}
+		PARSE_ERROR(NULL, "unexpected '%s' on line %d", tok->value(), lexer->n_lines);
+	}
 
-		// Function or variable operand
-		else if(tok->type == TOK_NAME) {
-			Token * name = tok;
-			FunctionCall * instruction = nullptr;
-			int first = 1;
-			tok = lexer->next_token();
+	type = state.type;
+	return share_expression(state.tokens);
+}
 
-			// Function
-			if(tok->type == TOK_LEFT_PAR) {
-				auto func = parse_function_call(name->value, &instruction);
+// Keep one node of each expression, repeated ones cost a lookup
+std::vector<Token *> * Parser::share_expression(std::vector<Token *> * expression) {
+	if(stream)
+		return expression;
 
-				// Check if function has a certain return type
-				if(type != TOK_NULL) {
-					if((! func->check_return_type(type)) && type != TOK_STRING)
-						ERROR(T_CRIT, "invalid return value of function %s on line %d.", name->value, lexer->n_lines);
-				}
+	auto shared = expressions.insert(expression);
 
-				else
-					type = func->get_return_type();
+	if(! shared.second)
+		delete expression;
 
-				expression->push_back(new Token((char * const) "@", TOK_LEFT_PAR));
-				exp->push_back(new Token((char * const) "(", TOK_LEFT_PAR));
+	return *shared.first;
+}
 
-				std::vector<Token *> * arg;
-				while((arg = instruction->get_next_argument())) {
+// Parse the operands and the operators of a precedence, the right operand
+// of an operator is parsed with the operators that bind tighter
+Token * Parser::parse_binary(ExpressionState & state, Token * tok, int precedence, int & type) {
+	int level, right;
 
-					if(first)
-						first = 0;
-					else {
-						exp->push_back(new Token((char * const) ",", TOK_LEFT_PAR));
-					}
+	if(! (tok = parse_operand(state, tok, type)))
+		return NULL;
 
-					for(auto tok_ : *arg) {
-						exp->push_back(tok_);
-					}
-				}
+	// Comparisons and logical operators end an arithmetic expression
+	while((level = expr::precedence(tok->type)) >= precedence && (state.logical || level >= PREC_ADDITIVE)) {
+		int op = tok->type;
 
-				exp->push_back(new Token((char * const) ")", TOK_RIGHT_PAR));
-				tok = lexer->next_token();
-			}
+		state.tokens->push_back(tok);
 
-			// Variable
-			else {
-				auto var = program->get_variable(name->value);
+		if(level == PREC_COMPARISON)
+			state.comparison = 1;
 
-				// Determine if variable exists
-				if(! var)
-					ERROR(T_CRIT, "undefined variable %s on line %d.", name->value, lexer->n_lines);
+		if(! (tok = parse_binary(state, lexer->next_token(), level + 1, right)))
+			return NULL;
 
-				// Determine variable type
-				if(type != TOK_NULL) {
-					if(var->type != type && type != TOK_STRING)
-						ERROR(T_CRIT, "invalid type of variable %s on line %d.", name->value, lexer->n_lines);
-				}
+		// The remainder is only defined for integers
+		if(op == TOK_MOD && (type == TOK_FLOAT || right == TOK_FLOAT || type == TOK_STRING || right == TOK_STRING))
+			PARSE_ERROR(NULL, "invalid operands of %% on line %d.", lexer->n_lines);
 
-				else
-					type = var->type;
-			}
-
-			expression->push_back(name);
+		if(level < PREC_ADDITIVE)
+			type = TOK_INT;
+		else if(type == TOK_STRING || right == TOK_STRING)
+			type = TOK_STRING;
+		else if(type == TOK_FLOAT || right == TOK_FLOAT)
+			type = TOK_FLOAT;
+		else if(type != TOK_INT || right != TOK_INT)
+			type = TOK_NULL;
+	}
 
-			continue;
-		}
+	return tok;
+}
 
-		else if(tok->type == TOK_LEFT_PAR) {
-			left_pars++;
-			op_stack.push(tok);
-		}
+// Parse an operand and check its type against the operands before it
+Token * Parser::parse_operand(ExpressionState & state, Token * tok, int & type) {
+	switch(tok->type) {
 
-		else if(tok->type == TOK_RIGHT_PAR) {
-			Token * op;
-			op = NULL;
+	// Parenthesized expression
+	case TOK_LEFT_PAR:
+		state.tokens->push_back(tok);
 
-			// Pop stack until corresponding left paranthesis is found
-			while((! op_stack.empty()) && (op = op_stack.top())->type != TOK_LEFT_PAR) {
-				expression->push_back(op);
-				op_stack.pop();
-			}
+		if(! (tok = parse_binary(state, lexer->next_token(), 1, type)))
+			return NULL;
 
-			// Matching paranthesis
-			if(op != NULL && op->type == TOK_LEFT_PAR) {
-				op_stack.pop();
-			}
+		if(tok->type == TOK_NULL)
+			PARSE_ERROR(NULL, "unexpected end of file on line %d", lexer->n_lines);
 
-			else {
-				ERROR(T_CRIT, "faulty expression on line %d", lexer->n_lines);
-			}
+		// No matching paranthesis
+		if(tok->type != TOK_RIGHT_PAR)
+			PARSE_ERROR(NULL, "faulty expression on line %d", lexer->n_lines);
 
-			left_pars--;
-		}
+		state.tokens->push_back(tok);
+		return lexer->next_token();
 
-		// Operator
-		else if(IS_OPERATOR(tok->type)) {
-			Token * op;
-			int prec;
+	// Sign
+	case TOK_PLUS:
+	case TOK_MINUS:
+		state.tokens->push_back(tok);
+		return parse_operand(state, lexer->next_token(), type);
 
-			op = NULL;
-			prec = operators[tok->type];
+	// Numeric or string operand
+	case TOK_INT:
+	case TOK_FLOAT:
+	case TOK_STRING:
+		type = tok->type;
 
-			// Add operators with higher precedence
-			while(! op_stack.empty() && prec <= operators[(op = op_stack.top())->type]) {
-				expression->push_back(op);
-				op_stack.pop();
-			}
+		// Whether the comparsion flag is set, make sure types are comparable
+		if(state.logical) {
+			if(state.comparison && state.type != tok->type)
+				PARSE_ERROR(NULL, "comparison of different types, on line %d", lexer->n_lines);
 
-			op_stack.push(tok);
+			state.comparison = 0;
+			state.type = tok->type;
 		}
 
-		// Invalid token
-		else
-			ERROR(T_CRIT, "unexpected '%s' on line %d", tok->value, lexer->n_lines);
-
-		tok = lexer->next_token();
-	}
-
-	// Check if no ending delimiter
-	if(tok->type == TOK_NULL)
-		ERROR(T_CRIT, "unexpected end of file on line %d", lexer->n_lines);
+		else if(tok->type != TOK_INT || (state.type != TOK_FLOAT && state.type != TOK_STRING))
+			state.type = tok->type;
 
-	// Add remaining operators to expression
-	while(! op_stack.empty()) {
-		expression->push_back(op_stack.top());
-		op_stack.pop();
-	}
+		if(tok->type == TOK_STRING)
+			push_literal(tok->value());
 
-	delete expression;
-	return exp;
-}
+		state.tokens->push_back(tok);
+		return lexer->next_token();
 
-// Parse a logical expression and return the associated tokens in standard
-// notation
-std::vector<Token *> * Parser::parse_logical_expression(int tok_delim) {
-	Token * tok;
-	int last_type, comparison;
-	std::vector<Token *> * exp;
-	std::vector<Token *> * expression;
-	std::stack<Token *> op_stack;
-	std::unordered_map<int, int> operators;
+	// Function or variable operand
+	case TOK_NAME: {
+		Token * name = tok;
+		int last_type = state.type;
 
-	operators[TOK_GREATER] = 4;
-	operators[TOK_LESSER] = 4;
-	operators[TOK_GREATER_EQUAL] = 4;
-	operators[TOK_LESSER_EQUAL] = 4;
-	operators[TOK_AND] = 3;
-	operators[TOK_OR] = 2;
-	operators[TOK_LEFT_PAR] = 1;
-
-	expression = new std::vector<Token *>;
-	exp = new std::vector<Token *>;
+		state.tokens->push_back(name);
+		tok = lexer->next_token();
 
+		// Function
+		if(tok->type == TOK_LEFT_PAR) {
+			FunctionCall * instruction = nullptr;
+			int first = 1;
 
-	last_type = TOK_NULL;
-	comparison = 0;
+			auto func = parse_function_call(name->value(), &instruction);
 
-	tok = lexer->next_token();
+			if(! func)
+				return NULL;
 
-	// Loop through expression token by token
-	while(tok->type != TOK_NULL && tok->type != tok_delim) {
-		exp->push_back(tok);
+			type = known_return_type(func);
 
-		// Whether the comparsion flag is set, make sure types are comparable
-		if(comparison) {
-			if(tok->type != TOK_NAME && last_type != tok->type) {
-				ERROR(T_CRIT, "comparison of different types, on line %d", lexer->n_lines);
+			// Check if function has a certain return type
+			if(! state.logical && last_type != TOK_NULL) {
+				if(type == last_type && last_type != TOK_STRING)
+					PARSE_ERROR(NULL, "invalid return value of function %s on line %d.", name->value(), lexer->n_lines);
 			}
 
-			else if(tok->type != TOK_NAME)
-				comparison = 0;
-		}
-
-		// Numeric operand
-		if(tok->type == TOK_INT || tok->type == TOK_FLOAT) {
-			if(tok->type == TOK_FLOAT)
-				last_type = TOK_FLOAT;
 			else
-				last_type = TOK_INT;
-
-			expression->push_back(tok);
-		}
-
-		// String operand
-		else if(tok->type == TOK_STRING) {
-			last_type = TOK_STRING;
-			expression->push_back(tok);
-		}
+				state.type = type;
 
-		// Function or variable operand
-		else if(tok->type == TOK_NAME) {
-			Token * name = tok;
-			FunctionCall * funccall;
-			int last_type_cp;
+			state.tokens->push_back(lexer->make_token("(", TOK_LEFT_PAR));
 
-			last_type_cp = last_type;
-			tok = lexer->next_token();
-
-			// Function
-			if(tok->type == TOK_LEFT_PAR) {
-				auto func = parse_function_call(name->value, &funccall);
-				last_type = func->get_return_type();
-
-				expression->push_back(new Token((char * const) "@", TOK_AT));
-				exp->push_back(new Token((char * const) "@", TOK_AT));
-
-				tok = lexer->next_token();
-			}
-
-			// Variable
-			else {
-				auto var = program->get_variable(name->value);
-
-				// Determine if variable exists
-				if(! var)
-					ERROR(T_CRIT, "undefined variable %s on line %d.", name->value, lexer->n_lines);
-
-				// Determine variable type
-				last_type = var->type;
-				std::cerr << var->type << std::endl;
-			}
-
-			// Whether the comparsion flag is set, make sure types are comparable
-			if(comparison) {
-				if(last_type != last_type_cp)
-					ERROR(T_CRIT, "comparison of different types, on line %d", lexer->n_lines);
+			for(auto arg : instruction->get_arguments()) {
+				if(first)
+					first = 0;
+				else
+					state.tokens->push_back(lexer->make_token(",", TOK_COMMA));
 
-				comparison = 0;
+				state.tokens->insert(state.tokens->end(), arg->begin(), arg->end());
 			}
 
-			expression->push_back(name);
-			continue;
+			state.tokens->push_back(lexer->make_token(")", TOK_RIGHT_PAR));
+			tok = lexer->next_token();
 		}
 
-		else if(tok->type == TOK_LEFT_PAR) {
-			op_stack.push(tok);
-		}
+		// Variable
+		else {
+			auto var = program->get_variable(name->value());
 
-		else if(tok->type == TOK_RIGHT_PAR) {
-			Token * op;
-			op = NULL;
+			// Determine if variable exists
+			if(! var)
+				PARSE_ERROR(NULL, "undefined variable %s on line %d.", name->value(), lexer->n_lines);
 
-			// Pop stack until corresponding left paranthesis is found
-			while((! op_stack.empty()) && (op = op_stack.top())->type != TOK_LEFT_PAR) {
-				expression->push_back(op);
-				op_stack.pop();
-			}
+			type = var->type;
 
-			// Matching paranthesis
-			if(op != NULL && op->type == TOK_LEFT_PAR) {
-				op_stack.pop();
+			// Determine variable type
+			if(! state.logical && last_type != TOK_NULL) {
+				if(type != last_type && last_type != TOK_STRING)
+					PARSE_ERROR(NULL, "invalid type of variable %s on line %d.", name->value(), lexer->n_lines);
 			}
 
 			else
-				ERROR(T_CRIT, "faulty expression on line %d", lexer->n_lines);
-
-		}
-
-		// Comparison operator
-		else if(IS_COMPARISON(tok->type)) {
-			Token * op;
-			int prec;
-
-			comparison = 1;
-			op = NULL;
-			prec = operators[tok->type];
-
-			// Add operators with higher precedence
-			while(! op_stack.empty() && prec <= operators[(op = op_stack.top())->type]) {
-				expression->push_back(op);
-				op_stack.pop();
-			}
-
-			op_stack.push(tok);
+				state.type = type;
 		}
 
-		// Logical and or or
-		else if(tok->type == TOK_AND || tok->type == TOK_OR) {
-			Token * op;
-			int prec;
-
-			op = NULL;
-			prec = operators[tok->type];
-
-			// Add operators with higher precedence
-			while(! op_stack.empty() && prec <= operators[(op = op_stack.top())->type]) {
-				expression->push_back(op);
-				op_stack.pop();
-			}
+		// Whether the comparsion flag is set, make sure types are comparable
+		if(state.logical && state.comparison) {
+			if(state.type != last_type)
+				PARSE_ERROR(NULL, "comparison of different types, on line %d", lexer->n_lines);
 
-			op_stack.push(tok);
+			state.comparison = 0;
 		}
 
-		// Invalid token
-		else
-			ERROR(T_CRIT, "unexpected '%s' on line %d", tok->value, lexer->n_lines);
-
-		tok = lexer->next_token();
+		return tok;
 	}
 
-	// Check if no ending delimiter
-	if(tok->type == TOK_NULL)
-		ERROR(T_CRIT, "unexpected end of file on line %d", lexer->n_lines);
+	case TOK_NULL:
+		PARSE_ERROR(NULL, "unexpected end of file on line %d", lexer->n_lines);
 
-	// Add remaining operators to expression
-	while(! op_stack.empty()) {
-		expression->push_back(op_stack.top());
-		op_stack.pop();
+	default:
+		PARSE_ERROR(NULL, "unexpected '%s' on line %d", tok->value(), lexer->n_lines);
 	}
-
-	delete expression;
-	return exp;
 }
 
-/* Parse a call to a function, output an error if function for some reason
- * does not exist or have matches with arguments
+/* Parse a call to a function, return NULL with an error if function for
+ * some reason does not exist or have matches with arguments
  */
 Function * Parser::parse_function_call(const char * func_name, FunctionCall ** function_call) {
 	Function * func = nullptr;
+	long long key;
+
+	// Calls are ordered by module and then by position, whichever thread parses them
+	key = ((long long) module_order << 32) | (lexer->token_begin - buffer);
 
 	// Try to fetch function
 	func = global_program->get_function(func_name);
 
 	// Means function could not be found in program map
 	if(! func)
-		ERROR(T_CRIT, "unknown call to function %s, on line %d.", func_name, lexer->n_lines);
-
-	*function_call = new FunctionCall(func);
+		PARSE_ERROR(NULL, "unknown call to function %s, on line %d.", func_name, lexer->n_lines);
 
 	int args_size = func->get_arguments_size();
 	int n = 0;
+	std::vector<std::pair<std::vector<Token *> *, int>> values;
 
 	if(args_size)
 	while(lexer->last_token->type != TOK_RIGHT_PAR && lexer->last_token->type != TOK_NULL) {
-		Argument * arg = func->get_next_argument();
-
 		int type;
+		std::vector<Token *> * value = parse_expression(type, TOK_COMMA);
 
-		arg->value = parse_expression(type, TOK_COMMA);
-		arg->type = type;
-
-		if(arg->type == TOK_STRING) {
-			arg->value->insert(arg->value->begin(), new Token((char * const) "\"", TOK_QUOTE));
-			arg->value->push_back(new Token((char * const) "\"", TOK_QUOTE));
-		}
-
-		(*function_call)->push_argument(arg->value);
+		if(! value)
+			return drop_arguments(values);
 
+		values.push_back(std::make_pair(value, type));
 		n++;
 	}
 
@@ -579,15 +605,37 @@ Function * Parser::parse_function_call(const char * func_name, FunctionCall ** f
 		lexer->next_token();
 
 	// No closing right paranthesis
-	if(lexer->last_token->type != TOK_RIGHT_PAR)
-		ERROR(T_CRIT, "unexpected end of function %s on line %d.", func_name, lexer->n_lines);
+	if(lexer->last_token->type != TOK_RIGHT_PAR) {
+		fail(Diagnostic(T_CRIT, "unexpected end of function %s on line %d.", func_name, lexer->n_lines));
+		return drop_arguments(values);
+	}
 
 	// Too many or too few arguments
-	if(n != args_size)
-		ERROR(T_CRIT, "invalid number of arguments in call to function %s, on line %d.", func_name, lexer->n_lines);
+	if(n != args_size) {
+		fail(Diagnostic(T_CRIT, "invalid number of arguments in call to function %s, on line %d.", func_name, lexer->n_lines));
+		return drop_arguments(values);
+	}
+
+	*function_call = new FunctionCall(func);
+
+	for(auto & value : values)
+		(*function_call)->push_argument(value.first);
 
-	// Update return statement in case that it depend on the arguments
-	if(! func->get_return_type())
+	// Parsed before the lock is taken, the body may call the function
+	int parsed = body_parsed(func);
+
+	// The function may be defined in a module that other modules call at the same time
+	std::lock_guard<std::mutex> guard(func->lock);
+
+	// Arguments take the types of the call that comes last, once the source is parsed
+	if(key >= func->caller) {
+		func->call_values = values;
+		func->caller = key;
+	}
+
+	// Update return statement in case that it depend on the arguments,
+	// a body that is not parsed yet may still set it
+	if(! func->get_return_type() && parsed)
 		func->set_return_type(TOK_AUTO);
 
 	// Push function call to program instruction queue
@@ -596,26 +644,44 @@ Function * Parser::parse_function_call(const char * func_name, FunctionCall ** f
 	return func;
 }
 
+// The arguments of a call with an error may be shared with other
+// instructions, they are freed with the program. Return NULL.
+Function * Parser::drop_arguments(std::vector<std::pair<std::vector<Token *> *, int>> & values) {
+	for(auto & value : values)
+		program->replaced.push_back(value.first);
+
+	return NULL;
+}
+
 // Parse a function definition with name [name]
 // error will occur if function does already exist
 // return pointer to function
 Function * Parser::parse_function_definition(const char * func_name) {
 	Function * function;
+	int parsed;
 
-	if(global_program->get_function(func_name))
-		ERROR(T_CRIT, "redefinition of function %s on line %d.", func_name, lexer->n_lines);
+	if(! (function = parse_function_header(func_name)))
+		return NULL;
 
-	function = new Function(program);
-	function->name = func_name;
+	// A streamed body has blocks of tokens of its own, which the translator
+	// frees with it
+	if(stream)
+		lexer->begin_tokens();
 
-	lexer->next_token();
+	parsed = parse_function_body(function);
 
-	if(lexer->last_token->type != TOK_LEFT_PAR)
-		ERROR(T_CRIT, "unexpected %s on line %d.", lexer->last_token->value, lexer->n_lines);
+	if(stream)
+		function->tokens = lexer->take_tokens();
 
-	// Parse arguments
-	lexer->next_token();
+	// Push function to program, a body with an error is freed with it
+	global_program->push_function(func_name, function);
 
+	return parsed ? function : NULL;
+}
+
+// Parse the arguments of a function definition, from its ( to its {
+Function * Parser::parse_function_header(const char * func_name) {
+	Function * function;
 	const char * var_name;
 	int default_value_type;
 	std::vector<Token *> * default_value;
@@ -624,6 +690,22 @@ Function * Parser::parse_function_definition(const char * func_name) {
 	default_value = NULL;
 	default_value_type = TOK_NULL;
 
+	if(global_program->get_function(func_name))
+		PARSE_ERROR(NULL, "redefinition of function %s on line %d.", func_name, lexer->n_lines);
+
+	function = new Function(program);
+	function->name = func_name;
+
+	lexer->next_token();
+
+	if(lexer->last_token->type != TOK_LEFT_PAR) {
+		drop_function(function, default_value);
+		PARSE_ERROR(NULL, "unexpected %s on line %d.", lexer->last_token->value(), lexer->n_lines);
+	}
+
+	// Parse arguments
+	lexer->next_token();
+
 	while(lexer->last_token->type != TOK_RIGHT_PAR && lexer->last_token->type != TOK_NULL) {
 		// Add variable to function
 		if(lexer->last_token->type == TOK_COMMA) {
@@ -649,81 +731,146 @@ Function * Parser::parse_function_definition(const char * func_name) {
 
 		// Argument
 		else if(lexer->last_token->type == TOK_NAME && var_name == NULL) {
-			var_name = lexer->last_token->value;
+			var_name = lexer->last_token->value();
 		}
 
-		else
-			ERROR(T_CRIT, "unexpected %s on line %d.", lexer->last_token->value, lexer->n_lines);
+		else {
+			drop_function(function, default_value);
+			PARSE_ERROR(NULL, "unexpected %s on line %d.", lexer->last_token->value(), lexer->n_lines);
+		}
 
 		lexer->next_token();
 	}
 
-	if(lexer->last_token->type == TOK_NULL)
-		ERROR(T_CRIT, "no ending delimiter for argument list of function %s on line %d.", func_name, lexer->n_lines);
+	if(lexer->last_token->type == TOK_NULL) {
+		drop_function(function, default_value);
+		PARSE_ERROR(NULL, "no ending delimiter for argument list of function %s on line %d.", func_name, lexer->n_lines);
+	}
 
 	// Push last argument to function
 	if(var_name != NULL) {
 		Argument * argument = new Argument(var_name, default_value, default_value_type);
 		function->push_argument(argument);
+		default_value = NULL;
 	}
 
 	lexer->next_token();
-	if(lexer->last_token->type != TOK_IMPLIES)
-		ERROR(T_CRIT, "unexpected %s on line %d.", lexer->last_token->value, lexer->n_lines);
+	if(lexer->last_token->type != TOK_IMPLIES) {
+		drop_function(function, default_value);
+		PARSE_ERROR(NULL, "unexpected %s on line %d.", lexer->last_token->value(), lexer->n_lines);
+	}
 
 	lexer->next_token();
-	if(lexer->last_token->type != TOK_LEFT_CBRACK)
-		ERROR(T_CRIT, "function definition requries a { } block, function %s on line %d.", func_name, lexer->n_lines);
+	if(lexer->last_token->type != TOK_LEFT_CBRACK) {
+		drop_function(function, default_value);
+		PARSE_ERROR(NULL, "function definition requries a { } block, function %s on line %d.", func_name, lexer->n_lines);
+	}
+
+	return function;
+}
+
+// Free a function whose header has an error, with the default values of
+// its arguments and [default_value] of the argument being parsed
+void Parser::drop_function(Function * function, std::vector<Token *> * default_value) {
+	for(auto argument : function->get_arguments())
+		delete argument->default_value;
+
+	delete default_value;
+	delete function;
+}
+
+// Parse the instructions of a function body up to its }
+int Parser::parse_function_body(Function * function) {
+	const char * func_name = function->name;
+	int parsed;
 
 	// Call parse recursevily to parse function instructions
 	// Save current program to restore it after parsing
 	Program * current = program;
-	parse(function);
+
+	// Errors in the body are recovered from inside it, so the span always ends
+	if(trace)
+		trace->begin(func_name, "parse");
+
+	parsed = parse(function);
 	program = current;
 
+	if(trace)
+		trace->end();
+
+	if(! parsed)
+		return 0;
+
 	// No ending curly bracket
 	if(lexer->last_token->type == TOK_NULL)
-		ERROR(T_CRIT, "unexpected end of function %s, missing '}' on line %d.", func_name, lexer->n_lines);
-
-	// Push function to program
-	global_program->push_function(func_name, function);
+		PARSE_ERROR(0, "unexpected end of function %s, missing '}' on line %d.", func_name, lexer->n_lines);
 
-	return function;
+	return 1;
 }
 
 // Parse an if statement
 // Create an if instruction and push it to the current program
-void Parser::parse_if_statement() {
+int Parser::parse_if_statement() {
 	std::vector<Token *> * expression;
+	int parsed;
 
 	// Get logical expression
-	expression = parse_logical_expression(TOK_IMPLIES);
+	if(! (expression = parse_logical_expression(TOK_IMPLIES)))
+		return 0;
 
+	// The condition may be shared with other instructions, it is freed with the program
 	lexer->next_token();
-	if(lexer->last_token->type != TOK_LEFT_CBRACK)
-		ERROR(T_CRIT, "code execution definition requries a { } block, if statement on line %d.", lexer->n_lines);
+	if(lexer->last_token->type != TOK_LEFT_CBRACK) {
+		program->replaced.push_back(expression);
+		PARSE_ERROR(0, "code execution definition requries a { } block, if statement on line %d.", lexer->n_lines);
+	}
 
 	// Call parse recursevily to parse code block instructions
 	// Save current program to restore it after parsing
-	Program * if_program = new Program(program);
+	Program * if_program = new Program(program, PROGRAM_BLOCK);
 	Program * current = program;
 
-	parse(if_program);
+	parsed = parse(if_program);
 	program = current;
 
+	// Push instruction to program, a block with an error is freed with it
+	IfStatement * if_statement = new IfStatement(expression, if_program);
+
+	program->push_instruction(if_statement);
+
+	if(! parsed)
+		return 0;
+
 	// No ending curly bracket
 	if(lexer->last_token->type != TOK_RIGHT_CBRACK)
-		ERROR(T_CRIT, "unexpected end of code block, missing '}' on line %d.", lexer->n_lines);
+		PARSE_ERROR(0, "unexpected end of code block, missing '}' on line %d.", lexer->n_lines);
 
-	// Push instruction to program
-	IfStatement * if_statement = new IfStatement(expression, if_program);
+	return 1;
+}
 
-	program->push_instruction(if_statement);
+// Parse an import, the compiler has parsed the module before the source
+// and the source is parsed on top of it
+int Parser::parse_import() {
+	Token * tok;
+	const char * name;
+
+	tok = lexer->next_token();
+
+	if(tok->type != TOK_STRING)
+		PARSE_ERROR(0, "expected the file name of a module after import, on line %d.", lexer->n_lines);
+
+	name = tok->value();
+	tok = lexer->next_token();
+
+	if(tok->type != TOK_DOT)
+		PARSE_ERROR(0, "expected . after import \"%s\", on line %d.", name, lexer->n_lines);
+
+	return 1;
 }
 
 // Parse a return operation and set the corresponding
 // return type of the function
-void Parser::parse_return_operation() {
+int Parser::parse_return_operation() {
 	int type;
 	std::vector<Token *> * value;
 
@@ -739,36 +886,439 @@ void Parser::parse_return_operation() {
 	value = parse_expression(type);
 
 	Function * func = static_cast<Function *>(program);
-	func->set_return_type(type);
 
 	// Return to current program
 	program = current_program;
 
+	if(! value)
+		return 0;
+
+	func->set_return_type(type);
+
 	// Push instruction to current program
 	ReturnOperation * return_op = new ReturnOperation(value);
 	program->push_instruction(return_op);
+	return 1;
 }
 
 // Calls the main parse function with the global program as argument
 Program * Parser::parse() {
+	if(prelude) {
+		restore_prelude();
+		return parse_on(prelude);
+	}
+
 	global_program = new GlobalProgram;
 
-	this->parse(global_program);
+	parse_global();
+
+	return global_program;
+}
+
+// Parse on top of the modules and the prelude
+Program * Parser::parse_on(GlobalProgram * base) {
+	global_program = new GlobalProgram(base);
+
+	parse_global();
 
 	return global_program;
 }
 
+/*
+ * Parse the source into the global program. Unless it is streamed, the
+ * prescan finds the functions of the source first, which are registered
+ * before the main pass so that they can be called before they are defined.
+ * The main pass parses the top level and skips the bodies, except those
+ * whose return types it needs. The others are parsed after it, by up to
+ * [jobs] threads. The result does not depend on the order bodies are
+ * parsed in: calls set argument types in source order once every body is
+ * parsed, errors are sorted by line and strings added in source order.
+ */
+void Parser::parse_global() {
+	size_t first_error;
+	int line;
+
+	first_error = diagnostics ? diagnostics->list.size() : 0;
+	line = lexer->n_lines;
+
+	delete error;
+	error = NULL;
+
+	for(auto diagnostics : range_diagnostics)
+		delete diagnostics;
+
+	ranges.clear();
+	range_headers.clear();
+	range_of.clear();
+	range_functions.clear();
+	range_states.clear();
+	range_diagnostics.clear();
+	literals.clear();
+	expressions.clear();
+
+	for(auto parser : body_parsers) {
+		parser->literals.clear();
+		parser->expressions.clear();
+	}
+
+	if(! stream && Prescan::scan(buffer, 1 - line, ranges) && ranges.size()) {
+		if(! register_functions(line))
+			return;
+	}
+
+	else
+		ranges.clear();
+
+	// The bodies and calls of a source that stopped are left as they are
+	if(! this->parse(global_program))
+		return;
+
+	// Globals after the last function
+	if(stream)
+		stream->push(NULL, stream_variables);
+
+	if(ranges.size()) {
+		parse_bodies();
+		take_stats();
+
+		for(auto range : range_diagnostics) {
+			if(! diagnostics && range->list.size() && ! error)
+				error = new Diagnostic(range->list.front());
+
+			if(diagnostics)
+				diagnostics->list.insert(diagnostics->list.end(), range->list.begin(), range->list.end());
+		}
+
+		// Errors of the source in the order of its lines, as if it was parsed from start to end
+		if(diagnostics)
+			std::stable_sort(diagnostics->list.begin() + first_error, diagnostics->list.end(),
+					[](const Diagnostic & a, const Diagnostic & b) { return a.line < b.line; });
+
+		for(auto parser : body_parsers)
+			literals.insert(literals.end(), parser->literals.begin(), parser->literals.end());
+
+		std::sort(literals.begin(), literals.end(),
+				[](const std::pair<long, const char *> & a, const std::pair<long, const char *> & b) { return a.first < b.first; });
+
+		for(auto & literal : literals)
+			global_program->push_string(literal.second);
+	}
+
+	for(auto & function : *global_program->functions)
+		function.second->apply_call();
+}
+
+// Parse the header of each function the prescan found, the main pass starts
+// at [line]. Return 0 if parsing stopped at an error.
+int Parser::register_functions(int line) {
+	program = global_program;
+
+	for(size_t i = 0; i < ranges.size(); i++) {
+		FunctionRange & range = ranges[i];
+		Function * function = NULL;
+
+		range_headers[range.header] = i;
+		lexer->set_position(range.header, range.header_line);
+
+		const char * name = lexer->next_token()->value();
+
+		lexer->next_token();
+
+		// A function with an error in its header is left out, calls to it are unknown
+		if((function = parse_function_header(name))) {
+			global_program->push_function(name, function);
+			range_of[function] = i;
+		}
+
+		// An error of the lexer in the header is the cause of what went wrong
+		if(! function || lexer->errors != lexer_errors) {
+			Diagnostic diagnostic = statement_error(function ? *lexer->error : *error);
+
+			if(! report(diagnostic))
+				return 0;
+		}
+
+		range_functions.push_back(function);
+		range_states.push_back(function ? BODY_PENDING : BODY_PARSED);
+		range_diagnostics.push_back(new Diagnostics());
+
+		if(diagnostics) {
+			range_diagnostics.back()->file_name = diagnostics->file_name;
+			range_diagnostics.back()->source = diagnostics->source;
+		}
+	}
+
+	lexer->set_position(buffer, line);
+	return 1;
+}
+
+// Parse the pending bodies level by level, a level after the levels of the bodies it calls
+void Parser::parse_bodies() {
+	std::vector<int> levels(ranges.size(), -1);
+	std::vector<std::vector<int>> bodies;
+
+	// Longest chain of pending calls below each body, a call back into the chain is cut
+	std::function<int(int)> level = [&](int index) {
+		if(levels[index] >= 0)
+			return levels[index];
+
+		levels[index] = 0;
+
+		int depth = 0;
+
+		for(auto & name : ranges[index].calls) {
+			Function * callee = global_program->get_function(name.c_str());
+			auto range = callee ? range_of.find(callee) : range_of.end();
+
+			if(range != range_of.end() && range_states[range->second] == BODY_PENDING && range->second != index)
+				depth = std::max(depth, level(range->second) + 1);
+		}
+
+		return levels[index] = depth;
+	};
+
+	for(size_t i = 0; i < ranges.size(); i++) {
+		if(range_states[i] != BODY_PENDING)
+			continue;
+
+		size_t n = level(i);
+
+		if(bodies.size() <= n)
+			bodies.resize(n + 1);
+
+		bodies[n].push_back(i);
+	}
+
+	for(auto & indexes : bodies) {
+		std::vector<std::thread> threads;
+		std::atomic<size_t> next(0);
+		size_t n = std::min(indexes.size(), (size_t) jobs);
+		Phase * phase = Stats::thread_phase();
+
+		for(size_t t = 0; t < n; t++)
+			body_parser(t);
+
+		// Each thread takes the next body of the level until there are none
+		// left, its allocations are those of the phase parsing the source
+		auto parse_level = [&](Parser * parser) {
+			size_t i;
+
+			Stats::set_thread_phase(phase);
+
+			while((i = next++) < indexes.size())
+				parser->parse_body(indexes[i]);
+		};
+
+		// The first parser runs on this thread
+		for(size_t t = 1; t < n; t++)
+			threads.push_back(std::thread(parse_level, body_parsers[t]));
+
+		parse_level(body_parsers[0]);
+
+		for(auto & thread : threads)
+			thread.join();
+
+		for(auto index : indexes)
+			range_states[index] = BODY_PARSED;
+	}
+}
+
+// Parse a body the main pass needs, after the pending bodies it calls
+void Parser::parse_needed(int index) {
+	range_states[index] = BODY_PARSING;
+
+	for(auto & name : ranges[index].calls) {
+		Function * callee = global_program->get_function(name.c_str());
+		auto range = callee ? range_of.find(callee) : range_of.end();
+
+		if(range != range_of.end() && range_states[range->second] == BODY_PENDING)
+			parse_needed(range->second);
+	}
+
+	body_parser(0)->parse_body(index);
+	range_states[index] = BODY_PARSED;
+}
+
+// Body parsers are kept with the names their lexers hold, the program refers to them
+Parser * Parser::body_parser(size_t n) {
+	while(body_parsers.size() <= n)
+		body_parsers.push_back(new Parser());
+
+	Parser * parser = body_parsers[n];
+
+	parser->owner = this;
+	parser->set_input_code(buffer);
+	parser->global_program = global_program;
+	parser->module_order = module_order;
+	parser->trace = trace;
+
+	// Body parsers count on their own threads
+	if(stats && ! parser->stats)
+		parser->stats = new Stats();
+
+	parser->lexer->set_stats(stats ? parser->stats : NULL);
+
+	return parser;
+}
+
+// Body parsers keep their stats for the next source
+void Parser::take_stats() {
+	for(auto parser : body_parsers)
+		if(stats && parser->stats)
+			stats->take(parser->stats);
+}
+
+// Parse a body of the owner on any thread, errors stay with the body
+void Parser::parse_body(int index) {
+	FunctionRange & range = owner->ranges[index];
+
+	diagnostics = owner->range_diagnostics[index];
+	lexer->set_position(range.body, range.body_line);
+	program = global_program;
+
+	// A body that stopped leaves the others to be parsed
+	if(! parse_function_body(owner->range_functions[index])) {
+		Diagnostic diagnostic = statement_error(*error);
+
+		report(diagnostic);
+	}
+
+	delete error;
+	error = NULL;
+}
+
+// A body is parsed unless the prescan found it and it is still pending,
+// the main pass parses such a body as soon as it needs it
+int Parser::body_parsed(Function * func) {
+	auto range = owner->range_of.find(func);
+
+	if(range == owner->range_of.end() || owner->range_states[range->second] == BODY_PARSED)
+		return 1;
+
+	if(this == owner && range_states[range->second] == BODY_PENDING) {
+		parse_needed(range->second);
+		return 1;
+	}
+
+	return 0;
+}
+
+// The return type of a function whose body is not parsed yet, which is
+// only the case in a cycle of calls, is not known and left to the translator
+int Parser::known_return_type(Function * func) {
+	if(! body_parsed(func))
+		return TOK_NULL;
+
+	std::lock_guard<std::mutex> guard(func->lock);
+
+	return func->get_return_type() ? func->get_return_type() : TOK_AUTO;
+}
+
+// Strings are numbered in the order of the source, bodies may be parsed in any order
+void Parser::push_literal(const char * value) {
+	if(owner->ranges.empty())
+		global_program->push_string(value);
+	else
+		literals.push_back(std::make_pair((long) (lexer->token_begin - buffer), value));
+}
+
+// Undo what calls from the last source changed in the functions of the prelude
+void Parser::restore_prelude() {
+	for(auto & argument : prelude_arguments) {
+		argument.first->value = argument.second.value;
+		argument.first->type = argument.second.type;
+	}
+
+	for(auto & return_type : prelude_return_types) {
+		return_type.first->set_return_type(return_type.second);
+		return_type.first->caller = 0;
+		return_type.first->call_values.clear();
+	}
+}
+
+// Parse bodies on up to [jobs] threads
+void Parser::set_jobs(int jobs) {
+	if(jobs <= 0)
+		jobs = std::thread::hardware_concurrency();
+
+	this->jobs = jobs > 0 ? jobs : 1;
+}
+
+// Hand functions to a translator as they are parsed
+void Parser::set_stream(FunctionStream * stream) {
+	this->stream = stream;
+	this->stream_variables.clear();
+}
+
+// Set the order of the module parsed
+void Parser::set_module_order(int order) {
+	this->module_order = order;
+}
+
 /*
  * Sets the internal code buffer to the argument
  * This way we do not have to pass the buffer to the lexer
  * Each call.
  */
-void Parser::set_input_code(char * buffer) {
+void Parser::set_input_code(const char * buffer) {
 	this->buffer = buffer;
 	this->lexer->set_input_code(buffer);
 }
 
+// The body parsers hold tokens of the prelude as well
+void Parser::keep_tokens() {
+	lexer->keep();
+
+	for(auto parser : body_parsers)
+		parser->keep_tokens();
+}
+
+// Free the tokens of the last source, the program made of them is released
+void Parser::release_tokens() {
+	lexer->release();
+
+	for(auto parser : body_parsers)
+		parser->release_tokens();
+}
+
 // Set the lexer line start
 void Parser::set_line_start(int start) {
-	this->lexer->n_lines = -1 * start;
+	this->lexer->n_lines = 1 - start;
+}
+
+// Keep the state of the functions of the prelude, calls in a source change
+// the types of their arguments and return values
+void Parser::set_prelude(GlobalProgram * prelude) {
+	this->prelude = prelude;
+
+	prelude_arguments.clear();
+	prelude_return_types.clear();
+
+	if(! prelude)
+		return;
+
+	keep_tokens();
+
+	for(auto & function : *prelude->functions) {
+		for(auto argument : function.second->get_arguments())
+			prelude_arguments.push_back(std::make_pair(argument, Variable(*argument)));
+
+		prelude_return_types.push_back(std::make_pair(function.second, function.second->get_return_type()));
+	}
+}
+
+// Collect errors and recover from them
+void Parser::set_diagnostics(Diagnostics * diagnostics) {
+	this->diagnostics = diagnostics;
+}
+
+// Collect lexer statistics
+void Parser::set_stats(Stats * stats) {
+	this->stats = stats;
+	this->lexer->set_stats(stats);
+}
+
+// Record function definitions
+void Parser::set_trace(Trace * trace) {
+	this->trace = trace;
 }
@@ -9,43 +9,222 @@
 #define PARSER_H_
 
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "lexer.h"
+#include "trace.h"
+#include "error.h"
+#include "expression.h"
+#include "function_stream.h"
+#include "prescan.h"
 #include "mem/program.h"
 #include "mem/function.h"
 
+// Defines an expression while it is parsed. Its type is decided operand
+// by operand from left to right, and in a condition an operand after a
+// comparison has to have the type of the operand before it.
+class ExpressionState {
+
+public:
+	// Tokens of the expression in infix order, calls with their arguments
+	std::vector<Token *> * tokens;
+
+	// Whether the expression is a condition
+	int logical;
+
+	// Type of the expression, in a condition of the last operand
+	int type;
+
+	// Set by a comparison until the operand after it
+	int comparison;
+
+};
+
+// States of a function body found by the prescan
+#define BODY_PENDING 0
+#define BODY_PARSING 1
+#define BODY_PARSED 2
+
 class Parser {
 
 public:
 	Parser();
+	~Parser();
 
 	// Parse the code which resides in buffer, use the program passed
-	// as argument
-	void parse(Program * program);
+	// as argument. Return 0 if parsing stopped at an error.
+	int parse(Program * program);
 
 	// Entry point, call this function to set up a new program and
-	// to initialize a new parser
+	// to initialize a new parser. The program is returned even if parsing
+	// stopped at an error, with what was parsed before it.
 	Program * parse();
 
+	// Parse into a new global program that starts as a copy of [base],
+	// the functions and variables of the modules the source imports
+	Program * parse_on(GlobalProgram * base);
+
+	// Return the functions of the prelude to their state after it was parsed
+	void restore_prelude();
+
+	// Set the order of the module parsed, calls in later modules decide
+	// the argument types of the functions they call
+	void set_module_order(int order);
+
 	// Sets the internal buffer to the code pointed to by the argument
-	void set_input_code(char * buffer);
+	void set_input_code(const char * buffer);
+
+	// Keep the tokens lexed so far for as long as the parser lives
+	void keep_tokens();
+
+	// Free the tokens lexed since keep_tokens(), once the program of the
+	// source is released
+	void release_tokens();
 
 	// Set lexer line start
 	void set_line_start(int start);
 
+	// Collect lexer statistics in [stats]
+	void set_stats(Stats * stats);
+
+	// Record a span for each function definition in [trace]
+	void set_trace(Trace * trace);
+
+	// Parse every source on top of [prelude], a program parsed before,
+	// NULL to parse sources on their own
+	void set_prelude(GlobalProgram * prelude);
+
+	// Parse up to [jobs] function bodies at the same time, 0 for one per
+	// hardware thread and 1 to parse them all on the calling thread
+	void set_jobs(int jobs);
+
+	// Hand each function to [stream] once it is parsed, NULL to keep them
+	// in the program. Sources parsed on a prelude are not streamed.
+	void set_stream(FunctionStream * stream);
+
+	// Collect errors in [diagnostics] and go on parsing after them,
+	// without it parsing stops at the first error
+	void set_diagnostics(Diagnostics * diagnostics);
+
+	// Error of the statement being parsed. Once the source is parsed, the
+	// error parsing stopped at, NULL if it went on to the end: the first
+	// error without diagnostics, or the one after which there were too
+	// many with them, which is in them as well.
+	Diagnostic * error;
+
 private:
 	Lexer * lexer;
-	char * buffer;
+
+	// Errors of the lexer reported so far. Tokens the lexer failed on are
+	// looked for once per statement, not as each token is read.
+	int lexer_errors;
+	Trace * trace;
+
+	// Statistics the lexer counts in, those of a body parser are its own
+	// and taken by the owner once the bodies are parsed
+	Stats * stats;
+	Diagnostics * diagnostics;
+	const char * buffer;
 
 	// Global program and current program
 	GlobalProgram * global_program;
 	Program * program;
 
+	// Prelude and what calls may change in its functions, as it was after
+	// it was parsed, which is restored before each source
+	GlobalProgram * prelude;
+	std::vector<std::pair<Argument *, Variable>> prelude_arguments;
+	std::vector<std::pair<Function *, int>> prelude_return_types;
+
+	// Order of the module parsed, 0 without modules
+	int module_order;
+
+	// Stream functions are handed to, NULL if not streaming, and the
+	// globals first assigned since the last function handed over
+	FunctionStream * stream;
+	std::vector<Variable *> stream_variables;
+
+	// Functions the prescan found, by the start of their headers, and the
+	// function, state and errors of each body. Empty if the source is
+	// parsed from start to end, which it is when it is streamed.
+	std::vector<FunctionRange> ranges;
+	std::unordered_map<const char *, int> range_headers;
+	std::unordered_map<Function *, int> range_of;
+	std::vector<Function *> range_functions;
+	std::vector<int> range_states;
+	std::vector<Diagnostics *> range_diagnostics;
+
+	// Parsers of bodies, the first also parses those the main pass needs,
+	// and the most that parse at the same time
+	std::vector<Parser *> body_parsers;
+	int jobs;
+
+	// Parser of the source, which a body parser parses the bodies of
+	Parser * owner;
+
+	// String literals of the source by position, added to the global
+	// program in the order of the source once every body is parsed
+	std::vector<std::pair<long, const char *>> literals;
+
+	// Expressions of the source, each kept once so that expressions with
+	// the same tokens are the same node. Not kept when streaming, where a
+	// function is freed with its expressions once it is translated.
+	std::unordered_set<std::vector<Token *> *, expr::Hash, expr::Equal> expressions;
+
+	// Parse the source into the global program, the top level first and
+	// the bodies found by the prescan after it
+	void parse_global();
+
+	// Register the functions of the ranges, starting the main pass at [line],
+	// return 0 if parsing stopped at an error
+	int register_functions(int line);
+
+	// Parse the bodies the main pass did not need, level by level, where a
+	// body comes after the bodies of the functions it calls
+	void parse_bodies();
+
+	// Parse body [index] and, before it, the pending bodies it calls, on
+	// the calling thread
+	void parse_needed(int index);
+
+	// Return body parser [n], set up for the source
+	Parser * body_parser(size_t n);
+
+	// Add the statistics of the body parsers to those of the owner, once
+	// no body is being parsed
+	void take_stats();
+
+	// Parse body [index] of the source of the owner
+	void parse_body(int index);
+
+	// Whether the body of [func] is parsed, so its return type is known
+	int body_parsed(Function * func);
+
+	// Return type of [func] as far as it is known
+	int known_return_type(Function * func);
+
+	// Add a string literal to the global program, or keep it until the
+	// bodies are parsed
+	void push_literal(const char * value);
+
+	// Parse the statement that starts at [tok]. The parse functions of
+	// statements return 0 if they have an error, which is kept in error,
+	// and those of expressions and functions return NULL.
+	int parse_statement(Token * tok);
+
+	// Keep [diagnostic] as the error of the statement, unless it has one
+	void fail(const Diagnostic & diagnostic);
+
+	// Record [diagnostic] in diagnostics and forget the error of the
+	// statement, return 0 if parsing stops, with [diagnostic] as the error
+	int report(Diagnostic & diagnostic);
+
 	// Parse an inline code operation, C/C++ code
-	void parse_inline_code_operation();
+	int parse_inline_code_operation();
 
 	// Parse an assignment operation, for instace = or +=
-	void parse_assignment_operation(const char * name, int assign_type);
+	int parse_assignment_operation(const char * name, int assign_type);
 
 	// Convert infix expression to postfix expression
 	std::vector<Token *> * parse_expression(int &type, int tok_delim = TOK_DOT);
@@ -53,19 +232,59 @@ private:
 	// Convert infix logical expression to postfix expression
 	std::vector<Token *> * parse_logical_expression(int tok_delim);
 
+	// Parse an expression up to [tok_delim], or an arithmetic expression up to
+	// a ) outside its parentheses, and return its tokens in infix order
+	std::vector<Token *> * parse_operation(int & type, int tok_delim, int logical);
+
+	// Return the expression parsed before with the same tokens as
+	// [expression], which is deleted, or [expression] if there is none
+	std::vector<Token *> * share_expression(std::vector<Token *> * expression);
+
+	// Parse operands joined by operators of [precedence] or tighter, from [tok],
+	// set [type] to the type of the operation and return the token after it
+	Token * parse_binary(ExpressionState & state, Token * tok, int precedence, int & type);
+
+	// Parse an operand at [tok], which may be in parentheses or have a sign,
+	// set [type] to its type and return the token after it
+	Token * parse_operand(ExpressionState & state, Token * tok, int & type);
+
 	// Parse a call for a function with name [name]
 	// return a pointer to the function itself
 	Function * parse_function_call(const char * func_name, FunctionCall ** function_call = nullptr);
 
+	// Leave the argument [values] of a call with an error to the program
+	// to free, return NULL
+	Function * drop_arguments(std::vector<std::pair<std::vector<Token *> *, int>> & values);
+
 	// Parse a function definition with name [name]
-	// return a pointer to the fuction itself
+	// return a pointer to the fuction itself, NULL if it has an error
 	Function * parse_function_definition(const char * func_name);
 
+	// Parse the arguments of a function definition up to its {
+	Function * parse_function_header(const char * func_name);
+
+	// Free [function] of a header with an error, and [default_value] of
+	// the argument being parsed
+	void drop_function(Function * function, std::vector<Token *> * default_value);
+
+	// Parse the body of [function] after its {
+	int parse_function_body(Function * function);
+
 	// Parse a return operation
-	void parse_return_operation();
+	int parse_return_operation();
 
 	// Parse an if statement
-	void parse_if_statement();
+	int parse_if_statement();
+
+	// Parse an import, which the compiler has already resolved
+	int parse_import();
+
+	// Return [diagnostic], or the error of the lexer if it made one since
+	// the last one reported, which is the cause of what went wrong after
+	Diagnostic statement_error(Diagnostic & diagnostic);
+
+	// Skip the rest of a statement after its error is recorded
+	Token * synchronize();
 };
 
 #endif /* PARSER_H_ */
@@ -0,0 +1,82 @@
+/*
+ * prescan.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include "prescan.h"
+#include "lexer.h"
+
+// Lex the source once, keeping track of the depth of braces
+int Prescan::scan(const char * source, int line_start, std::vector<FunctionRange> & ranges) {
+	Lexer lexer;
+	Token * tok, * previous;
+	FunctionRange range;
+	const char * name;
+	int name_line, depth, header, body;
+
+	lexer.set_input_code(source);
+	lexer.n_lines = 1 - line_start;
+
+	previous = NULL;
+	name = NULL;
+	name_line = depth = header = body = 0;
+
+	for(;;) {
+		// Errors of the lexer are left to the parser, the lexer goes on after them
+		if((tok = lexer.next_token())->type == TOK_ERROR)
+			continue;
+
+		if(tok->type == TOK_NULL)
+			return ! depth;
+
+		// A name followed by : at the top level starts a definition
+		if(! depth && previous && previous->type == TOK_NAME && tok->type == TOK_COLON) {
+			range.name = previous->value();
+			range.header = name;
+			range.header_line = name_line;
+			range.calls.clear();
+			header = 1;
+		}
+
+		// A statement that ends before a { is not a definition
+		else if(! depth && header && (tok->type == TOK_DOT || tok->type == TOK_RIGHT_CBRACK))
+			header = 0;
+
+		if(tok->type == TOK_LEFT_CBRACK) {
+			if(! depth && header) {
+				range.body = lexer.token_begin + 1;
+				range.body_line = lexer.n_lines;
+				header = 0;
+				body = 1;
+			}
+
+			depth++;
+		}
+
+		else if(tok->type == TOK_RIGHT_CBRACK) {
+			// The parser stops at a } without a {
+			if(! depth)
+				return 0;
+
+			if(! --depth && body) {
+				range.end = lexer.token_begin + 1;
+				range.end_line = lexer.n_lines;
+				ranges.push_back(range);
+				body = 0;
+			}
+		}
+
+		else if(body && tok->type == TOK_LEFT_PAR && previous && previous->type == TOK_NAME)
+			range.calls.push_back(previous->value());
+
+		// Start of each name at the top level, in case it is a definition
+		if(! depth && tok->type == TOK_NAME) {
+			name = lexer.token_begin;
+			name_line = lexer.n_lines;
+		}
+
+		previous = tok;
+	}
+}
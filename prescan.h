@@ -0,0 +1,49 @@
+/*
+ * prescan.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#ifndef PRESCAN_H_
+#define PRESCAN_H_
+
+#include <string>
+#include <vector>
+
+// Defines a function definition at the top level of a source, found
+// before the source is parsed
+class FunctionRange {
+
+public:
+	std::string name;
+
+	// Start of the name, start of the body after its {, and the end of the
+	// definition after its }, each with the line it is on
+	const char * header;
+	const char * body;
+	const char * end;
+	int header_line;
+	int body_line;
+	int end_line;
+
+	// Names called in the body, for instance f in f(x)
+	std::vector<std::string> calls;
+
+};
+
+/*
+ * Skims a source with the lexer alone for every name : ( ... ) --> { }
+ * at the top level and the range of its body, so that every function is
+ * known before any body is parsed and bodies can be parsed in any order.
+ */
+class Prescan {
+
+public:
+	// Find the definitions of [source], which counts its lines from
+	// [line_start]. Return 0 if its braces do not balance, then the
+	// source can only be parsed from start to end.
+	static int scan(const char * source, int line_start, std::vector<FunctionRange> & ranges);
+};
+
+#endif /* PRESCAN_H_ */
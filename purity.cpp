@@ -0,0 +1,150 @@
+/*
+ * purity.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include "purity.h"
+#include "lexer.h"
+
+Purity::Purity() {
+
+	this->program = NULL;
+}
+
+// Start from what each function does itself, then take on what the functions
+// it calls do until nothing changes
+void Purity::analyse(GlobalProgram * program) {
+	int changed = 1;
+
+	this->program = program;
+	callees.clear();
+
+	for(auto & function : *program->functions) {
+		Function * f = function.second;
+
+		callees[f];
+
+		if(f->has_inline_code()) {
+			f->purity = PURITY_OPAQUE;
+			continue;
+		}
+
+		f->purity = PURITY_PURE;
+
+		// Strings are read through pointers
+		if(f->get_return_type() == TOK_STRING)
+			f->purity = PURITY_READS_GLOBALS;
+
+		for(auto argument : f->get_arguments())
+			if(argument->type == TOK_STRING)
+				f->purity = PURITY_READS_GLOBALS;
+
+		scan(f, f);
+	}
+
+	while(changed) {
+		changed = 0;
+
+		for(auto & function : callees) {
+			Function * f = function.first;
+
+			if(f->purity == PURITY_OPAQUE)
+				continue;
+
+			for(auto callee : function.second) {
+				int purity = ! callee || callee->changes_globals() ? PURITY_WRITES_GLOBALS : callee->purity;
+
+				if(purity > f->purity) {
+					f->purity = purity;
+					changed = 1;
+				}
+			}
+		}
+	}
+}
+
+// Add the calls and the reads of the instructions of a body or a block
+void Purity::scan(Function * function, Program * scope) {
+	int global;
+
+	for(auto ins : scope->get_instructions()) {
+		switch(ins->type) {
+
+		case TYPE_ASSIGNMENT:
+			scan_expression(function, scope, static_cast<Assignment *>(ins)->variable->value);
+
+			// A block assigns the global when the function has no such variable
+			find_variable(scope, static_cast<Assignment *>(ins)->variable->name, global);
+
+			if(global && scope != function)
+				function->purity = PURITY_WRITES_GLOBALS;
+
+			// Strings are read through pointers
+			if(static_cast<Assignment *>(ins)->variable->type == TOK_STRING && function->purity < PURITY_READS_GLOBALS)
+				function->purity = PURITY_READS_GLOBALS;
+
+			break;
+
+		case TYPE_RETURN:
+			scan_expression(function, scope, static_cast<ReturnOperation *>(ins)->value);
+			break;
+
+		case TYPE_IF_STATEMENT:
+			scan_expression(function, scope, static_cast<IfStatement *>(ins)->expression);
+			scan(function, static_cast<IfStatement *>(ins)->program);
+			break;
+
+		case TYPE_FUNCTIONCALL:
+			callees[function].insert(static_cast<FunctionCall *>(ins)->function);
+
+			for(auto argument : static_cast<FunctionCall *>(ins)->get_arguments())
+				scan_expression(function, scope, argument);
+
+			break;
+		}
+	}
+}
+
+// A name is a global unless the function or the block has it, a string
+// literal is in the string table of the program
+void Purity::scan_expression(Function * function, Program * scope, const std::vector<Token *> * expression) {
+	int global;
+
+	for(size_t i = 0; expression && i < expression->size(); i++) {
+		Token * tok = (*expression)[i];
+
+		if(tok->type == TOK_NAME && i + 1 < expression->size() && (*expression)[i + 1]->type == TOK_LEFT_PAR)
+			callees[function].insert(program->get_function(tok->value()));
+
+		else if(tok->type == TOK_NAME) {
+			find_variable(scope, tok->value(), global);
+
+			if(global && function->purity < PURITY_READS_GLOBALS)
+				function->purity = PURITY_READS_GLOBALS;
+		}
+
+		else if(tok->type == TOK_STRING && function->purity < PURITY_READS_GLOBALS)
+			function->purity = PURITY_READS_GLOBALS;
+	}
+}
+
+// Names of the purities, by value
+const char * Purity::name(int purity) {
+	static const char * names[] = { "unknown", "pure", "reads_globals", "writes_globals", "opaque" };
+
+	return purity >= PURITY_UNKNOWN && purity <= PURITY_OPAQUE ? names[purity] : "unknown";
+}
+
+// Resolve a name from the scope, a name that is nowhere is taken as a global
+Variable * Purity::find_variable(Program * scope, const char * name, int & global) {
+	std::unordered_map<std::string, Variable *>::iterator it;
+	Variable * var = scope->resolve_variable(name);
+	Program * root;
+
+	for(root = scope; root->parent_program; root = root->parent_program);
+
+	global = ! var || ((it = root->variables->find(name)) != root->variables->end() && it->second == var);
+	return var;
+}
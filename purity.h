@@ -0,0 +1,54 @@
+/*
+ * purity.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#ifndef PURITY_H_
+#define PURITY_H_
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include "mem/program.h"
+#include "mem/function.h"
+
+// Sets the purity of each function of a program. A function with inline
+// code is opaque. A function that calls an opaque function, or one that
+// changes globals, changes globals as well. A function that reads a global,
+// a string or a function that does reads globals. Any other is pure, its
+// value depends on its arguments only. Assignments in the body of a function
+// are to its own variables, a block assigns a global the body does not have.
+class Purity {
+
+public:
+	Purity();
+
+	// Set the purity of the functions of [program]
+	void analyse(GlobalProgram * program);
+
+	// Name of [purity], for statistics
+	static const char * name(int purity);
+
+	// Find variable [name] from [scope] the way the translation does, see
+	// Program::resolve_variable, and set [global] if it is a global or does
+	// not exist. Return 0 if it does not exist.
+	static Variable * find_variable(Program * scope, const char * name, int & global);
+
+private:
+	GlobalProgram * program;
+
+	// Functions each function calls, NULL for a function that is not defined
+	std::unordered_map<Function *, std::unordered_set<Function *>> callees;
+
+	// Add what [scope], the body of [function] or one of its blocks, reads
+	// and calls
+	void scan(Function * function, Program * scope);
+
+	// Add what [expression] in [scope] reads and calls
+	void scan_expression(Function * function, Program * scope, const std::vector<Token *> * expression);
+
+};
+
+#endif /* PURITY_H_ */
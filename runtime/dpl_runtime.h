@@ -0,0 +1,24 @@
+/*
+ * dpl_runtime.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ *
+ * Included by every translated DPL program, compile the output of the
+ * translator with this directory in the include path.
+ */
+
+#ifndef RUNTIME_DPL_RUNTIME_H_
+#define RUNTIME_DPL_RUNTIME_H_
+
+#include "dpl_string.h"
+
+// Functions the translator finds pure are constexpr, which takes the
+// bodies of C++14. Earlier standards get plain functions.
+#if __cpp_constexpr >= 201304
+#define DPL_CONSTEXPR constexpr
+#else
+#define DPL_CONSTEXPR
+#endif
+
+#endif /* RUNTIME_DPL_RUNTIME_H_ */
@@ -0,0 +1,250 @@
+/*
+ * dpl_string.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ *
+ * String type used by translated DPL programs for values of type string.
+ * The length is always stored, so no operation needs strlen. Strings are
+ * kept in one of four storages:
+ *
+ *   literal  - the empty string, which points to a static ""
+ *   small    - up to 15 characters stored inline, no allocation
+ *   heap     - longer strings built at run time
+ *   interned - entry of the deduplicated literal table emitted by the
+ *              translator, with its hash computed at compile time
+ *
+ * Only the translator makes strings that do not own their characters, through
+ * interned(), for the literal table that lives as long as the program. Any
+ * other string, from a char array or a pointer, is copied. Interned strings
+ * are unique per content, so two of them are equal only if they point to the
+ * same characters.
+ */
+
+#ifndef RUNTIME_DPL_STRING_H_
+#define RUNTIME_DPL_STRING_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <ostream>
+#include <functional>
+
+#define DPL_STRING_LITERAL 0
+#define DPL_STRING_SMALL 1
+#define DPL_STRING_HEAP 2
+#define DPL_STRING_INTERNED 3
+
+// Longest string stored inline, excluding the terminating zero
+#define DPL_STRING_SMALL_MAX 15
+
+namespace dpl {
+
+class string {
+
+public:
+	constexpr string() : length(0), storage(DPL_STRING_LITERAL), interned_hash(0), literal("") {}
+
+	// Characters of a char array up to its first zero, such as a literal in
+	// inline code or a buffer that may change after
+	template<size_t N>
+	string(const char (&data)[N]) : string(data, strnlen(data, N)) {}
+
+	// Copy [length] characters of [data]
+	string(const char * data, size_t length) : length(length), storage(DPL_STRING_LITERAL), interned_hash(0), literal(NULL) {
+		assign(data, length);
+	}
+
+	// Zero terminated string from C/C++ code, the only place that counts characters
+	explicit string(const char * data) : string(data, strlen(data)) {}
+
+	// Entry of the literal table, [hash] is the hash of the characters
+	static string interned(const char * literal, size_t length, uint32_t hash) {
+		return string(literal, length, hash, DPL_STRING_INTERNED);
+	}
+
+	string(const string & other) : length(other.length), storage(other.storage), interned_hash(other.interned_hash), literal(other.literal) {
+		if(other.storage == DPL_STRING_SMALL || other.storage == DPL_STRING_HEAP)
+			assign(other.data(), other.length);
+	}
+
+	string(string && other) : length(other.length), storage(other.storage), interned_hash(other.interned_hash) {
+		move(other);
+	}
+
+	~string() {
+		if(storage == DPL_STRING_HEAP)
+			free(heap);
+	}
+
+	string & operator=(const string & other) {
+		if(this != &other) {
+			string copy(other);
+			*this = static_cast<string &&>(copy);
+		}
+
+		return *this;
+	}
+
+	string & operator=(string && other) {
+		if(this != &other) {
+			if(storage == DPL_STRING_HEAP)
+				free(heap);
+
+			length = other.length;
+			storage = other.storage;
+			interned_hash = other.interned_hash;
+			move(other);
+		}
+
+		return *this;
+	}
+
+	// Number of characters
+	size_t size() const { return length; }
+
+	// Characters, always zero terminated
+	const char * data() const {
+		switch(storage) {
+
+		case DPL_STRING_SMALL:
+			return small;
+
+		case DPL_STRING_HEAP:
+			return heap;
+
+		default:
+			return literal;
+		}
+	}
+
+	const char * c_str() const { return data(); }
+
+	// FNV-1a hash of the characters, precomputed for interned strings
+	uint32_t hash() const {
+		if(storage == DPL_STRING_INTERNED)
+			return interned_hash;
+
+		uint32_t h = 2166136261u;
+		const char * pt = data();
+
+		for(size_t i = 0; i < length; i++)
+			h = (h ^ (unsigned char) pt[i]) * 16777619u;
+
+		return h;
+	}
+
+	// Concatenate two strings
+	friend string operator+(const string & a, const string & b) {
+		string result;
+
+		result.length = a.length + b.length;
+		char * pt = result.reserve(result.length);
+
+		memcpy(pt, a.data(), a.length);
+		memcpy(pt + a.length, b.data(), b.length);
+		pt[result.length] = '\0';
+
+		return result;
+	}
+
+	string & operator+=(const string & other) {
+		return *this = *this + other;
+	}
+
+	// Compare lengths before characters, interned strings by pointer
+	friend bool operator==(const string & a, const string & b) {
+		if(a.length != b.length)
+			return false;
+
+		if(a.data() == b.data())
+			return true;
+
+		if(a.storage == DPL_STRING_INTERNED && b.storage == DPL_STRING_INTERNED)
+			return false;
+
+		return ! memcmp(a.data(), b.data(), a.length);
+	}
+
+	friend bool operator!=(const string & a, const string & b) {
+		return ! (a == b);
+	}
+
+	friend bool operator<(const string & a, const string & b) {
+		size_t n = a.length < b.length ? a.length : b.length;
+		int cmp = memcmp(a.data(), b.data(), n);
+
+		return cmp < 0 || (cmp == 0 && a.length < b.length);
+	}
+
+	friend bool operator>(const string & a, const string & b) { return b < a; }
+	friend bool operator<=(const string & a, const string & b) { return ! (b < a); }
+	friend bool operator>=(const string & a, const string & b) { return ! (a < b); }
+
+	// Write the characters without searching for the terminating zero
+	friend std::ostream & operator<<(std::ostream & os, const string & str) {
+		return os.write(str.data(), str.length);
+	}
+
+private:
+	size_t length;
+	int storage;
+	uint32_t interned_hash;
+
+	union {
+		const char * literal;
+		char * heap;
+		char small[DPL_STRING_SMALL_MAX + 1];
+	};
+
+	constexpr string(const char * literal, size_t length, uint32_t hash, int storage)
+	: length(length), storage(storage), interned_hash(hash), literal(literal) {}
+
+	// Return storage for [length] characters plus the terminating zero
+	char * reserve(size_t length) {
+		if(length <= DPL_STRING_SMALL_MAX) {
+			storage = DPL_STRING_SMALL;
+			return small;
+		}
+
+		storage = DPL_STRING_HEAP;
+		heap = (char *) malloc(length + 1);
+
+		return heap;
+	}
+
+	// Copy [length] characters of [data] into own storage
+	void assign(const char * data, size_t length) {
+		char * pt = reserve(length);
+
+		memcpy(pt, data, length);
+		pt[length] = '\0';
+	}
+
+	// Take the storage of [other], which must be of the same storage type
+	void move(string & other) {
+		if(storage == DPL_STRING_SMALL)
+			memcpy(small, other.small, sizeof(small));
+		else
+			literal = other.literal;
+
+		other.length = 0;
+		other.storage = DPL_STRING_LITERAL;
+		other.interned_hash = 0;
+		other.literal = "";
+	}
+};
+
+}
+
+namespace std {
+
+template<>
+struct hash<dpl::string> {
+	size_t operator()(const dpl::string & str) const { return str.hash(); }
+};
+
+}
+
+#endif /* RUNTIME_DPL_STRING_H_ */
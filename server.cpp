@@ -0,0 +1,364 @@
+/*
+ * server.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <climits>
+#include <cerrno>
+#include <ctime>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "server.h"
+
+// Longest header line of a request or a response
+#define SERVER_HEADER_SIZE 128
+
+// Milliseconds on a clock that is not set back
+static long milliseconds() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec * 1000L + now.tv_nsec / 1000000L;
+}
+
+// Wait until [fd] is ready for [events], return 0 if [deadline] in
+// milliseconds passed first or the connection was lost, 0 waits as long as it takes
+static int wait_for(int fd, short events, long deadline) {
+	struct pollfd ready = { fd, events, 0 };
+	long left;
+	int n;
+
+	for(;;) {
+		left = deadline ? deadline - milliseconds() : -1;
+
+		if(deadline && left <= 0)
+			return 0;
+
+		if((n = poll(&ready, 1, (int) left)) > 0)
+			return 1;
+
+		if(n < 0 && errno != EINTR)
+			return 0;
+	}
+}
+
+// Whether a read or write of a socket that is not blocking has to wait
+static int again() {
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+// Write all of [data] to [fd] before [deadline], return 0 if the
+// connection was lost or the deadline passed
+static int write_all(int fd, const char * data, size_t n, long deadline) {
+	ssize_t written;
+
+	while(n) {
+		if(! wait_for(fd, POLLOUT, deadline))
+			return 0;
+
+		if((written = write(fd, data, n)) < 0 && again())
+			continue;
+
+		if(written <= 0)
+			return 0;
+
+		data += written;
+		n -= written;
+	}
+
+	return 1;
+}
+
+// Read exactly [n] bytes from [fd] before [deadline], return 0 if the
+// connection was lost or the deadline passed
+static int read_all(int fd, char * data, size_t n, long deadline) {
+	ssize_t got;
+
+	while(n) {
+		if(! wait_for(fd, POLLIN, deadline))
+			return 0;
+
+		if((got = read(fd, data, n)) < 0 && again())
+			continue;
+
+		if(got <= 0)
+			return 0;
+
+		data += got;
+		n -= got;
+	}
+
+	return 1;
+}
+
+// Read a header line from [fd] into [line] before [deadline], without
+// the newline. What has arrived is looked at first, so that nothing
+// after the line is taken from the socket.
+static int read_header(int fd, char * line, long deadline) {
+	size_t length = 0, take;
+	ssize_t got;
+	char * end;
+
+	while(length < SERVER_HEADER_SIZE - 1) {
+		if(! wait_for(fd, POLLIN, deadline))
+			return 0;
+
+		if((got = recv(fd, line + length, SERVER_HEADER_SIZE - 1 - length, MSG_PEEK)) < 0 && again())
+			continue;
+
+		if(got <= 0)
+			return 0;
+
+		end = (char *) memchr(line + length, '\n', got);
+		take = end ? end - (line + length) + 1 : got;
+
+		if(read(fd, line + length, take) != (ssize_t) take)
+			return 0;
+
+		length += take;
+
+		if(end) {
+			line[length - 1] = '\0';
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// Open a socket for [path], to bind or connect with [address], -1 on failure
+static int open_socket(const char * path, struct sockaddr_un & address) {
+	if(strlen(path) >= sizeof(address.sun_path))
+		return -1;
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	return socket(AF_UNIX, SOCK_STREAM, 0);
+}
+
+Server::Server(Compiler * compiler) {
+
+	this->compiler = compiler;
+	this->requests = 0;
+	this->hits = 0;
+
+}
+
+// Accept connections one at a time, each carries one request
+int Server::serve(const char * path) {
+	struct sockaddr_un address;
+	struct stat existing;
+	int fd, client;
+
+	if((fd = open_socket(path, address)) < 0)
+		return 0;
+
+	// A socket left by an earlier server is replaced, any other file is not
+	if(! lstat(path, &existing)) {
+		if(! S_ISSOCK(existing.st_mode)) {
+			close(fd);
+			return 0;
+		}
+
+		unlink(path);
+	}
+
+	if(bind(fd, (struct sockaddr *) &address, sizeof(address)) < 0 || listen(fd, 16) < 0) {
+		close(fd);
+		return 0;
+	}
+
+	// A client that goes away must not take the server with it
+	signal(SIGPIPE, SIG_IGN);
+
+	// Functions that did not change are not translated again
+	compiler->keep_functions = 1;
+
+	std::cerr << "listening on " << path << std::endl;
+
+	for(;;) {
+		if((client = accept(fd, NULL, NULL)) < 0)
+			continue;
+
+		// Reads and writes wait in poll, for a deadline of the whole request
+		fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+
+		// A request the server fails on is dropped, the next ones are answered
+		try {
+			answer(client);
+		} catch(std::exception & e) {
+			std::cerr << "Error: failed to answer a request: " << e.what() << "." << std::endl;
+		}
+
+		close(client);
+	}
+
+	return 1;
+}
+
+// Compile the source of a request, or find its translation in the cache
+void Server::answer(int fd) {
+	char header[SERVER_HEADER_SIZE], magic[8];
+	int backend, line_start;
+	size_t name_length, source_length;
+	std::string name, source;
+	uint64_t hash = 14695981039346656037ULL;
+	CacheEntry fresh, * entry;
+	int cacheable;
+	long deadline = milliseconds() + SERVER_TIMEOUT * 1000L;
+
+	if(! read_header(fd, header, deadline)
+			|| sscanf(header, "%7s %d %d %zu %zu", magic, &backend, &line_start, &name_length, &source_length) != 5
+			|| strcmp(magic, SERVER_MAGIC) || name_length > PATH_MAX || source_length > SERVER_SOURCE_MAX)
+		return;
+
+	name.resize(name_length);
+	source.resize(source_length);
+
+	if(! read_all(fd, &name[0], name_length, deadline) || ! read_all(fd, &source[0], source_length, deadline))
+		return;
+
+	requests++;
+
+	// FNV-1a over everything the translation depends on
+	for(auto part : {std::to_string(backend) + " " + std::to_string(line_start), name, source})
+		for(unsigned char c : part + '\0')
+			hash = (hash ^ c) * 1099511628211ULL;
+
+	// Running a program again is not the same as showing its earlier output
+	cacheable = backend == BACKEND_CPP || backend == BACKEND_LLVM;
+
+	auto it = cache.find(hash);
+
+	if(cacheable && it != cache.end() && it->second.source == source) {
+		entry = &it->second;
+		hits++;
+
+		// The C++ for inline code is written again, it may have been changed or removed
+		if(! entry->fallback_path.empty()) {
+			std::ofstream file(entry->fallback_path);
+
+			if(file)
+				file << entry->fallback_output;
+			else
+				std::cerr << "Error: failed to write to file " << entry->fallback_path << "." << std::endl;
+		}
+	}
+
+	else {
+		std::ostringstream output, diagnostics;
+		std::streambuf * stdout_buffer;
+
+		// Programs that run write to standard output, which goes to the client as well
+		stdout_buffer = std::cout.rdbuf(output.rdbuf());
+
+		compiler->backend = backend;
+		compiler->line_start = line_start;
+
+		try {
+			fresh.status = compiler->compile(name.c_str(), source.c_str(), output) ? 0 : 1;
+		} catch(...) {
+			std::cout.rdbuf(stdout_buffer);
+			throw;
+		}
+
+		std::cout.rdbuf(stdout_buffer);
+		compiler->diagnostics->print(diagnostics);
+
+		fresh.output = output.str();
+		fresh.diagnostics = diagnostics.str();
+		fresh.fallback_output = compiler->fallback_output;
+		fresh.fallback_path = compiler->fallback_path;
+		entry = &fresh;
+
+		if(cacheable) {
+			if(cache.size() >= SERVER_CACHE_ENTRIES)
+				cache.clear();
+
+			fresh.source = source;
+			entry = &(cache[hash] = fresh);
+		}
+	}
+
+	snprintf(header, sizeof(header), "%s %d %zu %zu\n", SERVER_MAGIC, entry->status, entry->output.size(), entry->diagnostics.size());
+
+	// The time of the compilation is not the client's
+	deadline = milliseconds() + SERVER_TIMEOUT * 1000L;
+
+	if(write_all(fd, header, strlen(header), deadline) && write_all(fd, entry->output.data(), entry->output.size(), deadline))
+		write_all(fd, entry->diagnostics.data(), entry->diagnostics.size(), deadline);
+}
+
+// Send a file and wait for its translation
+int Server::request(const char * path, int backend, int line_start, char * file_name) {
+	struct sockaddr_un address;
+	char header[SERVER_HEADER_SIZE], magic[8], absolute[PATH_MAX];
+	std::ifstream file(file_name, std::ios::binary);
+	std::ostringstream content;
+	std::string source, output, diagnostics;
+	size_t output_length, diagnostics_length;
+	int fd, status;
+
+	if(! file) {
+		std::cerr << "Error: failed to read from file " << file_name << "." << std::endl;
+		return 1;
+	}
+
+	content << file.rdbuf();
+	source = content.str();
+
+	// The server runs in a directory of its own, files it writes go next to the source
+	if(! realpath(file_name, absolute))
+		strcpy(absolute, file_name);
+
+	if((fd = open_socket(path, address)) < 0)
+		return -1;
+
+	if(connect(fd, (struct sockaddr *) &address, sizeof(address)) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	snprintf(header, sizeof(header), "%s %d %d %zu %zu\n", SERVER_MAGIC, backend, line_start, strlen(absolute), source.size());
+
+	// The server may take as long as the compilation does
+	if(! write_all(fd, header, strlen(header), 0) || ! write_all(fd, absolute, strlen(absolute), 0)
+			|| ! write_all(fd, source.data(), source.size(), 0) || ! read_header(fd, header, 0)
+			|| sscanf(header, "%7s %d %zu %zu", magic, &status, &output_length, &diagnostics_length) != 4) {
+		close(fd);
+		return -1;
+	}
+
+	output.resize(output_length);
+	diagnostics.resize(diagnostics_length);
+
+	if(! read_all(fd, &output[0], output_length, 0) || ! read_all(fd, &diagnostics[0], diagnostics_length, 0)) {
+		close(fd);
+		return -1;
+	}
+
+	close(fd);
+
+	std::cout << output;
+	std::cerr << diagnostics;
+
+	return status;
+}
@@ -0,0 +1,86 @@
+/*
+ * server.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "compiler.h"
+
+// Translations kept by the server, the cache starts over when it is full
+#define SERVER_CACHE_ENTRIES 256
+
+// Longest source a request may carry, in bytes
+#define SERVER_SOURCE_MAX (64 << 20)
+
+// Seconds a client may take to send a whole request, and to read the
+// whole response
+#define SERVER_TIMEOUT 10
+
+// First word of requests and responses
+#define SERVER_MAGIC "DPL1"
+
+// Defines a translation the server has answered with
+class CacheEntry {
+
+public:
+	std::string source;
+	std::string output;
+	std::string diagnostics;
+	int status;
+
+	// C++ for inline code written next to the output, and its file
+	std::string fallback_output;
+	std::string fallback_path;
+
+};
+
+/*
+ * Answers compile requests on a Unix domain socket with one Compiler that
+ * is kept between requests, together with its lexer, translators, prelude
+ * and the translations of sources it has seen. A request is the line
+ *   DPL1 backend line_start name_length source_length
+ * followed by the name and the source, and the response is the line
+ *   DPL1 status output_length diagnostics_length
+ * followed by the output and the diagnostics as text. Requests are
+ * answered one at a time, a client that has not sent its request or read
+ * the response SERVER_TIMEOUT seconds after it started is dropped. Sources
+ * that changed are compiled again, their functions that did not are
+ * written from their earlier translation.
+ */
+class Server {
+
+public:
+	Server(Compiler * compiler);
+
+	// Listen on the socket [path] and answer requests until the process is
+	// killed, return 0 if the socket could not be opened
+	int serve(const char * path);
+
+	// Send [file_name] to the server on [path], write the output to standard
+	// output and the diagnostics to standard error. Return the status of
+	// the compilation, or -1 if the server could not be reached.
+	static int request(const char * path, int backend, int line_start, char * file_name);
+
+	// Requests answered, and the ones answered from the cache
+	long requests;
+	long hits;
+
+private:
+	Compiler * compiler;
+
+	// Translations by a hash of the backend, line start, name and source
+	std::unordered_map<uint64_t, CacheEntry> cache;
+
+	// Read a request from [fd] and answer it
+	void answer(int fd);
+};
+
+#endif /* SERVER_H_ */
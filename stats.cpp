@@ -0,0 +1,221 @@
+/*
+ * stats.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include <ctime>
+#include <chrono>
+#include <iomanip>
+
+#include "stats.h"
+
+Phase::Phase(std::string name) {
+
+	this->name = name;
+	this->wall = 0;
+	this->cpu = 0;
+	this->calls = 0;
+	this->allocations = 0;
+	this->allocated_bytes = 0;
+	this->live_bytes = 0;
+
+}
+
+bool Stats::heap_counted = false;
+
+// Innermost phase of the thread
+static thread_local Phase * running_phase = NULL;
+
+Stats::Stats() {
+}
+
+// Start timing a phase, the time is added to earlier runs of the phase
+void Stats::begin(const char * phase) {
+	Start start;
+
+	start.phase = get_phase(phase);
+	start.wall = wall_time();
+	start.cpu = cpu_time();
+
+	running.push_back(start);
+	running_phase = start.phase;
+}
+
+// Stop timing the innermost phase
+void Stats::end() {
+	Start & last = running.back();
+
+	last.phase->wall += wall_time() - last.wall;
+	last.phase->cpu += cpu_time() - last.cpu;
+	last.phase->calls++;
+
+	running.pop_back();
+	running_phase = running.empty() ? NULL : running.back().phase;
+}
+
+// Return the phase [name], created if it does not exist
+Phase * Stats::get_phase(const char * name) {
+	for(auto phase : phases)
+		if(phase->name == name)
+			return phase;
+
+	phases.push_back(new Phase(name));
+	return phases.back();
+}
+
+// Return the counter [name], created with the value 0 if it does not exist
+long & Stats::counter(const char * name) {
+	auto it = counter_index.find(name);
+
+	if(it != counter_index.end())
+		return counters[it->second].second;
+
+	counter_index[name] = counters.size();
+	counters.push_back(std::make_pair(std::string(name), 0L));
+
+	return counters.back().second;
+}
+
+// Add to a counter
+void Stats::count(const char * name, long n) {
+	counter(name) += n;
+}
+
+// Phases without processor time stay without it
+void Stats::take(Stats * other) {
+	for(auto phase : other->phases) {
+		Phase * to = get_phase(phase->name.c_str());
+
+		to->wall += phase->wall;
+		to->cpu = to->cpu < 0 || phase->cpu < 0 ? -1 : to->cpu + phase->cpu;
+		to->calls += phase->calls;
+		to->allocations += phase->allocations;
+		to->allocated_bytes += phase->allocated_bytes;
+		to->live_bytes += phase->live_bytes;
+
+		phase->wall = 0;
+		phase->cpu = phase->cpu < 0 ? -1 : 0;
+		phase->calls = 0;
+		phase->allocations = 0;
+		phase->allocated_bytes = 0;
+		phase->live_bytes = 0;
+	}
+
+	for(auto & counter : other->counters) {
+		count(counter.first.c_str(), counter.second);
+		counter.second = 0;
+	}
+}
+
+// Output the phases and counters as a table
+void Stats::print(std::ostream & out) {
+	out << std::fixed << std::setprecision(3);
+	out << std::left << std::setw(16) << "phase" << std::right << std::setw(12) << "wall ms" << std::setw(12) << "cpu ms";
+
+	if(heap_counted)
+		out << std::setw(12) << "allocs" << std::setw(14) << "bytes" << std::setw(14) << "live bytes";
+
+	out << std::endl;
+
+	for(auto phase : phases) {
+		out << std::left << std::setw(16) << phase->name << std::right << std::setw(12) << phase->wall << std::setw(12);
+
+		if(phase->cpu < 0)
+			out << "-";
+		else
+			out << phase->cpu;
+
+		if(heap_counted)
+			out << std::setw(12) << phase->allocations << std::setw(14) << phase->allocated_bytes << std::setw(14) << phase->live_bytes;
+
+		out << std::endl;
+	}
+
+	out << std::endl << std::left << std::setw(16) << "counter" << std::right << std::setw(12) << "value" << std::endl;
+
+	for(auto & counter : counters)
+		out << std::left << std::setw(16) << counter.first << std::right << std::setw(12) << counter.second << std::endl;
+
+	out.unsetf(std::ios::floatfield | std::ios::adjustfield);
+}
+
+// Output the phases and counters as JSON, phases without processor time have null
+void Stats::write_json(std::ostream & out) {
+	out << std::fixed << std::setprecision(3) << "{\n  \"phases\": [";
+
+	for(size_t i = 0; i < phases.size(); i++) {
+		out << (i ? "," : "") << "\n    {\"name\": \"" << phases[i]->name << "\", \"wall_ms\": " << phases[i]->wall << ", \"cpu_ms\": ";
+
+		if(phases[i]->cpu < 0)
+			out << "null";
+		else
+			out << phases[i]->cpu;
+
+		out << ", \"calls\": " << phases[i]->calls;
+
+		if(heap_counted)
+			out << ", \"allocations\": " << phases[i]->allocations << ", \"allocated_bytes\": " << phases[i]->allocated_bytes
+					<< ", \"live_bytes\": " << phases[i]->live_bytes;
+
+		out << "}";
+	}
+
+	out << "\n  ],\n  \"counters\": {";
+
+	for(size_t i = 0; i < counters.size(); i++)
+		out << (i ? "," : "") << "\n    \"" << counters[i].first << "\": " << counters[i].second;
+
+	out << "\n  }\n}" << std::endl;
+	out.unsetf(std::ios::floatfield);
+}
+
+// Monotonic wall clock time
+double Stats::wall_time() {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Processor time of the process
+double Stats::cpu_time() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Set by begin and end on the thread
+Phase * Stats::thread_phase() {
+	return running_phase;
+}
+
+// The phase is only read by AllocProfile, which counts under its lock
+void Stats::set_thread_phase(Phase * phase) {
+	running_phase = phase;
+}
+
+CountingBuffer::CountingBuffer(std::streambuf * target) {
+
+	this->target = target;
+	this->bytes = 0;
+
+}
+
+// Unbuffered, every character passes through here or xsputn
+int CountingBuffer::overflow(int c) {
+	if(c == traits_type::eof())
+		return traits_type::not_eof(c);
+
+	bytes++;
+	return target->sputc(c);
+}
+
+std::streamsize CountingBuffer::xsputn(const char * data, std::streamsize n) {
+	bytes += n;
+	return target->sputn(data, n);
+}
+
+int CountingBuffer::sync() {
+	return target->pubsync();
+}
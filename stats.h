@@ -0,0 +1,131 @@
+/*
+ * stats.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+
+// Defines the time spent in a phase of the compiler, in milliseconds
+class Phase {
+
+public:
+	Phase(std::string name);
+
+	std::string name;
+
+	// Monotonic wall clock time
+	double wall;
+
+	// Processor time of the process, negative if not measured
+	double cpu;
+
+	// Number of times the phase was entered
+	long calls;
+
+	// Heap traffic of the phase, live bytes are those allocated in it and
+	// not freed yet, counted once AllocProfile is enabled
+	long allocations;
+	long allocated_bytes;
+	long live_bytes;
+
+};
+
+// Collects timers and counters of a compilation. Phases are timed with
+// begin and end, which may be nested, for instance for each pass. The
+// innermost phase of a thread is also the one AllocProfile charges the
+// allocations of the thread to.
+class Stats {
+
+public:
+	Stats();
+
+	// Start timing [phase]
+	void begin(const char * phase);
+
+	// Stop timing the innermost phase
+	void end();
+
+	// Return the phase [name], for code that accumulates time itself
+	Phase * get_phase(const char * name);
+
+	// Return the counter [name], which stays where it is for as long as
+	// the stats live
+	long & counter(const char * name);
+
+	// Add [n] to the counter [name]
+	void count(const char * name, long n = 1);
+
+	// Add the times and counts of [other] to the phases and counters of
+	// the same names, then start [other] again from 0
+	void take(Stats * other);
+
+	// Output the phases and counters as a table
+	void print(std::ostream & out);
+
+	// Output the phases and counters as JSON
+	void write_json(std::ostream & out);
+
+	// Monotonic wall clock time in milliseconds
+	static double wall_time();
+
+	// Processor time of the process in milliseconds
+	static double cpu_time();
+
+	// Innermost phase running on the calling thread, NULL outside any phase
+	static Phase * thread_phase();
+
+	// Charge the allocations of the calling thread to [phase], a phase
+	// another thread runs, for threads that work for it
+	static void set_thread_phase(Phase * phase);
+
+	// Whether the phases have their heap traffic, set by AllocProfile
+	static bool heap_counted;
+
+private:
+	// Phases and counters in the order they were first used
+	std::vector<Phase *> phases;
+	std::deque<std::pair<std::string, long>> counters;
+	std::unordered_map<std::string, size_t> counter_index;
+
+	// Defines a running phase and the counts it was started at
+	class Start {
+
+	public:
+		Phase * phase;
+		double wall;
+		double cpu;
+
+	};
+
+	std::vector<Start> running;
+};
+
+// Stream buffer that counts the bytes written through it to another buffer
+class CountingBuffer : public std::streambuf {
+
+public:
+	CountingBuffer(std::streambuf * target);
+
+	// Bytes written
+	long bytes;
+
+protected:
+	int overflow(int c);
+	std::streamsize xsputn(const char * data, std::streamsize n);
+	int sync();
+
+private:
+	std::streambuf * target;
+};
+
+#endif /* STATS_H_ */
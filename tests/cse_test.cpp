@@ -0,0 +1,122 @@
+/*
+ * cse_test.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ *
+ * Subexpressions the CSE pass computes once, and the ones it has to leave:
+ * calls of functions that change globals or have inline code, and
+ * expressions after inline code, which may change any variable.
+ */
+
+#include <sstream>
+#include <string>
+
+#include "compiler.h"
+#include "test.h"
+
+static const char * source =
+	"say : (s) --> {\n"
+	"	@ {\n"
+	"		std::cout << s << std::endl;\n"
+	"	}\n"
+	"}\n"
+	"g = 5.\n"
+	"sq : (x) --> {\n"
+	"	n = x + 0.\n"
+	"	ret n * n.\n"
+	"}\n"
+	"bump : (x) --> {\n"
+	"	n = x + 0.\n"
+	"	? n > 0 --> {\n"
+	"		g = n.\n"
+	"	}\n"
+	"	ret n.\n"
+	"}\n"
+	"loud : (x) --> {\n"
+	"	n = x + 0.\n"
+	"	say(\"x\").\n"
+	"	ret n.\n"
+	"}\n"
+	"pure : (x) --> {\n"
+	"	n = x + 0.\n"
+	"	a = sq(n) - 1.\n"
+	"	b = sq(n) - 2.\n"
+	"	c = (n + 1) * (n + 1).\n"
+	"	ret a + b + c.\n"
+	"}\n"
+	"effects : (x) --> {\n"
+	"	n = x + 0.\n"
+	"	a = bump(n) - 1.\n"
+	"	b = bump(n) - 2.\n"
+	"	c = loud(n) - 1.\n"
+	"	d = loud(n) - 2.\n"
+	"	ret a + b + c + d.\n"
+	"}\n"
+	"coded : (x) --> {\n"
+	"	n = x + 0.\n"
+	"	a = n * 7.\n"
+	"	@ {\n"
+	"		n = 3;\n"
+	"	}\n"
+	"	b = n * 7.\n"
+	"	ret a + b.\n"
+	"}\n"
+	"pure(effects(coded(2))).\n";
+
+// Translate the source to C++, with or without the CSE pass
+static std::string translate(int cse) {
+	Compiler compiler;
+	std::ostringstream output;
+
+	compiler.cse = cse;
+	CHECK(compiler.compile("cse.dpl", source, output));
+
+	return output.str();
+}
+
+// Body of the function defined by [signature] in [output], empty if there is none
+static std::string body(const std::string & output, const std::string & signature) {
+	size_t begin = output.find("\n" + signature + " {\n");
+
+	if(begin == std::string::npos)
+		return "";
+
+	return output.substr(begin, output.find("\n}\n", begin) - begin);
+}
+
+// Contains [text]
+static bool has(const std::string & body, const char * text) {
+	return body.find(text) != std::string::npos;
+}
+
+int main() {
+	std::string output = translate(1);
+	std::string pure = body(output, "[[gnu::const]] DPL_CONSTEXPR int pure(int x)");
+	std::string effects = body(output, "int effects(int x)");
+	std::string coded = body(output, "int coded(int x)");
+
+	// A call of a pure function, and arithmetic repeated within an expression
+	CHECK(has(pure, "_cse0 = sq(n);"));
+	CHECK(has(pure, "a = _cse0-1;"));
+	CHECK(has(pure, "b = _cse0-2;"));
+	CHECK(has(pure, "_cse1 = n+1;"));
+	CHECK(has(pure, "c = (_cse1)*(_cse1);"));
+
+	// Calls that change globals, directly or through inline code
+	CHECK(! effects.empty() && ! has(effects, "_cse"));
+	CHECK(has(effects, "a = bump(n)-1;"));
+	CHECK(has(effects, "b = bump(n)-2;"));
+	CHECK(has(effects, "c = loud(n)-1;"));
+	CHECK(has(effects, "d = loud(n)-2;"));
+
+	// The same expression before and after inline code
+	CHECK(! coded.empty() && ! has(coded, "_cse"));
+	CHECK(has(coded, "a = n*7;"));
+	CHECK(has(coded, "b = n*7;"));
+
+	// Nothing is hoisted without the pass
+	CHECK(! has(translate(0), "_cse"));
+
+	return TEST_RESULT();
+}
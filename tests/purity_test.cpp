@@ -0,0 +1,116 @@
+/*
+ * purity_test.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ *
+ * Purity of each kind of function, and the attributes and constexpr the
+ * translator declares them with.
+ */
+
+#include <sstream>
+#include <string>
+
+#include "compiler.h"
+#include "test.h"
+
+static const char * source =
+	"say : (s) --> {\n"
+	"	@ {\n"
+	"		std::cout << s << std::endl;\n"
+	"	}\n"
+	"}\n"
+	"g = 5.\n"
+	"sq : (x) --> {\n"
+	"	n = x + 0.\n"
+	"	ret n * n.\n"
+	"}\n"
+	"scaled : (x) --> {\n"
+	"	n = x + 0.\n"
+	"	ret n * g.\n"
+	"}\n"
+	"bump : (x) --> {\n"
+	"	n = x + 0.\n"
+	"	? n > 0 --> {\n"
+	"		g = n.\n"
+	"	}\n"
+	"	ret n.\n"
+	"}\n"
+	"loud : (x) --> {\n"
+	"	n = x + 0.\n"
+	"	say(\"x\").\n"
+	"	ret n.\n"
+	"}\n"
+	"label : (x) --> {\n"
+	"	n = x + 0.\n"
+	"	ret \"n\".\n"
+	"}\n"
+	"one : (s) --> {\n"
+	"	ret 1.\n"
+	"}\n"
+	"twice : (x) --> {\n"
+	"	n = x + 0.\n"
+	"	m = bump(n) + 0.\n"
+	"	ret m.\n"
+	"}\n"
+	"say(label(twice(loud(scaled(sq(one(\"a\"))))))).\n";
+
+// Function [name] of [program]
+static Function * function(GlobalProgram * program, const std::string & name) {
+	return program->get_function(name);
+}
+
+// Contains [text] as a line of its own
+static bool has_line(const std::string & output, const std::string & text) {
+	return output.find("\n" + text + "\n") != std::string::npos;
+}
+
+int main() {
+	Parser parser;
+	Purity purity;
+
+	parser.set_input_code(source);
+	GlobalProgram * program = static_cast<GlobalProgram *>(parser.parse());
+
+	CHECK(! parser.error);
+	purity.analyse(program);
+
+	// Arithmetic on arguments and own variables
+	CHECK(function(program, "sq")->purity == PURITY_PURE);
+
+	// Reads a global, a string argument or a string literal
+	CHECK(function(program, "scaled")->purity == PURITY_READS_GLOBALS);
+	CHECK(function(program, "one")->purity == PURITY_READS_GLOBALS);
+	CHECK(function(program, "label")->purity == PURITY_READS_GLOBALS);
+
+	// Assigns a global in a block, or calls a function that does
+	CHECK(function(program, "bump")->purity == PURITY_WRITES_GLOBALS);
+	CHECK(function(program, "twice")->purity == PURITY_WRITES_GLOBALS);
+
+	// Inline code, and a call of it
+	CHECK(function(program, "say")->purity == PURITY_OPAQUE);
+	CHECK(function(program, "loud")->purity == PURITY_WRITES_GLOBALS);
+
+	CHECK(! function(program, "scaled")->changes_globals());
+	CHECK(function(program, "loud")->changes_globals());
+
+	program->release_on(NULL);
+	delete program;
+
+	Compiler compiler;
+	std::ostringstream output;
+
+	CHECK(compiler.compile("purity.dpl", source, output));
+
+	// Only pure functions on numbers are constexpr
+	CHECK(has_line(output.str(), "[[gnu::const]] DPL_CONSTEXPR int sq(int x);"));
+	CHECK(has_line(output.str(), "[[gnu::pure]] int scaled(int x);"));
+	CHECK(has_line(output.str(), "[[gnu::pure]] int one(dpl::string s);"));
+	CHECK(has_line(output.str(), "[[gnu::pure]] dpl::string label(int x);"));
+	CHECK(has_line(output.str(), "int bump(int x);"));
+	CHECK(has_line(output.str(), "int twice(int x);"));
+	CHECK(has_line(output.str(), "int loud(int x);"));
+	CHECK(has_line(output.str(), "auto say(dpl::string s);"));
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,110 @@
+/*
+ * string_test.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ *
+ * Copies, moves and comparisons of dpl::string across its small, heap and
+ * interned storages.
+ */
+
+#include <utility>
+
+#include "dpl_string.h"
+#include "test.h"
+
+// Whether the characters of [str] are stored in the string itself
+static bool inline_storage(const dpl::string & str) {
+	const char * object = reinterpret_cast<const char *>(&str);
+
+	return str.data() >= object && str.data() < object + sizeof(str);
+}
+
+// Whether [str] holds [text]
+static bool holds(const dpl::string & str, const char * text) {
+	return str.size() == strlen(text) && ! memcmp(str.data(), text, str.size()) && str.data()[str.size()] == '\0';
+}
+
+int main() {
+	static const char hello_text[] = "hello";
+	static const char long_text[] = "a string longer than fifteen characters";
+
+	// Literal table, "hello" twice as another translation unit could have it
+	static const char hello_other[] = "hello";
+	dpl::string hello = dpl::string::interned(hello_text, 5, dpl::string("hello").hash());
+	dpl::string hello_too = dpl::string::interned(hello_other, 5, hello.hash());
+	dpl::string world = dpl::string::interned("world", 5, dpl::string("world").hash());
+
+	dpl::string small("hello");
+	dpl::string heap(long_text);
+	dpl::string empty;
+
+	CHECK(inline_storage(small));
+	CHECK(! inline_storage(heap) && heap.data() != long_text);
+	CHECK(hello.data() == hello_text);
+	CHECK(holds(empty, ""));
+
+	// Copies keep the storage, and only interned strings share characters
+	dpl::string small_copy(small), heap_copy(heap), hello_copy(hello);
+
+	CHECK(holds(small_copy, "hello") && inline_storage(small_copy));
+	CHECK(holds(heap_copy, long_text) && heap_copy.data() != heap.data());
+	CHECK(hello_copy.data() == hello_text);
+
+	// Moves take the characters and leave the empty string behind
+	const char * heap_data = heap_copy.data();
+	dpl::string heap_moved(std::move(heap_copy));
+	dpl::string small_moved(std::move(small_copy));
+	dpl::string hello_moved(std::move(hello_copy));
+
+	CHECK(heap_moved.data() == heap_data);
+	CHECK(holds(small_moved, "hello") && inline_storage(small_moved));
+	CHECK(hello_moved.data() == hello_text);
+	CHECK(holds(heap_copy, "") && holds(small_copy, "") && holds(hello_copy, ""));
+
+	// Assignments between storages, and to itself
+	dpl::string assigned(long_text);
+
+	assigned = small;
+	CHECK(holds(assigned, "hello") && inline_storage(assigned));
+	assigned = hello;
+	CHECK(assigned.data() == hello_text);
+	assigned = heap;
+	CHECK(holds(assigned, long_text) && assigned.data() != heap.data());
+	assigned = std::move(heap_moved);
+	CHECK(assigned.data() == heap_data && holds(heap_moved, ""));
+	assigned = assigned;
+	CHECK(holds(assigned, long_text));
+
+	// Equal across storages by their characters
+	CHECK(small == hello && hello == small);
+	CHECK(heap == assigned);
+	CHECK(small != world && hello != world);
+	CHECK(small.hash() == hello.hash());
+
+	// Interned strings are unique, so they are equal only if they point to
+	// the same characters
+	CHECK(hello == dpl::string::interned(hello_text, 5, hello.hash()));
+	CHECK(hello != hello_too);
+
+	// Ordered by characters, then by length
+	CHECK(small < world && ! (world < hello));
+	CHECK(dpl::string("hell") < hello && hello <= small && hello >= small);
+	CHECK(empty < small);
+
+	// Concatenation, which goes from small to heap storage
+	dpl::string joined = hello + world;
+
+	CHECK(holds(joined, "helloworld") && inline_storage(joined));
+	joined += dpl::string(long_text);
+	CHECK(holds(joined, "helloworlda string longer than fifteen characters") && ! inline_storage(joined));
+
+	// Char arrays are copied up to their first zero
+	char buffer[16] = "abc";
+	dpl::string from_buffer(buffer);
+
+	buffer[0] = 'x';
+	CHECK(holds(from_buffer, "abc") && inline_storage(from_buffer));
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,25 @@
+/*
+ * test.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ *
+ * Checks of the tests, which ctest runs. A test counts the checks that
+ * failed and returns 1 if any did.
+ */
+
+#ifndef TESTS_TEST_H_
+#define TESTS_TEST_H_
+
+#include <cstdio>
+
+// Checks that failed in the test
+static int failures = 0;
+
+// Report [condition] with its line if it does not hold, and go on
+#define CHECK(condition) {if(! (condition)) {fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); failures++;}}
+
+// Return value of main
+#define TEST_RESULT() (failures ? (fprintf(stderr, "%d checks failed\n", failures), 1) : 0)
+
+#endif /* TESTS_TEST_H_ */
@@ -0,0 +1,91 @@
+/*
+ * trace.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+
+#include "trace.h"
+
+Trace::Trace() {
+
+	this->origin = 0;
+	this->origin = now();
+
+}
+
+// Start a span on the calling thread
+void Trace::begin(const std::string & name, const char * category) {
+	TraceEvent event;
+
+	event.name = name;
+	event.category = category;
+	event.thread = thread_id();
+	event.start = now();
+	event.duration = 0;
+
+	std::lock_guard<std::mutex> guard(lock);
+	open[event.thread].push_back(event);
+}
+
+// End the innermost span of the calling thread
+void Trace::end() {
+	double time = now();
+
+	std::lock_guard<std::mutex> guard(lock);
+	std::vector<TraceEvent> & spans = open[thread_id()];
+
+	if(spans.empty())
+		return;
+
+	spans.back().duration = time - spans.back().start;
+	events.push_back(spans.back());
+	spans.pop_back();
+}
+
+// Output complete events, names are escaped for JSON
+void Trace::write(std::ostream & out) {
+	std::lock_guard<std::mutex> guard(lock);
+	int pid = getpid();
+
+	out << std::fixed << std::setprecision(3) << "{\"traceEvents\": [";
+
+	for(size_t i = 0; i < events.size(); i++) {
+		TraceEvent & event = events[i];
+
+		out << (i ? "," : "") << "\n{\"name\": \"";
+
+		for(char c : event.name) {
+			if(c == '"' || c == '\\')
+				out << '\\' << c;
+			else if((unsigned char) c < 0x20)
+				out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int) c << std::dec << std::setfill(' ');
+			else
+				out << c;
+		}
+
+		out << "\", \"cat\": \"" << event.category << "\", \"ph\": \"X\", \"ts\": " << event.start
+				<< ", \"dur\": " << event.duration << ", \"pid\": " << pid << ", \"tid\": " << event.thread << "}";
+	}
+
+	out << "\n], \"displayTimeUnit\": \"ms\"}" << std::endl;
+	out.unsetf(std::ios::floatfield);
+}
+
+// Number the threads in the order they first record something
+int Trace::thread_id() {
+	static std::atomic<int> next(1);
+	thread_local int id = next++;
+
+	return id;
+}
+
+// Monotonic time relative to the start of the trace
+double Trace::now() {
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count() - origin;
+}
@@ -0,0 +1,64 @@
+/*
+ * trace.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+// Defines a finished span, times in microseconds since the trace started
+class TraceEvent {
+
+public:
+	std::string name;
+	const char * category;
+	double start;
+	double duration;
+	int thread;
+
+};
+
+// Records spans of the compiler as Chrome trace events, which can be
+// opened in Perfetto or chrome://tracing. Spans may nest and may be
+// recorded from several threads, each thread gets its own track.
+class Trace {
+
+public:
+	Trace();
+
+	// Start a span [name] in [category] on the calling thread
+	void begin(const std::string & name, const char * category);
+
+	// End the innermost span of the calling thread
+	void end();
+
+	// Output the events as trace event JSON
+	void write(std::ostream & out);
+
+	// Small id of the calling thread, 1 for the first thread that asks
+	static int thread_id();
+
+private:
+	// Time the trace started, in microseconds
+	double origin;
+
+	std::vector<TraceEvent> events;
+
+	// Open spans of each thread
+	std::unordered_map<int, std::vector<TraceEvent>> open;
+
+	std::mutex lock;
+
+	// Microseconds since the trace started
+	double now();
+};
+
+#endif /* TRACE_H_ */
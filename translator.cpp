@@ -6,16 +6,25 @@
  */
 
 #include <stack>
+#include <cstdio>
+#include <cstdint>
+#include <sstream>
 #include "translator.h"
 
 Translator::Translator() {
 
 	this->program = NULL;
+	this->strings = NULL;
+	this->streaming = 0;
+	this->out = &std::cout;
+	this->trace = NULL;
+	this->keep_functions = 0;
+	this->literals = NULL;
 
 	// Define return types
 	types[TOK_INT] = "int";
 	types[TOK_FLOAT] = "float";
-	types[TOK_STRING] = "char *";
+	types[TOK_STRING] = "dpl::string";
 	types[TOK_NULL] = "void *";
 	types[TOK_AUTO] = "auto";
 
@@ -24,10 +33,18 @@ Translator::Translator() {
 // Takes in a program as argument and translates it
 void Translator::translate(Program * program) {
 	this->program = program;
+	this->strings = static_cast<GlobalProgram *>(program);
+	this->streaming = 0;
+	this->translations.clear();
+
+	find_constants();
 
 	// Print default includes
 	default_includes();
 
+	// Print the string literal table
+	declare_strings();
+
 	// Print global variable declarations
 	declare_variables(program);
 
@@ -42,12 +59,136 @@ void Translator::translate(Program * program) {
 
 }
 
+// Write each function as soon as the parser hands it over, the table of
+// strings and main come after the last one
+void Translator::translate_stream(FunctionStream * stream) {
+	StreamItem item;
+
+	this->program = NULL;
+	this->strings = new GlobalProgram();
+	this->streaming = 1;
+
+	default_includes();
+
+	*out << "extern const dpl::string dpl_strings[];" << std::endl;
+
+	while(stream->pop(item)) {
+		for(auto variable : item.variables)
+			*out << types[variable->type] << " " << variable->name << ";" << std::endl;
+
+		if(! item.function)
+			continue;
+
+		if(trace)
+			trace->begin(item.function->name, "translate");
+
+		*out << std::endl;
+		define_function(item.function);
+
+		item.function->release();
+		Lexer::free_tokens(item.function->tokens);
+
+		if(trace)
+			trace->end();
+	}
+
+	// The source had errors
+	if(! (this->program = stream->program)) {
+		delete strings;
+		return;
+	}
+
+	define_main();
+	declare_strings();
+
+	delete strings;
+}
+
+// Keep the translations of functions, or forget them
+void Translator::set_keep_functions(int keep) {
+	this->keep_functions = keep;
+
+	if(! keep)
+		functions.clear();
+}
+
+// Resolve the escape sequences of a string literal to the characters
+// they stand for
+std::string Translator::unescape_string(const char * literal) {
+	std::string value;
+
+	for(const char * pt = literal; *pt; pt++) {
+		if(*pt != '\\' || *(pt + 1) == '\0') {
+			value += *pt;
+			continue;
+		}
+
+		switch(*++pt) {
+		case 'n': value += '\n'; break;
+		case 't': value += '\t'; break;
+		case 'r': value += '\r'; break;
+		case '0': value += '\0'; break;
+		default: value += *pt; break;
+		}
+	}
+
+	return value;
+}
+
+// Set the stream that the translated code is written to
+void Translator::set_output(std::ostream * out) {
+	this->out = out;
+}
+
+// Record translated functions
+void Translator::set_trace(Trace * trace) {
+	this->trace = trace;
+}
+
 // Output the default C includes
 void Translator::default_includes() {
-	std::cout << "#include <iostream>" << std::endl;
-	std::cout << "#include <string>" << std::endl;
-	std::cout << "#include <stdio.h>" << std::endl;
-	std::cout << "#include <stdlib.h>" << std::endl;
+	*out << "#include <iostream>" << std::endl;
+	*out << "#include <string>" << std::endl;
+	*out << "#include <stdio.h>" << std::endl;
+	*out << "#include <stdlib.h>" << std::endl;
+	*out << "#include \"dpl_runtime.h\"" << std::endl;
+}
+
+// Output the string literals of the program as one static table of interned
+// strings, the length and hash of each literal are computed here so that
+// the generated program never has to
+void Translator::declare_strings() {
+	if(strings->strings->empty())
+		return;
+
+	// A stream declares the table before it knows what is in it
+	*out << std::endl << (streaming ? "" : "static ") << "const dpl::string dpl_strings[] = {" << std::endl;
+
+	for(auto & literal : *strings->strings) {
+		std::string value = unescape_string(literal.c_str());
+		uint32_t hash = 2166136261u;
+
+		// FNV-1a, same as dpl::string::hash
+		for(unsigned char c : value)
+			hash = (hash ^ c) * 16777619u;
+
+		*out << "dpl::string::interned(\"";
+
+		// Escape everything that is not printable
+		for(unsigned char c : value) {
+			if(c == '"' || c == '\\' || ! isprint(c)) {
+				char octal[5];
+				snprintf(octal, sizeof(octal), "\\%03o", c);
+				*out << octal;
+			}
+			else
+				*out << c;
+		}
+
+		*out << "\", " << value.size() << ", " << hash << "u)," << std::endl;
+	}
+
+	*out << "};" << std::endl;
 }
 
 // Translate the global function protoypes in programs into their code form
@@ -57,52 +198,175 @@ void Translator::translate_global_function_prototypes() {
 	program = static_cast<GlobalProgram *>(this->program);
 
 	// Iterate through each function initializer
-	for(auto function = program->functions->begin(); function != program->functions->end(); function++) {
-		std::string return_type = types[function->second->get_return_type()];
-		std::string name = function->second->name;
-		std::string arguments;
+	for(auto function = program->functions->begin(); function != program->functions->end(); function++)
+		*out << function_signature(function->second) << ";" << std::endl;
+}
 
-		// Fetch arguments
-		Argument * arg;
-		int args_size = function->second->get_arguments_size();
+// Return the C++ signature of [function]
+std::string Translator::function_signature(Function * function) {
+	std::string return_type;
+	std::string name = function->name;
+	std::string arguments, parameters;
 
-		if(args_size) {
+	// Fetch arguments
+	Argument * arg;
+	int args_size = function->get_arguments_size();
 
-			for(int i = 0; i < args_size; i++) {
-				arg = function->second->get_next_argument();
+	for(int i = 0; i < args_size; i++) {
+		arg = function->get_argument(i);
 
-				arguments += types[arg->type] + " " + arg->name + ((i == args_size - 1) ? "" : ",");
-			}
+		// Streamed functions take the type of each argument as a template parameter
+		if(streaming) {
+			parameters += std::string(i ? "," : "") + "typename T_" + arg->name;
+			arguments += std::string("T_") + arg->name + " " + arg->name + ((i == args_size - 1) ? "" : ",");
+		}
+
+		else
+			arguments += types[arg->type] + " " + arg->name + ((i == args_size - 1) ? "" : ",");
+	}
+
+	if(streaming) {
+		std::lock_guard<std::mutex> guard(function->lock);
+
+		// Until a call sets it the return type is left to the compiler
+		if(! function->get_return_type() || function->get_return_type() == TOK_AUTO)
+			return_type = "auto";
+
+		else
+			return_type = types[function->get_return_type()];
+
+		if(args_size)
+			return "template<" + parameters + ">\n" + return_type + " " + name + "(" + arguments + ")";
+	}
+
+	else
+		return_type = types[function->get_return_type()];
+
+	// A function that does not return a value has nothing to keep from a call
+	if(! streaming && function->get_return_type() >= TOK_INT && function->get_return_type() <= TOK_STRING) {
+		if(constants.count(function))
+			return_type = "DPL_CONSTEXPR " + return_type;
+
+		if(function->purity == PURITY_PURE)
+			return_type = "[[gnu::const]] " + return_type;
+
+		else if(function->purity == PURITY_READS_GLOBALS)
+			return_type = "[[gnu::pure]] " + return_type;
+	}
+
+	return return_type + " " + name + "(" + arguments + ")";
+}
+
+// Start from the pure functions on ints and floats, and leave out those that
+// call a function left out, until none is
+void Translator::find_constants() {
+	GlobalProgram * program = static_cast<GlobalProgram *>(this->program);
+	int changed = 1;
+
+	constants.clear();
+
+	for(auto & function : *program->functions) {
+		Function * f = function.second;
+		int numbers = f->purity == PURITY_PURE && (f->get_return_type() == TOK_INT || f->get_return_type() == TOK_FLOAT);
+
+		for(auto argument : f->get_arguments())
+			numbers = numbers && (argument->type == TOK_INT || argument->type == TOK_FLOAT);
+
+		for(auto & variable : *f->variables)
+			numbers = numbers && (variable.second->type == TOK_INT || variable.second->type == TOK_FLOAT);
+
+		if(numbers)
+			constants.insert(f);
+	}
+
+	while(changed) {
+		changed = 0;
 
+		for(auto it = constants.begin(); it != constants.end(); ) {
+			if(calls_constants(*it))
+				it++;
+
+			else {
+				it = constants.erase(it);
+				changed = 1;
+			}
 		}
+	}
+}
 
-		std::cout << return_type << " " << name << "(" << arguments << ");" << std::endl;
+// Calls in expressions are instructions of their own as well
+int Translator::calls_constants(Program * program) {
+	for(auto ins : program->get_instructions()) {
+		if(ins->type == TYPE_FUNCTIONCALL && ! constants.count(static_cast<FunctionCall *>(ins)->function))
+			return 0;
+
+		if(ins->type == TYPE_IF_STATEMENT && ! calls_constants(static_cast<IfStatement *>(ins)->program))
+			return 0;
 	}
+
+	return 1;
 }
 
 // Define the main function, which is the entry point for every program
 void Translator::define_main() {
-	Instruction * ins;
-
-	std::cout << std::endl << "int main() {" << std::endl;
+	*out << std::endl << "int main() {" << std::endl;
 
 	// Iterate through global instructions
-	while((ins = program->get_next_instruction()))
+	for(auto ins : program->get_instructions())
 		translate_instruction(ins);
 
 	// End of main function
-	std::cout << "return 0;" << std::endl << "}" << std::endl;
+	*out << "return 0;" << std::endl << "}" << std::endl;
 }
 
 // Declare the variables in program
-void Translator::declare_variables(Program * program) {
+void Translator::declare_variables(Program * program, int initialize) {
 
 	// Iterate through the variables
 	for(auto var = program->variables->begin(); var != program->variables->end(); var++) {
-		std::cout << types[var->second->type] <<  " " << var->second->name << ";" << std::endl;
+		*out << types[var->second->type] <<  " " << var->second->name << (initialize ? " = 0;" : ";") << std::endl;
+	}
+
+	*out << std::endl;
+}
+
+// Output the tokens of an expression, string literals are replaced by
+// their entry in the string table
+void Translator::translate_expression(std::vector<Token *> * expression) {
+	if(streaming) {
+		for(auto tok : *expression) {
+			if(tok->type == TOK_STRING)
+				*out << "dpl_strings[" << strings->push_string(tok->value()) << "]";
+			else
+				*out << tok->value();
+		}
+
+		return;
 	}
 
-	std::cout << std::endl;
+	// A kept function has to find its literals at the same indices to be reused
+	if(literals)
+		for(auto tok : *expression)
+			if(tok->type == TOK_STRING)
+				literals->push_back(std::make_pair(std::string(tok->value()), strings->push_string(tok->value())));
+
+	auto it = translations.find(expression);
+
+	// Repeated expressions are written from the text of the first
+	if(it == translations.end()) {
+		std::string text;
+
+		for(auto tok : *expression) {
+			if(tok->type == TOK_STRING)
+				text += "dpl_strings[" + std::to_string(strings->push_string(tok->value())) + "]";
+			else
+				text += tok->value();
+		}
+
+		it = translations.insert(std::make_pair(expression, text)).first;
+	}
+
+	*out << it->second;
 }
 
 // Translate an instruction into its source form
@@ -145,66 +409,55 @@ void Translator::translate_instruction(Instruction * instruction) {
 
 // Translate an assignment operation in postfix notation
 void Translator::translate_assignment_operation(Assignment * instruction) {
-	std::cout << instruction->variable->name << " = ";
+	*out << instruction->variable->name << " = ";
 
-	for(auto tok : *instruction->variable->value) {
-		std::cout << tok->value;
-	}
+	translate_expression(instruction->variable->value);
 
-	std::cout << ";" << std::endl;
+	*out << ";" << std::endl;
 }
 
 // Translate a return operation
 void Translator::translate_return_operation(ReturnOperation * instruction) {
-	std::cout << "return ";
+	*out << "return ";
 
-	for(auto tok : *instruction->value) {
-		std::cout << tok->value;
-	}
+	translate_expression(instruction->value);
 
-	std::cout << ";" << std::endl;
+	*out << ";" << std::endl;
 }
 
 // Translate an if statement
 void Translator::translate_if_statement(IfStatement * instruction) {
-	std::cout << "if (";
+	*out << "if (";
 
-	for(auto tok : *instruction->expression) {
-		std::cout << tok->value;
-	}
+	translate_expression(instruction->expression);
 
-	std::cout << ") {" << std::endl;
+	*out << ") {" << std::endl;
 
 	// Iterate through instructions
-	Instruction * ins;
-
-	while((ins = instruction->program->get_next_instruction())) {
+	for(auto ins : instruction->program->get_instructions())
 		translate_instruction(ins);
-	}
 
-	std::cout << "}" << std::endl;
+	*out << "}" << std::endl;
 }
 
 // Translate a function call
 void Translator::translate_function_call(FunctionCall * instruction) {
-	std::vector<Token *> * arg;
 	int first = 1;
 
-	std::cout << instruction->function->name << "(";
+	*out << instruction->function->name << "(";
 
-	while((arg = instruction->get_next_argument())) {
+	for(auto arg : instruction->get_arguments()) {
 
 		if(first)
 			first = 0;
 		else
-			std::cout << ",";
+			*out << ",";
 
-		for(auto tok : *arg)
-			std::cout << tok->value;
+		translate_expression(arg);
 
 	}
 
-	std::cout << ");" << std::endl;
+	*out << ");" << std::endl;
 
 }
 // Define global functions
@@ -213,52 +466,146 @@ void Translator::define_global_functions() {
 
 	program = static_cast<GlobalProgram *>(this->program);
 
-	std::cout << std::endl;
+	*out << std::endl;
 
 	// Iterate through each function initializer
 	for(auto function = program->functions->begin(); function != program->functions->end(); function++) {
-		std::string return_type = types[function->second->get_return_type()];
-		std::string name = function->second->name;
-		std::string arguments;
+		if(trace)
+			trace->begin(function->first, "translate");
 
-		// Fetch arguments
-		Argument * arg;
-		int args_size = function->second->get_arguments_size();
+		define_function(function->second);
 
-		if(args_size) {
+		if(trace)
+			trace->end();
+	}
+}
 
-			for(int i = 0; i < args_size; i++) {
-				arg = function->second->get_next_argument();
+// Define a single function, a kept translation is used if the function is
+// written from the same text and its literals are in the same places
+void Translator::define_function(Function * function) {
+	std::string key;
+	std::ostringstream text;
+	std::ostream * output = out;
+	FunctionTranslation translation;
+
+	if(! keep_functions || streaming) {
+		write_function(function);
+		return;
+	}
 
-				arguments += types[arg->type] + " " + arg->name + ((i == args_size - 1) ? "" : ",");
-			}
+	key = function_signature(function) + (constants.count(function) ? " = 0" : "");
+
+	for(auto & variable : *function->variables)
+		key += '\n' + types[variable.second->type] + " " + variable.first;
+
+	describe(function->get_instructions(), key);
+
+	auto it = functions.find(key);
+
+	// The same function pushes the same literals, the table is the same either way
+	if(it != functions.end()) {
+		int same = 1;
+
+		for(auto & literal : it->second.literals)
+			same = same && strings->push_string(literal.first.c_str()) == literal.second;
 
+		if(same) {
+			*out << it->second.text;
+			return;
 		}
+	}
+
+	out = &text;
+	literals = &translation.literals;
+
+	write_function(function);
+
+	out = output;
+	literals = NULL;
+
+	translation.text = text.str();
+	*out << translation.text;
+
+	if(functions.size() >= TRANSLATOR_FUNCTIONS_KEPT)
+		functions.clear();
+
+	functions[key] = std::move(translation);
+}
 
-		std::cout << return_type << " " << name << "(" << arguments << ") {" << std::endl;
+// Append the instructions to the key of a function, with the name of
+// what they assign or call and the tokens of their expressions
+void Translator::describe(const std::vector<Instruction *> & instructions, std::string & key) {
+	for(auto ins : instructions) {
+		key += '\n';
+		key += std::to_string(ins->type);
 
-		// Declare variables
-		declare_variables(function->second);
+		switch(ins->type) {
 
-		// Iterate through instructions
-		Instruction * ins;
+		case TYPE_ASSIGNMENT:
+			key += static_cast<Assignment *>(ins)->variable->name;
+			describe(static_cast<Assignment *>(ins)->variable->value, key);
+			break;
 
-		while((ins = function->second->get_next_instruction()))
-			translate_instruction(ins);
+		case TYPE_RETURN:
+			describe(static_cast<ReturnOperation *>(ins)->value, key);
+			break;
 
-		std::cout << std::endl << "}" << std::endl << std::endl;
+		case TYPE_IF_STATEMENT:
+			describe(static_cast<IfStatement *>(ins)->expression, key);
+			describe(static_cast<IfStatement *>(ins)->program->get_instructions(), key);
+			key += '\n';
+			break;
+
+		case TYPE_FUNCTIONCALL:
+			key += static_cast<FunctionCall *>(ins)->function->name;
+
+			for(auto arg : static_cast<FunctionCall *>(ins)->get_arguments())
+				describe(arg, key);
+
+			break;
+
+		case TYPE_INLINE_INJECTION:
+			describe(static_cast<InlineInjection *>(ins)->code, key);
+			break;
+		}
+	}
+}
+
+// Each token is its type and its value
+void Translator::describe(std::vector<Token *> * expression, std::string & key) {
+	key += '\t';
+
+	for(auto tok : *expression) {
+		key += std::to_string(tok->type);
+		key += ' ';
+		key += tok->value();
+		key += '\0';
 	}
 }
 
+// Write the definition of a function
+void Translator::write_function(Function * function) {
+	*out << function_signature(function) << " {" << std::endl;
+
+	// Declare variables, a constexpr function may not leave them uninitialized
+	declare_variables(function, constants.count(function));
+
+	// Iterate through instructions
+	for(auto ins : function->get_instructions())
+		translate_instruction(ins);
+
+	*out << std::endl << "}" << std::endl << std::endl;
+}
+
 // Translate inline injection operation
 void Translator::translate_inline_injection(InlineInjection * instruction) {
 	// Output all tokens
 	for(auto tok : *(instruction->code)) {
 
 		if(tok->type == TOK_STRING)
-			std::cout << "\"" << tok->value << "\"" << " ";
+			*out << "\"" << tok->value() << "\"" << " ";
 		else
-			std::cout << tok->value << " ";
+			*out << tok->value() << " ";
 
 	}
 
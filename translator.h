@@ -8,9 +8,27 @@
 #ifndef TRANSLATOR_H_
 #define TRANSLATOR_H_
 
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <ostream>
 #include "mem/program.h"
 #include "mem/function.h"
+#include "trace.h"
+#include "function_stream.h"
+
+// Functions whose translation is kept, the table starts over when it is full
+#define TRANSLATOR_FUNCTIONS_KEPT 4096
+
+// Defines the C++ of a function kept between programs, together with the
+// string literals it refers to and their indices in the table of strings
+class FunctionTranslation {
+
+public:
+	std::string text;
+	std::vector<std::pair<std::string, int>> literals;
+
+};
 
 class Translator {
 
@@ -20,23 +38,83 @@ public:
 	// Translate a program
 	void translate(Program * program);
 
-private:
+	// Translate the functions of [stream] as they come, and free each
+	// one after it is written, then main once the stream is closed.
+	// The types of arguments are only known after the last call, so
+	// functions are templates on them and are defined before any call.
+	void translate_stream(FunctionStream * stream);
+
+	// Set the stream that the translated code is written to
+	// standard output by default
+	void set_output(std::ostream * out);
+
+	// Record a span for each function translated in [trace]
+	void set_trace(Trace * trace);
+
+	// Keep the translation of each function between programs, a function
+	// written from the same signature, variables and instructions in a
+	// later program is copied from it. Not used in a stream.
+	void set_keep_functions(int keep);
+
+	// Resolve the escape sequences of a string literal
+	static std::string unescape_string(const char * literal);
+
+protected:
 	Program * program;
 
+	// Program whose string table expressions refer to, in a stream the
+	// table is filled as functions are translated and written last
+	GlobalProgram * strings;
+
+	// Text of each expression translated, the parser keeps one node of
+	// expressions that are the same. Not kept in a stream, whose
+	// expressions are freed with their functions.
+	std::unordered_map<std::vector<Token *> *, std::string> translations;
+	int streaming;
+
+	// Translations of functions by everything they are written from,
+	// and the literals of the function being kept, NULL if none is
+	int keep_functions;
+	std::unordered_map<std::string, FunctionTranslation> functions;
+	std::vector<std::pair<std::string, int>> * literals;
+
+	// Output stream
+	std::ostream * out;
+
+	// Spans of translated functions, NULL if not recorded
+	Trace * trace;
+
 	// Return types
 	std::unordered_map<int, std::string> types;
 
+	// Functions that are constexpr, found before each translation
+	std::unordered_set<Function *> constants;
+
+	// Find the functions that may be constexpr in C++14: pure, on ints and
+	// floats, and calling only functions that may be constexpr as well
+	void find_constants();
+
+	// Whether [program] and its blocks call only functions of constants
+	int calls_constants(Program * program);
+
 	// Output the default C includes
 	void default_includes();
 
+	// Output the table of string literals used in expressions
+	void declare_strings();
+
 	// Translate global function definitions in to their code form
 	void translate_global_function_prototypes();
 
 	// Define the main method of the application
 	void define_main();
 
-	// Declare the variables in program
-	void declare_variables(Program * program);
+	// Declare the variables in program, initialized to zero if [initialize]
+	void declare_variables(Program * program, int initialize = 0);
+
+	// Output an expression, string literals refer to the string table,
+	// an expression translated before is written from its text
+	void translate_expression(std::vector<Token *> * expression);
 
 	// Main function for translation of an instruction
 	void translate_instruction(Instruction * instruction);
@@ -58,6 +136,21 @@ private:
 
 	// Define global functions
 	void define_global_functions();
+
+	// Define a single function, from its kept translation if there is one
+	void define_function(Function * function);
+
+	// Write the definition of a function
+	void write_function(Function * function);
+
+	// Append to [key] what the text of [instructions] is written from
+	void describe(const std::vector<Instruction *> & instructions, std::string & key);
+
+	// Append the tokens of [expression] to [key]
+	void describe(std::vector<Token *> * expression, std::string & key);
+
+	// Return the C++ signature of a function, without a trailing ;
+	std::string function_signature(Function * function);
 };
 
 #endif /* TRANSLATOR_H_ */
@@ -0,0 +1,389 @@
+/*
+ * vm.cpp
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#include <cmath>
+#include <iostream>
+
+#include "vm.h"
+#include "error.h"
+
+#ifdef VM_COMPUTED_GOTO
+#define TARGET(code) L_##code:
+#define DISPATCH() do { op = pc++; goto * labels[op->code]; } while(0)
+#else
+#define TARGET(code) case code:
+#define DISPATCH() break
+#endif
+
+VM::VM() {
+
+	this->ints = new int[VM_STACK_SIZE];
+	this->floats = new float[VM_STACK_SIZE];
+	this->strings = new dpl::string[VM_STACK_SIZE];
+
+}
+
+VM::~VM() {
+	delete[] ints;
+	delete[] floats;
+	delete[] strings;
+}
+
+// Run a compiled program, starting with chunk 0
+void VM::run(Bytecode * bytecode) {
+	Chunk * chunk = bytecode->chunks[0];
+	const Op * pc = chunk->code.data();
+	const Op * op;
+
+	// Registers of the running frame
+	int * I = ints;
+	float * F = floats;
+	dpl::string * S = strings;
+
+#ifdef VM_COMPUTED_GOTO
+	// In the order of the opcodes
+	static void * labels[] = {
+		&&L_OP_HALT, &&L_OP_LOADI, &&L_OP_LOADF, &&L_OP_LOADS, &&L_OP_MOVI, &&L_OP_MOVF, &&L_OP_MOVS,
+		&&L_OP_GETI, &&L_OP_GETF, &&L_OP_GETS, &&L_OP_SETI, &&L_OP_SETF, &&L_OP_SETS,
+		&&L_OP_ADDI, &&L_OP_SUBI, &&L_OP_MULI, &&L_OP_DIVI, &&L_OP_MODI,
+		&&L_OP_ADDF, &&L_OP_SUBF, &&L_OP_MULF, &&L_OP_DIVF, &&L_OP_MODF, &&L_OP_CATS,
+		&&L_OP_LTI, &&L_OP_LEI, &&L_OP_GTI, &&L_OP_GEI, &&L_OP_EQI,
+		&&L_OP_LTF, &&L_OP_LEF, &&L_OP_GTF, &&L_OP_GEF, &&L_OP_EQF,
+		&&L_OP_LTS, &&L_OP_LES, &&L_OP_GTS, &&L_OP_GES, &&L_OP_EQS,
+		&&L_OP_AND, &&L_OP_OR, &&L_OP_TRUTHF, &&L_OP_ITOF, &&L_OP_FTOI, &&L_OP_JMP, &&L_OP_JZ, &&L_OP_JNZ,
+		&&L_OP_PARAMI, &&L_OP_PARAMF, &&L_OP_PARAMS, &&L_OP_CALL,
+		&&L_OP_RETI, &&L_OP_RETF, &&L_OP_RETS, &&L_OP_RET,
+		&&L_OP_PRINTI, &&L_OP_PRINTF, &&L_OP_PRINTS
+	};
+
+	static_assert(sizeof(labels) / sizeof(labels[0]) == OP_COUNT, "missing label of an opcode");
+#endif
+
+	frames.clear();
+
+#ifdef VM_COMPUTED_GOTO
+	DISPATCH();
+#else
+	for(;;) {
+	op = pc++;
+
+	switch(op->code) {
+#endif
+
+	TARGET(OP_HALT)
+		return;
+
+	TARGET(OP_LOADI)
+		I[op->a] = op->b;
+		DISPATCH();
+
+	TARGET(OP_LOADF)
+		F[op->a] = bytecode->floats[op->b];
+		DISPATCH();
+
+	TARGET(OP_LOADS)
+		S[op->a] = bytecode->strings[op->b];
+		DISPATCH();
+
+	TARGET(OP_MOVI)
+		I[op->a] = I[op->b];
+		DISPATCH();
+
+	TARGET(OP_MOVF)
+		F[op->a] = F[op->b];
+		DISPATCH();
+
+	TARGET(OP_MOVS)
+		S[op->a] = S[op->b];
+		DISPATCH();
+
+	// Globals are the registers of main
+	TARGET(OP_GETI)
+		I[op->a] = ints[op->b];
+		DISPATCH();
+
+	TARGET(OP_GETF)
+		F[op->a] = floats[op->b];
+		DISPATCH();
+
+	TARGET(OP_GETS)
+		S[op->a] = strings[op->b];
+		DISPATCH();
+
+	TARGET(OP_SETI)
+		ints[op->a] = I[op->b];
+		DISPATCH();
+
+	TARGET(OP_SETF)
+		floats[op->a] = F[op->b];
+		DISPATCH();
+
+	TARGET(OP_SETS)
+		strings[op->a] = S[op->b];
+		DISPATCH();
+
+	TARGET(OP_ADDI)
+		I[op->a] = I[op->b] + I[op->c];
+		DISPATCH();
+
+	TARGET(OP_SUBI)
+		I[op->a] = I[op->b] - I[op->c];
+		DISPATCH();
+
+	TARGET(OP_MULI)
+		I[op->a] = I[op->b] * I[op->c];
+		DISPATCH();
+
+	TARGET(OP_DIVI)
+		if(! I[op->c])
+			ERROR(T_CRIT, "division by zero in function %s.\n", chunk->name);
+
+		I[op->a] = I[op->b] / I[op->c];
+		DISPATCH();
+
+	TARGET(OP_MODI)
+		if(! I[op->c])
+			ERROR(T_CRIT, "division by zero in function %s.\n", chunk->name);
+
+		I[op->a] = I[op->b] % I[op->c];
+		DISPATCH();
+
+	TARGET(OP_ADDF)
+		F[op->a] = F[op->b] + F[op->c];
+		DISPATCH();
+
+	TARGET(OP_SUBF)
+		F[op->a] = F[op->b] - F[op->c];
+		DISPATCH();
+
+	TARGET(OP_MULF)
+		F[op->a] = F[op->b] * F[op->c];
+		DISPATCH();
+
+	TARGET(OP_DIVF)
+		F[op->a] = F[op->b] / F[op->c];
+		DISPATCH();
+
+	TARGET(OP_MODF)
+		F[op->a] = fmodf(F[op->b], F[op->c]);
+		DISPATCH();
+
+	TARGET(OP_CATS)
+		S[op->a] = S[op->b] + S[op->c];
+		DISPATCH();
+
+	TARGET(OP_LTI)
+		I[op->a] = I[op->b] < I[op->c];
+		DISPATCH();
+
+	TARGET(OP_LEI)
+		I[op->a] = I[op->b] <= I[op->c];
+		DISPATCH();
+
+	TARGET(OP_GTI)
+		I[op->a] = I[op->b] > I[op->c];
+		DISPATCH();
+
+	TARGET(OP_GEI)
+		I[op->a] = I[op->b] >= I[op->c];
+		DISPATCH();
+
+	TARGET(OP_EQI)
+		I[op->a] = I[op->b] == I[op->c];
+		DISPATCH();
+
+	TARGET(OP_LTF)
+		I[op->a] = F[op->b] < F[op->c];
+		DISPATCH();
+
+	TARGET(OP_LEF)
+		I[op->a] = F[op->b] <= F[op->c];
+		DISPATCH();
+
+	TARGET(OP_GTF)
+		I[op->a] = F[op->b] > F[op->c];
+		DISPATCH();
+
+	TARGET(OP_GEF)
+		I[op->a] = F[op->b] >= F[op->c];
+		DISPATCH();
+
+	TARGET(OP_EQF)
+		I[op->a] = F[op->b] == F[op->c];
+		DISPATCH();
+
+	TARGET(OP_LTS)
+		I[op->a] = S[op->b] < S[op->c];
+		DISPATCH();
+
+	TARGET(OP_LES)
+		I[op->a] = S[op->b] <= S[op->c];
+		DISPATCH();
+
+	TARGET(OP_GTS)
+		I[op->a] = S[op->b] > S[op->c];
+		DISPATCH();
+
+	TARGET(OP_GES)
+		I[op->a] = S[op->b] >= S[op->c];
+		DISPATCH();
+
+	TARGET(OP_EQS)
+		I[op->a] = S[op->b] == S[op->c];
+		DISPATCH();
+
+	TARGET(OP_AND)
+		I[op->a] = I[op->b] && I[op->c];
+		DISPATCH();
+
+	TARGET(OP_OR)
+		I[op->a] = I[op->b] || I[op->c];
+		DISPATCH();
+
+	TARGET(OP_TRUTHF)
+		I[op->a] = F[op->b] != 0;
+		DISPATCH();
+
+	TARGET(OP_ITOF)
+		F[op->a] = I[op->b];
+		DISPATCH();
+
+	TARGET(OP_FTOI)
+		I[op->a] = F[op->b];
+		DISPATCH();
+
+	TARGET(OP_JMP)
+		pc = chunk->code.data() + op->a;
+		DISPATCH();
+
+	TARGET(OP_JZ)
+		if(! I[op->a])
+			pc = chunk->code.data() + op->b;
+
+		DISPATCH();
+
+	TARGET(OP_JNZ)
+		if(I[op->a])
+			pc = chunk->code.data() + op->b;
+
+		DISPATCH();
+
+	// The frame of the callee starts after the registers of the caller
+	TARGET(OP_PARAMI)
+		I[chunk->registers[TOK_INT] + op->a] = I[op->b];
+		DISPATCH();
+
+	TARGET(OP_PARAMF)
+		F[chunk->registers[TOK_FLOAT] + op->a] = F[op->b];
+		DISPATCH();
+
+	TARGET(OP_PARAMS)
+		S[chunk->registers[TOK_STRING] + op->a] = S[op->b];
+		DISPATCH();
+
+	TARGET(OP_CALL) {
+		Chunk * callee = bytecode->chunks[op->a];
+		Frame frame;
+
+		frame.chunk = chunk;
+		frame.pc = pc;
+		frame.ints = I - ints;
+		frame.floats = F - floats;
+		frame.strings = S - strings;
+
+		I += chunk->registers[TOK_INT];
+		F += chunk->registers[TOK_FLOAT];
+		S += chunk->registers[TOK_STRING];
+
+		if(I - ints + callee->registers[TOK_INT] > VM_STACK_SIZE
+				|| F - floats + callee->registers[TOK_FLOAT] > VM_STACK_SIZE
+				|| S - strings + callee->registers[TOK_STRING] > VM_STACK_SIZE)
+			ERROR(T_CRIT, "stack overflow in call to function %s.\n", callee->name);
+
+		frames.push_back(frame);
+
+		chunk = callee;
+		pc = callee->code.data();
+		DISPATCH();
+	}
+
+	// The result is stored in the register named by the call
+	TARGET(OP_RETI) {
+		int value = I[op->a];
+		Frame & frame = frames.back();
+
+		chunk = frame.chunk;
+		pc = frame.pc;
+		I = ints + frame.ints;
+		F = floats + frame.floats;
+		S = strings + frame.strings;
+		frames.pop_back();
+
+		I[pc[-1].b] = value;
+		DISPATCH();
+	}
+
+	TARGET(OP_RETF) {
+		float value = F[op->a];
+		Frame & frame = frames.back();
+
+		chunk = frame.chunk;
+		pc = frame.pc;
+		I = ints + frame.ints;
+		F = floats + frame.floats;
+		S = strings + frame.strings;
+		frames.pop_back();
+
+		F[pc[-1].b] = value;
+		DISPATCH();
+	}
+
+	TARGET(OP_RETS) {
+		dpl::string value = S[op->a];
+		Frame & frame = frames.back();
+
+		chunk = frame.chunk;
+		pc = frame.pc;
+		I = ints + frame.ints;
+		F = floats + frame.floats;
+		S = strings + frame.strings;
+		frames.pop_back();
+
+		S[pc[-1].b] = static_cast<dpl::string &&>(value);
+		DISPATCH();
+	}
+
+	TARGET(OP_RET) {
+		Frame & frame = frames.back();
+
+		chunk = frame.chunk;
+		pc = frame.pc;
+		I = ints + frame.ints;
+		F = floats + frame.floats;
+		S = strings + frame.strings;
+		frames.pop_back();
+		DISPATCH();
+	}
+
+	// print in stdlib/lib1.dpl
+	TARGET(OP_PRINTI)
+		std::cout << I[op->a] << std::endl;
+		DISPATCH();
+
+	TARGET(OP_PRINTF)
+		std::cout << F[op->a] << std::endl;
+		DISPATCH();
+
+	TARGET(OP_PRINTS)
+		std::cout << S[op->a] << std::endl;
+		DISPATCH();
+
+#ifndef VM_COMPUTED_GOTO
+	}
+	}
+#endif
+}
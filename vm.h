@@ -0,0 +1,57 @@
+/*
+ * vm.h
+ *
+ *  Created on: 19 oct. 2026
+ *      Author: eatit
+ */
+
+#ifndef VM_H_
+#define VM_H_
+
+#include <vector>
+
+#include "bytecode.h"
+
+// Registers of each bank for all frames
+#define VM_STACK_SIZE 65536
+
+// Dispatch through a table of label addresses where the compiler supports it
+#if defined(__GNUC__)
+#define VM_COMPUTED_GOTO 1
+#endif
+
+// Defines the state of a caller while a function runs
+class Frame {
+
+public:
+	Chunk * chunk;
+	const Op * pc;
+
+	// First register of each bank
+	int ints;
+	int floats;
+	int strings;
+
+};
+
+// Runs bytecode
+class VM {
+
+public:
+	VM();
+	virtual ~VM();
+
+	// Run a compiled program
+	void run(Bytecode * bytecode);
+
+private:
+	// Register stacks, the registers of main start at 0
+	int * ints;
+	float * floats;
+	dpl::string * strings;
+
+	// Callers of the running function
+	std::vector<Frame> frames;
+};
+
+#endif /* VM_H_ */